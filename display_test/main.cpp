@@ -0,0 +1,462 @@
+// Test and benchmark of the display backend under an X server (Xvfb).
+// A second X connection plays the user: it reads the window contents back,
+// injects input with XTest and resizes the window.
+
+#include "../src/display.h"
+#include "../src/perf_hud.h"
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XTest.h>
+#include <X11/keysym.h>
+#include <dirent.h>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+#define TEST_WIDTH 640
+#define TEST_HEIGHT 400
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 800
+#define WINDOW_TITLE "Drip display test"
+
+Config appConfig("/dev/null");
+
+// The parts of the performance HUD the display module reports to
+static double stageTotalMs[STAGE_COUNT];
+static int stageSamples[STAGE_COUNT];
+
+void recordStageTime(PerfStage stage, double ms) {
+    stageTotalMs[stage] += ms;
+    stageSamples[stage]++;
+}
+
+void setCurrentThreadName(const char*) {}
+
+static Display* probe = nullptr;
+static string configPath;
+static int failures = 0;
+
+struct MouseRecord {
+    int event;
+    int x;
+    int y;
+};
+static vector<MouseRecord> mouseEvents;
+
+static void onMouse(int event, int x, int y, int, void*) {
+    mouseEvents.push_back({event, x, y});
+}
+
+static void check(const string& step, bool passed, const string& detail = "") {
+    cout << (passed ? "ok   " : "FAIL ") << step;
+    if (!detail.empty()) {
+        cout << ": " << detail;
+    }
+    cout << endl;
+    if (!passed) {
+        failures++;
+    }
+}
+
+static void useBackend(const string& backend) {
+    ofstream config(configPath, ios::trunc);
+    config << "DISPLAY_BACKEND=" << backend << "\n";
+    config.close();
+    appConfig.loadConfig(configPath);
+}
+
+// Top-level window with the given title, 0 if there is none
+static Window findWindow(const string& title) {
+    Window root = DefaultRootWindow(probe);
+    Window rootReturn;
+    Window parent;
+    Window* children = nullptr;
+    unsigned int count = 0;
+    Window found = 0;
+
+    XSync(probe, False);
+    if (!XQueryTree(probe, root, &rootReturn, &parent, &children, &count)) {
+        return 0;
+    }
+    for (unsigned int i = 0; i < count && !found; i++) {
+        char* name = nullptr;
+        if (XFetchName(probe, children[i], &name) && name) {
+            if (title == name) {
+                found = children[i];
+            }
+            XFree(name);
+        }
+    }
+    if (children) {
+        XFree(children);
+    }
+    return found;
+}
+
+// Screen pixel at a window position as BGR, read from the root window so the
+// contents of child windows (highgui) count too
+static Vec3b readPixel(Window window, int x, int y) {
+    Window root = DefaultRootWindow(probe);
+    Window child;
+    int rootX = 0;
+    int rootY = 0;
+    XTranslateCoordinates(probe, window, root, x, y, &rootX, &rootY, &child);
+
+    XImage* image = XGetImage(probe, root, rootX, rootY, 1, 1, AllPlanes, ZPixmap);
+    if (!image) {
+        return Vec3b(0, 0, 0);
+    }
+    unsigned long pixel = XGetPixel(image, 0, 0);
+    XDestroyImage(image);
+    return Vec3b(pixel & 0xff, (pixel >> 8) & 0xff, (pixel >> 16) & 0xff);
+}
+
+static bool sameColor(Vec3b a, Vec3b b) {
+    return abs(a[0] - b[0]) <= 2 && abs(a[1] - b[1]) <= 2 && abs(a[2] - b[2]) <= 2;
+}
+
+static string colorText(Vec3b color) {
+    return "(" + to_string(color[0]) + "," + to_string(color[1]) + "," + to_string(color[2]) + ")";
+}
+
+// Keep the display module's loop running until the pixel shows the color
+static bool waitForPixel(Window window, int x, int y, Vec3b color, int timeoutMs) {
+    steady_clock::time_point deadline = steady_clock::now() + milliseconds(timeoutMs);
+    while (steady_clock::now() < deadline) {
+        pollDisplayEvents(1);
+        if (sameColor(readPixel(window, x, y), color)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Four colored quadrants, so both the channel order and the scaling show
+static const Vec3b quadrantColors[4] = {
+    Vec3b(255, 0, 0), Vec3b(0, 255, 0), Vec3b(0, 0, 255), Vec3b(255, 255, 255)
+};
+
+static Mat quadrantFrame(Size size) {
+    Mat frame(size, CV_8UC3);
+    int halfWidth = size.width / 2;
+    int halfHeight = size.height / 2;
+    frame(Rect(0, 0, halfWidth, halfHeight)).setTo(Scalar(quadrantColors[0]));
+    frame(Rect(halfWidth, 0, size.width - halfWidth, halfHeight)).setTo(Scalar(quadrantColors[1]));
+    frame(Rect(0, halfHeight, halfWidth, size.height - halfHeight)).setTo(Scalar(quadrantColors[2]));
+    frame(Rect(halfWidth, halfHeight, size.width - halfWidth, size.height - halfHeight)).setTo(Scalar(quadrantColors[3]));
+    return frame;
+}
+
+static void checkQuadrants(const string& step, Window window, Size windowSize) {
+    const Point centers[4] = {
+        Point(windowSize.width / 4, windowSize.height / 4),
+        Point(windowSize.width * 3 / 4, windowSize.height / 4),
+        Point(windowSize.width / 4, windowSize.height * 3 / 4),
+        Point(windowSize.width * 3 / 4, windowSize.height * 3 / 4)
+    };
+
+    // The bottom right quadrant is the last one to change, also after a resize
+    waitForPixel(window, centers[3].x, centers[3].y, quadrantColors[3], 2000);
+    bool passed = true;
+    string detail;
+    for (int i = 0; i < 4; i++) {
+        Vec3b color = readPixel(window, centers[i].x, centers[i].y);
+        passed &= sameColor(color, quadrantColors[i]);
+        detail += colorText(color) + " ";
+    }
+    check(step, passed, detail + "BGR");
+}
+
+// Inject a left click at a window position
+static void clickAt(Window window, int x, int y) {
+    Window child;
+    int rootX = 0;
+    int rootY = 0;
+    XTranslateCoordinates(probe, window, DefaultRootWindow(probe), x, y, &rootX, &rootY, &child);
+    XTestFakeMotionEvent(probe, DefaultScreen(probe), rootX, rootY, CurrentTime);
+    XTestFakeButtonEvent(probe, Button1, True, CurrentTime);
+    XTestFakeButtonEvent(probe, Button1, False, CurrentTime);
+    XSync(probe, False);
+}
+
+// Run the loop until the callback saw a press and release at the UI position
+static bool waitForClick(int x, int y, int timeoutMs) {
+    steady_clock::time_point deadline = steady_clock::now() + milliseconds(timeoutMs);
+    bool down = false;
+    bool up = false;
+    while (steady_clock::now() < deadline && !(down && up)) {
+        pollDisplayEvents(1);
+        for (const MouseRecord& record : mouseEvents) {
+            down |= record.event == EVENT_LBUTTONDOWN && abs(record.x - x) <= 1 && abs(record.y - y) <= 1;
+            up |= record.event == EVENT_LBUTTONUP && abs(record.x - x) <= 1 && abs(record.y - y) <= 1;
+        }
+        this_thread::sleep_for(milliseconds(1));
+    }
+    return down && up;
+}
+
+static string lastClickText() {
+    for (auto it = mouseEvents.rbegin(); it != mouseEvents.rend(); ++it) {
+        if (it->event == EVENT_LBUTTONDOWN) {
+            return "down at " + to_string(it->x) + "," + to_string(it->y);
+        }
+    }
+    return "no button press";
+}
+
+static void testSharedMemoryBackend(bool haveXTest) {
+    useBackend("auto");
+    openDisplay(WINDOW_TITLE, TEST_WIDTH, TEST_HEIGHT, false, onMouse);
+    check("shared-memory backend chosen", displayUsesSharedMemory());
+    Window window = findWindow(WINDOW_TITLE);
+    check("window created", window != 0);
+    if (!window) {
+        closeDisplay();
+        return;
+    }
+
+    Mat frame = quadrantFrame(Size(TEST_WIDTH, TEST_HEIGHT));
+    presentFrame(frame);
+    checkQuadrants("frame reaches the window", window, Size(TEST_WIDTH, TEST_HEIGHT));
+
+    if (haveXTest) {
+        mouseEvents.clear();
+        clickAt(window, 100, 50);
+        check("click delivered", waitForClick(100, 50, 2000), lastClickText());
+
+        XTestFakeKeyEvent(probe, XKeysymToKeycode(probe, XK_a), True, CurrentTime);
+        XTestFakeKeyEvent(probe, XKeysymToKeycode(probe, XK_a), False, CurrentTime);
+        XSync(probe, False);
+        int key = -1;
+        steady_clock::time_point deadline = steady_clock::now() + seconds(2);
+        while (key < 0 && steady_clock::now() < deadline) {
+            key = pollDisplayEvents(1);
+        }
+        check("key press returned", key == 'a', "key " + to_string(key));
+    } else {
+        cout << "skip input, no XTest extension" << endl;
+    }
+
+    // Half size, e.g. fullscreen on a smaller monitor. Without a window
+    // manager the resize is applied right away.
+    XResizeWindow(probe, window, TEST_WIDTH / 2, TEST_HEIGHT / 2);
+    XSync(probe, False);
+    for (int i = 0; i < 50; i++) {
+        pollDisplayEvents(1);
+        this_thread::sleep_for(milliseconds(2));
+    }
+    presentFrame(frame);
+    checkQuadrants("frame scaled to the resized window", window, Size(TEST_WIDTH / 2, TEST_HEIGHT / 2));
+
+    if (haveXTest) {
+        mouseEvents.clear();
+        clickAt(window, 100, 50);
+        check("click mapped to UI coordinates", waitForClick(200, 100, 2000), lastClickText());
+    }
+
+    closeDisplay();
+    check("closed", !displayOpen() && findWindow(WINDOW_TITLE) == 0);
+}
+
+static void testHighguiFallback() {
+    useBackend("highgui");
+    openDisplay(WINDOW_TITLE, TEST_WIDTH, TEST_HEIGHT, false, onMouse);
+    check("highgui backend chosen", !displayUsesSharedMemory());
+
+    Mat frame = quadrantFrame(Size(TEST_WIDTH, TEST_HEIGHT));
+    presentFrame(frame);
+    for (int i = 0; i < 20; i++) {
+        pollDisplayEvents(5);
+    }
+    Window window = findWindow(WINDOW_TITLE);
+    check("highgui window created", window != 0);
+    if (window) {
+        checkQuadrants("highgui frame reaches the window", window, Size(TEST_WIDTH, TEST_HEIGHT));
+    }
+    closeDisplay();
+    for (int i = 0; i < 10; i++) {
+        waitKey(5);
+    }
+}
+
+// CPU time of the X server, in clock ticks, -1 if it can't be found
+static long serverCpuTicks() {
+    DIR* dir = opendir("/proc");
+    if (!dir) {
+        return -1;
+    }
+
+    long ticks = -1;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL && ticks < 0) {
+        string pid = ent->d_name;
+        if (pid.find_first_not_of("0123456789") != string::npos) {
+            continue;
+        }
+        ifstream commFile("/proc/" + pid + "/comm");
+        string comm;
+        if (!(commFile >> comm) || (comm != "Xvfb" && comm != "Xorg" && comm != "X")) {
+            continue;
+        }
+
+        // utime and stime are fields 14 and 15, after the parenthesised name
+        ifstream statFile("/proc/" + pid + "/stat");
+        string stat((istreambuf_iterator<char>(statFile)), istreambuf_iterator<char>());
+        stringstream fields(stat.substr(stat.rfind(')') + 2));
+        string field;
+        long utime = 0;
+        long stime = 0;
+        for (int i = 3; i <= 15 && fields >> field; i++) {
+            if (i == 14) {
+                utime = atol(field.c_str());
+            } else if (i == 15) {
+                stime = atol(field.c_str());
+            }
+        }
+        ticks = utime + stime;
+    }
+    closedir(dir);
+    return ticks;
+}
+
+static double processCpuMs() {
+    timespec cpu;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    return cpu.tv_sec * 1000.0 + cpu.tv_nsec / 1e6;
+}
+
+static void benchBackend(const string& backend, int frames) {
+    useBackend(backend);
+    openDisplay(WINDOW_TITLE, BENCH_WIDTH, BENCH_HEIGHT, false, onMouse);
+    for (int i = 0; i < 20; i++) {
+        pollDisplayEvents(5);
+    }
+    Window window = findWindow(WINDOW_TITLE);
+    if (!window) {
+        cout << "  " << backend << ": window not found" << endl;
+        closeDisplay();
+        return;
+    }
+
+    // Camera-like frames, a few different ones so nothing is cached
+    vector<Mat> sources(4);
+    RNG rng(0xd15b);
+    for (Mat& source : sources) {
+        source.create(BENCH_HEIGHT, BENCH_WIDTH, CV_8UC3);
+        rng.fill(source, RNG::UNIFORM, 0, 256);
+    }
+
+    // Throughput and CPU, frames paced by the display loop only
+    fill(begin(stageTotalMs), end(stageTotalMs), 0.0);
+    fill(begin(stageSamples), end(stageSamples), 0);
+    long serverStart = serverCpuTicks();
+    double cpuStart = processCpuMs();
+    steady_clock::time_point wallStart = steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        presentFrame(sources[i % sources.size()]);
+        pollDisplayEvents(1);
+    }
+    XSync(probe, False);
+    double wallMs = duration<double, milli>(steady_clock::now() - wallStart).count();
+    double cpuMs = processCpuMs() - cpuStart;
+    long serverEnd = serverCpuTicks();
+
+    // Latency, a marker changes color every frame and is read back from the screen
+    const Vec3b markers[3] = {Vec3b(0, 0, 255), Vec3b(0, 255, 0), Vec3b(255, 0, 0)};
+    Mat frame = sources[0].clone();
+    vector<double> latencies;
+    int latencyFrames = min(frames, 100);
+    for (int i = 0; i < latencyFrames; i++) {
+        Vec3b marker = markers[i % 3];
+        frame(Rect(0, 0, 32, 32)).setTo(Scalar(marker));
+        steady_clock::time_point start = steady_clock::now();
+        presentFrame(frame);
+        if (waitForPixel(window, 16, 16, marker, 1000)) {
+            latencies.push_back(duration<double, milli>(steady_clock::now() - start).count());
+        }
+    }
+    closeDisplay();
+    for (int i = 0; i < 10; i++) {
+        waitKey(5);
+    }
+
+    cout << fixed << setprecision(2) << "  " << backend << ": " << wallMs / frames << " ms/frame wall, "
+         << cpuMs / frames << " ms/frame CPU (" << setprecision(0) << cpuMs * 100 / wallMs << "% of a core)";
+    if (serverStart >= 0 && serverEnd >= 0) {
+        double serverMs = (serverEnd - serverStart) * 1000.0 / sysconf(_SC_CLK_TCK);
+        cout << setprecision(2) << ", X server " << serverMs / frames << " ms/frame CPU";
+    }
+    cout << endl;
+
+    cout << "    stages: convert " << (stageSamples[STAGE_CONVERT] ? stageTotalMs[STAGE_CONVERT] / stageSamples[STAGE_CONVERT] : 0.0)
+         << " ms, present " << (stageSamples[STAGE_PRESENT] ? stageTotalMs[STAGE_PRESENT] / stageSamples[STAGE_PRESENT] : 0.0)
+         << " ms" << endl;
+
+    if (latencies.empty()) {
+        cout << "    latency: marker never seen on screen" << defaultfloat << endl;
+        return;
+    }
+    sort(latencies.begin(), latencies.end());
+    double total = 0;
+    for (double latency : latencies) {
+        total += latency;
+    }
+    cout << "    latency to screen: mean " << total / latencies.size()
+         << " ms, median " << latencies[latencies.size() / 2]
+         << " ms, p95 " << latencies[latencies.size() * 95 / 100]
+         << " ms, max " << latencies.back() << " ms (" << latencies.size() << "/" << latencyFrames << " seen)"
+         << defaultfloat << endl;
+}
+
+int main(int argc, char** argv) {
+    bool test = true;
+    bool bench = true;
+    int frames = 500;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--test") {
+            bench = false;
+        } else if (arg == "--bench") {
+            test = false;
+            if (i + 1 < argc) {
+                frames = max(1, atoi(argv[++i]));
+            }
+        } else {
+            cerr << "Usage: " << argv[0] << " [--test | --bench [frames]]" << endl;
+            return 2;
+        }
+    }
+
+    probe = XOpenDisplay(nullptr);
+    if (!probe) {
+        cerr << "ERROR: No X server, run under xvfb-run" << endl;
+        return 2;
+    }
+    configPath = "/tmp/drip-display-test-" + to_string(getpid()) + ".ini";
+
+    int eventBase = 0;
+    int errorBase = 0;
+    int major = 0;
+    int minor = 0;
+    bool haveXTest = XTestQueryExtension(probe, &eventBase, &errorBase, &major, &minor);
+
+    if (test) {
+        testSharedMemoryBackend(haveXTest);
+        testHighguiFallback();
+        cout << (failures ? to_string(failures) + " checks FAILED" : "All checks passed") << endl;
+    }
+
+    if (bench) {
+        cout << BENCH_WIDTH << "x" << BENCH_HEIGHT << ", " << frames << " frames per backend" << endl;
+        benchBackend("auto", frames);
+        benchBackend("highgui", frames);
+    }
+
+    remove(configPath.c_str());
+    XCloseDisplay(probe);
+    return failures ? 1 : 0;
+}
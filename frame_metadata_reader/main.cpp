@@ -0,0 +1,213 @@
+// Fast reader for Drip per-frame metadata sidecars (.fmeta).
+// Maps the file and answers queries with binary searches, no video decoding.
+
+#include "../src/frame_metadata.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static void printUsage(const char* program) {
+    cerr << "Usage: " << program << " <file.fmeta> [command]\n"
+         << "  (no command)                  summary of the recording\n"
+         << "  --csv                         dump every record as CSV\n"
+         << "  --at \"YYYY-MM-DD HH:MM:SS.mmm\"  record captured at or before the given local time\n"
+         << "  --range <start> <end>         CSV of the records between two local times\n";
+}
+
+// Parse "YYYY-MM-DD HH:MM:SS[.mmm]" in local time into microseconds since the epoch
+static bool parseLocalTime(const string& text, int64_t& timestampUs) {
+    struct tm tmValue = {};
+    const char* rest = strptime(text.c_str(), "%Y-%m-%d %H:%M:%S", &tmValue);
+    if (!rest) {
+        return false;
+    }
+
+    tmValue.tm_isdst = -1;
+    time_t seconds = mktime(&tmValue);
+    if (seconds == -1) {
+        return false;
+    }
+
+    int64_t fractionUs = 0;
+    if (*rest == '.') {
+        rest++;
+        int64_t scale = 100000;
+        while (*rest >= '0' && *rest <= '9' && scale > 0) {
+            fractionUs += (*rest - '0') * scale;
+            scale /= 10;
+            rest++;
+        }
+    }
+
+    timestampUs = static_cast<int64_t>(seconds) * 1000000 + fractionUs;
+    return true;
+}
+
+static string formatLocalTime(int64_t timestampUs) {
+    time_t seconds = static_cast<time_t>(timestampUs / 1000000);
+    struct tm tmValue;
+    localtime_r(&seconds, &tmValue);
+
+    char buffer[64];
+    size_t len = strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tmValue);
+    snprintf(buffer + len, sizeof(buffer) - len, ".%03d", static_cast<int>((timestampUs % 1000000) / 1000));
+    return buffer;
+}
+
+static void printCsvHeader() {
+    cout << "time,capture_us,sequence,zoom_level,icr,stabilizer,roi,jpeg_quality,encode_latency_us,fps,detections,detector_score\n";
+}
+
+static void printCsvRecord(const FrameMetadataRecord& r) {
+    cout << formatLocalTime(r.captureTimeUs) << ','
+         << r.captureTimeUs << ','
+         << r.sequence << ','
+         << r.zoomLevel << ','
+         << ((r.flags & META_FLAG_ICR) ? 1 : 0) << ','
+         << ((r.flags & META_FLAG_STABILIZER) ? 1 : 0) << ','
+         << ((r.flags & META_FLAG_ROI) ? 1 : 0) << ','
+         << r.jpegQuality << ','
+         << r.encodeLatencyUs << ','
+         << r.measuredFpsMilli / 1000.0 << ','
+         << r.detectorCount << ','
+         << r.detectorScore << '\n';
+}
+
+// Index of the last record captured at or before timestampUs
+static size_t findRecord(const FrameMetadataRecord* records, size_t count, int64_t timestampUs) {
+    const FrameMetadataRecord* it = upper_bound(records, records + count, timestampUs,
+        [](int64_t ts, const FrameMetadataRecord& record) { return ts < record.captureTimeUs; });
+    return it == records ? 0 : static_cast<size_t>(it - records) - 1;
+}
+
+static void printSummary(const FrameMetadataRecord* records, size_t count) {
+    if (count == 0) {
+        cout << "No frames recorded" << endl;
+        return;
+    }
+
+    const FrameMetadataRecord& first = records[0];
+    const FrameMetadataRecord& last = records[count - 1];
+    double seconds = (last.captureTimeUs - first.captureTimeUs) / 1000000.0;
+
+    uint64_t latencySum = 0;
+    uint32_t latencyMax = 0;
+    uint64_t skipped = 0;
+    int zoomChanges = 0;
+    int icrChanges = 0;
+    int stabilizerChanges = 0;
+    uint64_t detections = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        latencySum += records[i].encodeLatencyUs;
+        latencyMax = max(latencyMax, records[i].encodeLatencyUs);
+        detections += records[i].detectorCount;
+        if (i > 0) {
+            skipped += records[i].sequence - records[i - 1].sequence - 1;
+            zoomChanges += records[i].zoomLevel != records[i - 1].zoomLevel;
+            icrChanges += (records[i].flags ^ records[i - 1].flags) & META_FLAG_ICR ? 1 : 0;
+            stabilizerChanges += (records[i].flags ^ records[i - 1].flags) & META_FLAG_STABILIZER ? 1 : 0;
+        }
+    }
+
+    cout << "Frames:             " << count << "\n"
+         << "Start:              " << formatLocalTime(first.captureTimeUs) << "\n"
+         << "End:                " << formatLocalTime(last.captureTimeUs) << "\n"
+         << "Duration:           " << seconds << " s\n"
+         << "Average fps:        " << (seconds > 0 ? (count - 1) / seconds : 0.0) << "\n"
+         << "Skipped frames:     " << skipped << "\n"
+         << "Encode latency:     avg " << latencySum / count << " us, max " << latencyMax << " us\n"
+         << "Zoom changes:       " << zoomChanges << "\n"
+         << "ICR changes:        " << icrChanges << "\n"
+         << "Stabilizer changes: " << stabilizerChanges << "\n"
+         << "Detections:         " << detections << endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    int fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+        cerr << "ERROR: Could not open " << argv[1] << endl;
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FrameMetadataHeader))) {
+        cerr << "ERROR: Not a frame metadata file" << endl;
+        close(fd);
+        return 1;
+    }
+
+    size_t fileSize = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        cerr << "ERROR: Could not map " << argv[1] << endl;
+        return 1;
+    }
+
+    const FrameMetadataHeader* header = static_cast<const FrameMetadataHeader*>(mapping);
+    if (memcmp(header->magic, FRAME_METADATA_MAGIC, sizeof(header->magic)) != 0 ||
+        header->recordSize != sizeof(FrameMetadataRecord)) {
+        cerr << "ERROR: Unsupported frame metadata format" << endl;
+        munmap(mapping, fileSize);
+        return 1;
+    }
+
+    const FrameMetadataRecord* records = reinterpret_cast<const FrameMetadataRecord*>(
+        static_cast<const uint8_t*>(mapping) + sizeof(FrameMetadataHeader));
+    size_t count = (fileSize - sizeof(FrameMetadataHeader)) / sizeof(FrameMetadataRecord);
+
+    int result = 0;
+    string command = argc > 2 ? argv[2] : "";
+
+    if (command.empty()) {
+        printSummary(records, count);
+    } else if (command == "--csv") {
+        printCsvHeader();
+        for (size_t i = 0; i < count; i++) {
+            printCsvRecord(records[i]);
+        }
+    } else if (command == "--at" && argc > 3 && count > 0) {
+        int64_t timestampUs = 0;
+        if (!parseLocalTime(argv[3], timestampUs)) {
+            cerr << "ERROR: Could not parse time: " << argv[3] << endl;
+            result = 1;
+        } else {
+            printCsvHeader();
+            printCsvRecord(records[findRecord(records, count, timestampUs)]);
+        }
+    } else if (command == "--range" && argc > 4 && count > 0) {
+        int64_t startUs = 0, endUs = 0;
+        if (!parseLocalTime(argv[3], startUs) || !parseLocalTime(argv[4], endUs)) {
+            cerr << "ERROR: Could not parse time range" << endl;
+            result = 1;
+        } else {
+            printCsvHeader();
+            for (size_t i = findRecord(records, count, startUs); i < count && records[i].captureTimeUs <= endUs; i++) {
+                if (records[i].captureTimeUs >= startUs) {
+                    printCsvRecord(records[i]);
+                }
+            }
+        }
+    } else {
+        printUsage(argv[0]);
+        result = 1;
+    }
+
+    munmap(mapping, fileSize);
+    return result;
+}
@@ -0,0 +1,205 @@
+// Tolerance test and benchmark of PreviewScaler against the OpenCV calls it
+// replaces: resize(INTER_LINEAR) and an addWeighted pass per translucent panel.
+
+#include "../src/preview_scaler.h"
+#include <opencv2/core/hal/intrin.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// The path the preview took before the fused kernel
+static void referenceScale(const Mat& src, Mat& dst, Size dstSize, const vector<PreviewTint>& tints) {
+    resize(src, dst, dstSize, 0, 0, INTER_LINEAR);
+    for (const PreviewTint& tint : tints) {
+        Rect area = tint.area & Rect(0, 0, dst.cols, dst.rows);
+        if (area.empty()) {
+            continue;
+        }
+        Mat roi = dst(area);
+        Mat panel(roi.size(), roi.type(), tint.color);
+        addWeighted(panel, tint.alpha, roi, 1.0 - tint.alpha, 0, roi);
+    }
+}
+
+// Allowed difference per pixel: one level for the scale, one more per covering tint
+static Mat toleranceMap(Size size, const vector<PreviewTint>& tints) {
+    Mat tolerance(size, CV_8UC1, Scalar(1));
+    for (const PreviewTint& tint : tints) {
+        Mat roi = tolerance(tint.area & Rect(Point(0, 0), size));
+        roi += Scalar(1);
+    }
+    return tolerance;
+}
+
+static bool checkCase(RNG& rng, Size srcSize, Size dstSize, const vector<PreviewTint>& tints) {
+    Mat src(srcSize, CV_8UC3);
+    rng.fill(src, RNG::UNIFORM, 0, 256);
+
+    PreviewScaler scaler;
+    Mat fused;
+    Mat reference;
+    scaler.scale(src, fused, dstSize, tints);
+    referenceScale(src, reference, dstSize, tints);
+
+    Mat difference;
+    absdiff(fused, reference, difference);
+    difference = difference.reshape(1, dstSize.height * dstSize.width);
+
+    // Per pixel maximum over the channels
+    Mat pixelDifference;
+    reduce(difference, pixelDifference, 1, REDUCE_MAX);
+    pixelDifference = pixelDifference.reshape(1, dstSize.height);
+
+    Mat tolerance = toleranceMap(dstSize, tints);
+    int failures = countNonZero(pixelDifference > tolerance);
+    double maxDifference = 0;
+    minMaxLoc(pixelDifference, nullptr, &maxDifference);
+    double meanDifference = mean(difference)[0];
+
+    bool passed = failures == 0 && meanDifference < 0.5;
+    cout << (passed ? "ok   " : "FAIL ") << srcSize.width << "x" << srcSize.height
+         << " -> " << dstSize.width << "x" << dstSize.height << ", " << tints.size() << " tints"
+         << ": max " << maxDifference << ", mean " << fixed << setprecision(3) << meanDifference
+         << defaultfloat;
+    if (failures) {
+        cout << ", " << failures << " pixels out of tolerance";
+    }
+    cout << endl;
+    return passed;
+}
+
+static bool runTests() {
+    RNG rng(0x5eed);
+    const Size cases[][2] = {
+        {Size(1920, 1080), Size(1280, 800)},    // Camera to the default window
+        {Size(1920, 1080), Size(1280, 720)},
+        {Size(1920, 1080), Size(800, 480)},
+        {Size(640, 480), Size(1280, 800)},      // Upscale
+        {Size(1281, 719), Size(333, 211)},      // Odd sizes, scalar tail
+        {Size(200, 150), Size(401, 3)},
+        {Size(1, 1), Size(17, 9)},
+    };
+
+    bool passed = true;
+    for (const auto& sizes : cases) {
+        Size dst = sizes[1];
+        vector<PreviewTint> tints;
+        passed &= checkCase(rng, sizes[0], dst, tints);
+
+        // The nav bar
+        tints.push_back({Rect(0, dst.height - dst.height / 8, dst.width, dst.height / 8), Scalar(20, 60, 20), 0.7});
+        passed &= checkCase(rng, sizes[0], dst, tints);
+
+        // Export dialog dimming over the nav bar, a bright panel with an uneven alpha
+        // and one partly outside the frame
+        tints.push_back({Rect(0, 0, dst.width, dst.height), Scalar(30, 30, 30), 0.7});
+        tints.push_back({Rect(dst.width / 5, dst.height / 4, dst.width / 3 + 1, dst.height / 2), Scalar(255, 200, 0), 0.33});
+        tints.push_back({Rect(-10, -10, dst.width / 2, dst.height / 2), Scalar(0, 0, 255), 0.5});
+        passed &= checkCase(rng, sizes[0], dst, tints);
+    }
+
+    // A sub-rectangle of the source into part of the destination, like the magnifier
+    Mat src(1080, 1920, CV_8UC3);
+    rng.fill(src, RNG::UNIFORM, 0, 256);
+    Rect srcRect(700, 400, 320, 180);
+    Rect dstRect(37, 21, 640, 360);
+    Mat fused(800, 1280, CV_8UC3, Scalar(1, 2, 3));
+    Mat reference = fused.clone();
+    PreviewScaler scaler;
+    scaler.scale(src, srcRect, fused, dstRect);
+    Mat target = reference(dstRect);
+    resize(src(srcRect), target, dstRect.size(), 0, 0, INTER_LINEAR);
+
+    Mat difference;
+    absdiff(fused, reference, difference);
+    double maxDifference = 0;
+    minMaxLoc(difference.reshape(1), nullptr, &maxDifference);
+    bool roiPassed = maxDifference <= 1;
+    cout << (roiPassed ? "ok   " : "FAIL ") << "source rect into destination rect: max " << maxDifference << endl;
+
+    return passed && roiPassed;
+}
+
+static void runBenchmark(int frames) {
+    RNG rng(0xbe7c);
+    Mat src(1080, 1920, CV_8UC3);
+    rng.fill(src, RNG::UNIFORM, 0, 256);
+    Size dst(1280, 800);
+
+    vector<PreviewTint> navBar = {{Rect(0, 700, 1280, 100), Scalar(20, 60, 20), 0.7}};
+    vector<PreviewTint> dialog = navBar;
+    dialog.push_back({Rect(0, 0, 1280, 800), Scalar(30, 30, 30), 0.7});
+
+    const pair<const char*, const vector<PreviewTint>*> cases[] = {
+        {"no panels", nullptr},
+        {"nav bar", &navBar},
+        {"nav bar + export dialog", &dialog},
+    };
+
+    cout << "1920x1080 -> 1280x800, " << frames << " frames, "
+         << getNumThreads() << " OpenCV threads, SIMD " << (CV_SIMD128 ? "on" : "off") << endl;
+
+    vector<PreviewTint> none;
+    PreviewScaler scaler;
+    Mat out;
+    for (const auto& benchCase : cases) {
+        const vector<PreviewTint>& tints = benchCase.second ? *benchCase.second : none;
+
+        // Warm up, allocations and lookup tables
+        scaler.scale(src, out, dst, tints);
+        referenceScale(src, out, dst, tints);
+
+        TickMeter fusedTime;
+        fusedTime.start();
+        for (int i = 0; i < frames; i++) {
+            scaler.scale(src, out, dst, tints);
+        }
+        fusedTime.stop();
+
+        TickMeter referenceTime;
+        referenceTime.start();
+        for (int i = 0; i < frames; i++) {
+            referenceScale(src, out, dst, tints);
+        }
+        referenceTime.stop();
+
+        double fusedMs = fusedTime.getTimeMilli() / frames;
+        double referenceMs = referenceTime.getTimeMilli() / frames;
+        cout << fixed << setprecision(3) << "  " << benchCase.first << ": fused " << fusedMs
+             << " ms, resize + addWeighted " << referenceMs << " ms ("
+             << setprecision(2) << referenceMs / fusedMs << "x)" << defaultfloat << endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool test = true;
+    bool bench = true;
+    int frames = 200;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--test") {
+            bench = false;
+        } else if (arg == "--bench") {
+            test = false;
+            if (i + 1 < argc) {
+                frames = max(1, atoi(argv[++i]));
+            }
+        } else {
+            cerr << "Usage: " << argv[0] << " [--test | --bench [frames]]" << endl;
+            return 2;
+        }
+    }
+
+    bool passed = true;
+    if (test) {
+        passed = runTests();
+        cout << (passed ? "All cases within tolerance" : "Tolerance test FAILED") << endl;
+    }
+    if (bench) {
+        runBenchmark(frames);
+    }
+    return passed ? 0 : 1;
+}
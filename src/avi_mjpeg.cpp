@@ -0,0 +1,572 @@
+#include "avi_mjpeg.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Start a new RIFF segment once the current one reaches this size
+static const uint64_t SEGMENT_LIMIT = 1000ULL * 1024 * 1024;
+// Super index slots reserved in the header (1 GB each)
+static const uint32_t MAX_SEGMENTS = 1024;
+static const uint32_t AVIF_HASINDEX = 0x10;
+static const uint32_t AVIIF_KEYFRAME = 0x10;
+
+static void writeU16(FILE* f, uint16_t v) {
+    uint8_t b[2] = {uint8_t(v), uint8_t(v >> 8)};
+    fwrite(b, 1, 2, f);
+}
+
+static void writeU32(FILE* f, uint32_t v) {
+    uint8_t b[4] = {uint8_t(v), uint8_t(v >> 8), uint8_t(v >> 16), uint8_t(v >> 24)};
+    fwrite(b, 1, 4, f);
+}
+
+static void writeU64(FILE* f, uint64_t v) {
+    writeU32(f, uint32_t(v));
+    writeU32(f, uint32_t(v >> 32));
+}
+
+static void writeFourCC(FILE* f, const char* cc) {
+    fwrite(cc, 1, 4, f);
+}
+
+static uint64_t tell(FILE* f) {
+    return static_cast<uint64_t>(ftello(f));
+}
+
+static void patchU32(FILE* f, uint64_t pos, uint32_t v) {
+    uint64_t current = tell(f);
+    fseeko(f, static_cast<off_t>(pos), SEEK_SET);
+    writeU32(f, v);
+    fseeko(f, static_cast<off_t>(current), SEEK_SET);
+}
+
+static uint16_t readU16(const uint8_t* p) {
+    return uint16_t(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static uint64_t readU64(const uint8_t* p) {
+    return uint64_t(readU32(p)) | (uint64_t(readU32(p + 4)) << 32);
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+// ---------------------------------------------------------------------------
+
+AviMjpegWriter::AviMjpegWriter()
+    : file(nullptr), frameWidth(0), frameHeight(0), frameRate(30.0), totalFrames(0), maxFrameSize(0),
+      avihPos(0), strhPos(0), indxPos(0), dmlhPos(0), riffPos(0), moviPos(0),
+      firstSegment(true), firstSegmentFrames(0) {
+}
+
+AviMjpegWriter::~AviMjpegWriter() {
+    close();
+}
+
+bool AviMjpegWriter::open(const string& path, int width, int height, double fps) {
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    frameWidth = width;
+    frameHeight = height;
+    frameRate = fps > 0 ? fps : 30.0;
+    totalFrames = 0;
+    maxFrameSize = 0;
+    firstSegment = true;
+    firstSegmentFrames = 0;
+    segmentFrames.clear();
+    legacyIndex.clear();
+    superIndex.clear();
+
+    writeHeaders();
+    return true;
+}
+
+void AviMjpegWriter::writeHeaders() {
+    uint32_t microSecPerFrame = static_cast<uint32_t>(lround(1000000.0 / frameRate));
+    uint32_t rate = static_cast<uint32_t>(lround(frameRate * 1000.0));
+
+    riffPos = 0;
+    writeFourCC(file, "RIFF");
+    writeU32(file, 0);
+    writeFourCC(file, "AVI ");
+
+    uint64_t hdrlPos = tell(file);
+    writeFourCC(file, "LIST");
+    writeU32(file, 0);
+    writeFourCC(file, "hdrl");
+
+    // Main AVI header
+    writeFourCC(file, "avih");
+    writeU32(file, 56);
+    avihPos = tell(file);
+    writeU32(file, microSecPerFrame);
+    writeU32(file, 0);                // dwMaxBytesPerSec
+    writeU32(file, 0);                // dwPaddingGranularity
+    writeU32(file, AVIF_HASINDEX);    // dwFlags
+    writeU32(file, 0);                // dwTotalFrames (first segment)
+    writeU32(file, 0);                // dwInitialFrames
+    writeU32(file, 1);                // dwStreams
+    writeU32(file, 0);                // dwSuggestedBufferSize
+    writeU32(file, frameWidth);
+    writeU32(file, frameHeight);
+    for (int i = 0; i < 4; i++) writeU32(file, 0);
+
+    uint64_t strlPos = tell(file);
+    writeFourCC(file, "LIST");
+    writeU32(file, 0);
+    writeFourCC(file, "strl");
+
+    // Stream header
+    writeFourCC(file, "strh");
+    writeU32(file, 56);
+    strhPos = tell(file);
+    writeFourCC(file, "vids");
+    writeFourCC(file, "MJPG");
+    writeU32(file, 0);                // dwFlags
+    writeU16(file, 0);                // wPriority
+    writeU16(file, 0);                // wLanguage
+    writeU32(file, 0);                // dwInitialFrames
+    writeU32(file, 1000);             // dwScale
+    writeU32(file, rate);             // dwRate
+    writeU32(file, 0);                // dwStart
+    writeU32(file, 0);                // dwLength
+    writeU32(file, 0);                // dwSuggestedBufferSize
+    writeU32(file, 0xFFFFFFFF);       // dwQuality
+    writeU32(file, 0);                // dwSampleSize
+    writeU16(file, 0);
+    writeU16(file, 0);
+    writeU16(file, static_cast<uint16_t>(frameWidth));
+    writeU16(file, static_cast<uint16_t>(frameHeight));
+
+    // Stream format
+    writeFourCC(file, "strf");
+    writeU32(file, 40);
+    writeU32(file, 40);
+    writeU32(file, frameWidth);
+    writeU32(file, frameHeight);
+    writeU16(file, 1);
+    writeU16(file, 24);
+    writeFourCC(file, "MJPG");
+    writeU32(file, frameWidth * frameHeight * 3);
+    for (int i = 0; i < 4; i++) writeU32(file, 0);
+
+    // OpenDML super index, entries are filled in on close
+    writeFourCC(file, "indx");
+    writeU32(file, 24 + 16 * MAX_SEGMENTS);
+    indxPos = tell(file);
+    writeU16(file, 4);                // wLongsPerEntry
+    fputc(0, file);                   // bIndexSubType
+    fputc(0, file);                   // bIndexType (AVI_INDEX_OF_INDEXES)
+    writeU32(file, 0);                // nEntriesInUse
+    writeFourCC(file, "00dc");
+    for (int i = 0; i < 3; i++) writeU32(file, 0);
+    vector<uint8_t> emptyEntries(16 * MAX_SEGMENTS, 0);
+    fwrite(emptyEntries.data(), 1, emptyEntries.size(), file);
+
+    patchU32(file, strlPos + 4, static_cast<uint32_t>(tell(file) - strlPos - 8));
+
+    // Extended header with the real total frame count
+    uint64_t odmlPos = tell(file);
+    writeFourCC(file, "LIST");
+    writeU32(file, 0);
+    writeFourCC(file, "odml");
+    writeFourCC(file, "dmlh");
+    writeU32(file, 248);
+    dmlhPos = tell(file);
+    vector<uint8_t> dmlh(248, 0);
+    fwrite(dmlh.data(), 1, dmlh.size(), file);
+    patchU32(file, odmlPos + 4, static_cast<uint32_t>(tell(file) - odmlPos - 8));
+
+    patchU32(file, hdrlPos + 4, static_cast<uint32_t>(tell(file) - hdrlPos - 8));
+
+    moviPos = tell(file);
+    writeFourCC(file, "LIST");
+    writeU32(file, 0);
+    writeFourCC(file, "movi");
+}
+
+void AviMjpegWriter::beginSegment() {
+    firstSegment = false;
+
+    riffPos = tell(file);
+    writeFourCC(file, "RIFF");
+    writeU32(file, 0);
+    writeFourCC(file, "AVIX");
+
+    moviPos = tell(file);
+    writeFourCC(file, "LIST");
+    writeU32(file, 0);
+    writeFourCC(file, "movi");
+}
+
+void AviMjpegWriter::finishSegment() {
+    // Standard index for the frames in this segment
+    uint64_t ixPos = tell(file);
+    uint32_t entries = static_cast<uint32_t>(segmentFrames.size());
+    uint64_t baseOffset = moviPos;
+
+    writeFourCC(file, "ix00");
+    writeU32(file, 24 + 8 * entries);
+    writeU16(file, 2);                // wLongsPerEntry
+    fputc(0, file);                   // bIndexSubType
+    fputc(1, file);                   // bIndexType (AVI_INDEX_OF_CHUNKS)
+    writeU32(file, entries);
+    writeFourCC(file, "00dc");
+    writeU64(file, baseOffset);
+    writeU32(file, 0);
+    for (const AviFrameEntry& entry : segmentFrames) {
+        writeU32(file, static_cast<uint32_t>(entry.offset - baseOffset));
+        writeU32(file, entry.size);   // Bit 31 clear: every MJPEG frame is a keyframe
+    }
+    superIndex.push_back({ixPos, 8 + 24 + 8 * entries, entries});
+
+    patchU32(file, moviPos + 4, static_cast<uint32_t>(tell(file) - moviPos - 8));
+
+    // Legacy index for AVI 1.0 readers, first segment only
+    if (riffPos == 0) {
+        uint64_t moviFourCCPos = moviPos + 8;
+        writeFourCC(file, "idx1");
+        writeU32(file, 16 * static_cast<uint32_t>(legacyIndex.size()));
+        for (const AviFrameEntry& entry : legacyIndex) {
+            writeFourCC(file, "00dc");
+            writeU32(file, AVIIF_KEYFRAME);
+            writeU32(file, static_cast<uint32_t>(entry.offset - 8 - moviFourCCPos));
+            writeU32(file, entry.size);
+        }
+        firstSegmentFrames = static_cast<uint32_t>(legacyIndex.size());
+        legacyIndex.clear();
+    }
+
+    patchU32(file, riffPos + 4, static_cast<uint32_t>(tell(file) - riffPos - 8));
+    segmentFrames.clear();
+}
+
+bool AviMjpegWriter::writeFrame(const uint8_t* data, size_t size) {
+    if (!file) {
+        return false;
+    }
+
+    // Roll over to a new RIFF segment before this one grows too large
+    if (tell(file) - riffPos + size + 8 > SEGMENT_LIMIT && !segmentFrames.empty()) {
+        if (superIndex.size() + 1 >= MAX_SEGMENTS) {
+            return false;
+        }
+        finishSegment();
+        beginSegment();
+    }
+
+    writeFourCC(file, "00dc");
+    writeU32(file, static_cast<uint32_t>(size));
+    uint64_t dataPos = tell(file);
+    if (fwrite(data, 1, size, file) != size) {
+        return false;
+    }
+    if (size & 1) {
+        fputc(0, file);
+    }
+
+    AviFrameEntry entry = {dataPos, static_cast<uint32_t>(size)};
+    segmentFrames.push_back(entry);
+    if (firstSegment) {
+        legacyIndex.push_back(entry);
+    }
+
+    totalFrames++;
+    maxFrameSize = max(maxFrameSize, static_cast<uint32_t>(size));
+    return true;
+}
+
+bool AviMjpegWriter::close() {
+    if (!file) {
+        return false;
+    }
+
+    finishSegment();
+
+    patchU32(file, avihPos + 4, static_cast<uint32_t>(min(4294967295.0, maxFrameSize * frameRate)));
+    patchU32(file, avihPos + 16, firstSegmentFrames);
+    patchU32(file, avihPos + 28, maxFrameSize);
+    patchU32(file, strhPos + 32, totalFrames);
+    patchU32(file, strhPos + 36, maxFrameSize);
+    patchU32(file, dmlhPos, totalFrames);
+
+    // Fill in the super index
+    patchU32(file, indxPos + 4, static_cast<uint32_t>(superIndex.size()));
+    fseeko(file, static_cast<off_t>(indxPos + 24), SEEK_SET);
+    for (const SuperIndexEntry& entry : superIndex) {
+        writeU64(file, entry.offset);
+        writeU32(file, entry.size);
+        writeU32(file, entry.duration);
+    }
+
+    bool ok = fflush(file) == 0;
+    ok = (fclose(file) == 0) && ok;
+    file = nullptr;
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Reader
+// ---------------------------------------------------------------------------
+
+AviMjpegReader::AviMjpegReader()
+    : file(nullptr), fileSize(0), frameRate(30.0), frameWidth(0), frameHeight(0) {
+}
+
+AviMjpegReader::~AviMjpegReader() {
+    close();
+}
+
+void AviMjpegReader::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    frames.clear();
+}
+
+double AviMjpegReader::durationSeconds() const {
+    return frameRate > 0 ? frames.size() / frameRate : 0.0;
+}
+
+bool AviMjpegReader::open(const string& path) {
+    close();
+
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+        close();
+        return false;
+    }
+    fileSize = static_cast<uint64_t>(st.st_size);
+
+    uint8_t header[12];
+    if (fread(header, 1, 12, file) != 12 || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "AVI ", 4) != 0) {
+        close();
+        return false;
+    }
+
+    uint64_t riffEnd = min(fileSize, 8 + static_cast<uint64_t>(readU32(header + 4)));
+    uint64_t moviPos = 0, moviEnd = 0, idx1Pos = 0;
+    uint32_t idx1Size = 0;
+    vector<uint64_t> superIndexOffsets;
+
+    if (!parseRiff(12, riffEnd, moviPos, moviEnd, idx1Pos, idx1Size, superIndexOffsets)) {
+        close();
+        return false;
+    }
+
+    // Prefer the OpenDML indexes, they cover every RIFF segment
+    bool indexed = false;
+    if (!superIndexOffsets.empty()) {
+        indexed = true;
+        for (uint64_t offset : superIndexOffsets) {
+            if (!readStandardIndex(offset)) {
+                indexed = false;
+                frames.clear();
+                break;
+            }
+        }
+    }
+
+    if (!indexed && idx1Pos > 0) {
+        indexed = readLegacyIndex(idx1Pos, idx1Size, moviPos);
+    }
+
+    // Unindexed (e.g. truncated) file, fall back to walking the chunks
+    if (!indexed && moviPos > 0) {
+        frames.clear();
+        scanMovi(moviPos + 12, moviEnd);
+    }
+
+    return !frames.empty();
+}
+
+bool AviMjpegReader::parseRiff(uint64_t pos, uint64_t end, uint64_t& moviPos, uint64_t& moviEnd,
+                               uint64_t& idx1Pos, uint32_t& idx1Size, vector<uint64_t>& superIndexOffsets) {
+    bool inVideoStream = false;
+    bool haveVideoStream = false;
+
+    while (pos + 8 <= end) {
+        uint8_t chunk[12];
+        fseeko(file, static_cast<off_t>(pos), SEEK_SET);
+        if (fread(chunk, 1, 8, file) != 8) {
+            break;
+        }
+        uint32_t size = readU32(chunk + 4);
+        uint64_t next = pos + 8 + size + (size & 1);
+
+        if (memcmp(chunk, "LIST", 4) == 0) {
+            if (fread(chunk + 8, 1, 4, file) != 4) {
+                break;
+            }
+            if (memcmp(chunk + 8, "movi", 4) == 0) {
+                moviPos = pos;
+                moviEnd = min(end, pos + 8 + size);
+            } else if (memcmp(chunk + 8, "hdrl", 4) == 0 || memcmp(chunk + 8, "odml", 4) == 0) {
+                // Descend into the header list, next chunk is its first child
+                next = pos + 12;
+            } else if (memcmp(chunk + 8, "strl", 4) == 0) {
+                inVideoStream = false;
+                next = pos + 12;
+            }
+        } else if (memcmp(chunk, "avih", 4) == 0 && size >= 40) {
+            uint8_t avih[56];
+            if (fread(avih, 1, min<uint32_t>(size, 56), file) >= 40) {
+                frameWidth = static_cast<int>(readU32(avih + 32));
+                frameHeight = static_cast<int>(readU32(avih + 36));
+                uint32_t microSecPerFrame = readU32(avih);
+                if (microSecPerFrame > 0) {
+                    frameRate = 1000000.0 / microSecPerFrame;
+                }
+            }
+        } else if (memcmp(chunk, "strh", 4) == 0 && size >= 24) {
+            uint8_t strh[56];
+            if (fread(strh, 1, min<uint32_t>(size, 56), file) >= 24 &&
+                memcmp(strh, "vids", 4) == 0 && !haveVideoStream) {
+                inVideoStream = true;
+                haveVideoStream = true;
+                uint32_t scale = readU32(strh + 20);
+                uint32_t rate = readU32(strh + 24);
+                if (scale > 0 && rate > 0) {
+                    frameRate = static_cast<double>(rate) / scale;
+                }
+            }
+        } else if (memcmp(chunk, "indx", 4) == 0 && inVideoStream && size >= 24) {
+            vector<uint8_t> indx(size);
+            if (fread(indx.data(), 1, size, file) == size && indx[3] == 0) {
+                uint32_t entries = readU32(indx.data() + 4);
+                for (uint32_t i = 0; i < entries && 24 + 16 * (i + 1) <= size; i++) {
+                    superIndexOffsets.push_back(readU64(indx.data() + 24 + 16 * i));
+                }
+            }
+        } else if (memcmp(chunk, "idx1", 4) == 0) {
+            idx1Pos = pos + 8;
+            idx1Size = size;
+        }
+
+        pos = next;
+    }
+
+    return moviPos > 0;
+}
+
+bool AviMjpegReader::readStandardIndex(uint64_t pos) {
+    uint8_t header[32];
+    fseeko(file, static_cast<off_t>(pos), SEEK_SET);
+    if (fread(header, 1, 32, file) != 32 || readU16(header + 8) != 2 || header[11] != 1) {
+        return false;
+    }
+
+    uint32_t entries = readU32(header + 12);
+    uint64_t baseOffset = readU64(header + 20);
+
+    vector<uint8_t> data(static_cast<size_t>(entries) * 8);
+    if (fread(data.data(), 1, data.size(), file) != data.size()) {
+        return false;
+    }
+
+    frames.reserve(frames.size() + entries);
+    for (uint32_t i = 0; i < entries; i++) {
+        uint32_t offset = readU32(data.data() + 8 * i);
+        uint32_t size = readU32(data.data() + 8 * i + 4) & 0x7FFFFFFF;
+
+        // A zero-sized entry repeats the previous frame to keep the timing
+        if (size == 0) {
+            if (!frames.empty()) {
+                frames.push_back(frames.back());
+            }
+            continue;
+        }
+        frames.push_back({baseOffset + offset, size});
+    }
+    return true;
+}
+
+bool AviMjpegReader::readLegacyIndex(uint64_t pos, uint32_t size, uint64_t moviPos) {
+    vector<uint8_t> data(size);
+    fseeko(file, static_cast<off_t>(pos), SEEK_SET);
+    if (fread(data.data(), 1, size, file) != size) {
+        return false;
+    }
+
+    // Offsets are normally relative to the 'movi' fourcc, some writers use absolute offsets
+    uint64_t base = moviPos + 8;
+    bool baseChecked = false;
+
+    for (uint32_t i = 0; i + 16 <= size; i += 16) {
+        const uint8_t* entry = data.data() + i;
+        if (entry[0] != '0' || entry[1] != '0' || entry[2] != 'd' || (entry[3] != 'c' && entry[3] != 'b')) {
+            continue;
+        }
+
+        uint32_t offset = readU32(entry + 8);
+        uint32_t chunkSize = readU32(entry + 12);
+
+        if (!baseChecked) {
+            uint8_t id[4];
+            fseeko(file, static_cast<off_t>(offset), SEEK_SET);
+            if (fread(id, 1, 4, file) == 4 && memcmp(id, entry, 4) == 0) {
+                base = 0;
+            }
+            baseChecked = true;
+        }
+
+        if (chunkSize == 0) {
+            if (!frames.empty()) {
+                frames.push_back(frames.back());
+            }
+            continue;
+        }
+        frames.push_back({base + offset + 8, chunkSize});
+    }
+
+    return !frames.empty();
+}
+
+void AviMjpegReader::scanMovi(uint64_t pos, uint64_t end) {
+    while (pos + 8 <= end) {
+        uint8_t chunk[12];
+        fseeko(file, static_cast<off_t>(pos), SEEK_SET);
+        if (fread(chunk, 1, 8, file) != 8) {
+            break;
+        }
+        uint32_t size = readU32(chunk + 4);
+
+        if (memcmp(chunk, "LIST", 4) == 0) {
+            // 'rec ' lists group chunks, walk into them
+            scanMovi(pos + 12, min(end, pos + 8 + size));
+        } else if (chunk[0] == '0' && chunk[1] == '0' && chunk[2] == 'd' && (chunk[3] == 'c' || chunk[3] == 'b')) {
+            if (size > 0 && pos + 8 + size <= fileSize) {
+                frames.push_back({pos + 8, size});
+            }
+        }
+
+        pos += 8 + size + (size & 1);
+    }
+}
+
+bool AviMjpegReader::readFrame(size_t index, vector<uint8_t>& data) {
+    if (!file || index >= frames.size()) {
+        return false;
+    }
+
+    const AviFrameEntry& entry = frames[index];
+    data.resize(entry.size);
+    fseeko(file, static_cast<off_t>(entry.offset), SEEK_SET);
+    return fread(data.data(), 1, entry.size, file) == entry.size;
+}
@@ -0,0 +1,104 @@
+#ifndef AVI_MJPEG_H
+#define AVI_MJPEG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Location of one compressed frame inside an AVI file
+struct AviFrameEntry {
+    uint64_t offset;   // Absolute file offset of the frame data (after the chunk header)
+    uint32_t size;     // Size of the frame data in bytes
+};
+
+// Writes already-encoded JPEG frames into an MJPEG AVI without re-encoding.
+// Uses OpenDML (AVI 2.0) extended RIFF segments and indexes so files can grow
+// past the 1 GB / 4 GB limits of plain AVI, and also writes a legacy idx1
+// index for the first segment so older players can still open them.
+class AviMjpegWriter {
+public:
+    AviMjpegWriter();
+    ~AviMjpegWriter();
+
+    bool open(const string& path, int width, int height, double fps);
+    bool writeFrame(const uint8_t* data, size_t size);
+    bool close();
+
+    bool isOpened() const { return file != nullptr; }
+    uint32_t frameCount() const { return totalFrames; }
+
+private:
+    FILE* file;
+    int frameWidth;
+    int frameHeight;
+    double frameRate;
+    uint32_t totalFrames;
+    uint32_t maxFrameSize;
+
+    // Offsets of header fields that are patched on close
+    uint64_t avihPos;
+    uint64_t strhPos;
+    uint64_t indxPos;
+    uint64_t dmlhPos;
+
+    // Current RIFF segment
+    uint64_t riffPos;
+    uint64_t moviPos;
+    bool firstSegment;
+    vector<AviFrameEntry> segmentFrames;
+    uint32_t firstSegmentFrames;
+    vector<AviFrameEntry> legacyIndex;
+
+    // Super index entries, one per segment
+    struct SuperIndexEntry {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t duration;
+    };
+    vector<SuperIndexEntry> superIndex;
+
+    void writeHeaders();
+    void beginSegment();
+    void finishSegment();
+};
+
+// Reads the frame index of an MJPEG AVI from its OpenDML indexes or idx1,
+// so frames can be located and copied without scanning the file.
+class AviMjpegReader {
+public:
+    AviMjpegReader();
+    ~AviMjpegReader();
+
+    bool open(const string& path);
+    void close();
+
+    bool isOpened() const { return file != nullptr; }
+    size_t frameCount() const { return frames.size(); }
+    double fps() const { return frameRate; }
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    double durationSeconds() const;
+    const AviFrameEntry& frame(size_t index) const { return frames[index]; }
+
+    // Read the compressed data of one frame
+    bool readFrame(size_t index, vector<uint8_t>& data);
+
+private:
+    FILE* file;
+    uint64_t fileSize;
+    double frameRate;
+    int frameWidth;
+    int frameHeight;
+    vector<AviFrameEntry> frames;
+
+    bool parseRiff(uint64_t pos, uint64_t end, uint64_t& moviPos, uint64_t& moviEnd,
+                   uint64_t& idx1Pos, uint32_t& idx1Size, vector<uint64_t>& superIndexOffsets);
+    bool readStandardIndex(uint64_t pos);
+    bool readLegacyIndex(uint64_t pos, uint32_t size, uint64_t moviPos);
+    void scanMovi(uint64_t pos, uint64_t end);
+};
+
+#endif // AVI_MJPEG_H
@@ -1,4 +1,20 @@
 #include "camera.h"
+#include "recording.h"
+#include "text_overlay.h"
+#include "metrics.h"
+#include "exposure_meter.h"
+#include "perf_hud.h"
+
+static thread captureThread;
+static atomic<bool> captureThreadActive(false);
+static atomic<bool> captureOk(false);
+static atomic<double> averageCaptureFps(0.0);
+
+// Newest frame for the UI, guarded by frameMutex
+static Mat latestFrame;
+static OverlayLine latestOverlay;
+static uint64_t latestSequence = 0;
+static Size latestFrameSize;
 
 double calculateFPS(system_clock::time_point& previousFrameTime) {
     auto currentFrameTime = system_clock::now();
@@ -53,3 +69,131 @@ void cameraConfig(VideoCapture* cap) {
     cout << "Camera FPS: " << cap->get(CAP_PROP_FPS) << endl;
     return;
 }
+
+static void captureLoop(VideoCapture* cap) {
+    system_clock::time_point previousFrameTime = system_clock::now();
+    Mat frame;
+    uint64_t sequence = 0;
+    deque<double> fpsHistory;
+    bool isFirstFrame = true;
+    bool exposureMeter = appConfig.getBool("EXPOSURE_METER", true);
+    int exposureRowStep = appConfig.getInt("EXPOSURE_ROW_STEP", 4);
+    int exposurePixelBudget = appConfig.getInt("EXPOSURE_PIXEL_BUDGET", 65536);
+    setCurrentThreadName("capture");
+
+    while (captureThreadActive) {
+        steady_clock::time_point readStart = steady_clock::now();
+        bool frameRead = cap->read(frame);
+        system_clock::time_point captureTime = system_clock::now();
+        recordStageTime(STAGE_CAPTURE, duration<double, milli>(steady_clock::now() - readStart).count());
+        if (!frameRead || frame.empty()) {
+            cerr << "ERROR: Unable to grab from the camera" << endl;
+            setLogMessage("Error");
+            break;
+        }
+
+        // Calculate FPS
+        double currentFPS = calculateFPS(previousFrameTime);
+
+        // Update FPS history
+        fpsHistory.push_back(currentFPS);
+        if (fpsHistory.size() > static_cast<size_t>(FPS_HISTORY_SIZE)) {
+            fpsHistory.pop_front();
+        }
+
+        // Calculate average FPS from history
+        double avgFPS = 0;
+        for (const auto& fps : fpsHistory) {
+            avgFPS += fps;
+        }
+        avgFPS = avgFPS / fpsHistory.size();
+        averageCaptureFps = avgFPS;
+        setMetric("capture_fps", avgFPS);
+
+        // Publish the frame size on the first successful capture
+        if (isFirstFrame) {
+            {
+                lock_guard<mutex> lock(frameMutex);
+                latestFrameSize = frame.size();
+            }
+            isFirstFrame = false;
+            cout << "Actual frame size: " << frame.cols << "x" << frame.rows << endl;
+        }
+
+        // Initialize the writers if recording is requested and not yet initialized
+        if (isRecording && !recordingStreamsOpen()) {
+            if (openRecordingStreams(frame.size())) {
+                setLogMessage("Recording...");
+            } else if (isRecording) {
+                isRecording = false;
+                setLogMessage("Error");
+            }
+        }
+
+        // Date, time and FPS in a single line, shared by the preview and the recording
+        OverlayLine overlay;
+        formatOverlayLine(overlay, captureTime, showFPS ? int(avgFPS) : -1);
+
+        // Every captured frame goes to the recording, whatever the UI renders
+        if (isRecording && recordingStreamsOpen()) {
+            enqueueRecordingFrame(frame, overlay, captureTime, avgFPS);
+        }
+
+        // A bounded slice of the exposure histogram per frame
+        if (exposureMeter) {
+            updateExposureMeter(frame, exposureRowStep, exposurePixelBudget);
+        }
+
+        // Publish by swapping buffers, the UI picks up whichever frame is newest
+        {
+            lock_guard<mutex> lock(frameMutex);
+            swap(frame, latestFrame);
+            latestOverlay = overlay;
+            latestSequence = ++sequence;
+        }
+    }
+
+    captureOk = false;
+}
+
+void startCaptureThread(VideoCapture* cap) {
+    if (captureThreadActive) {
+        return;
+    }
+
+    captureOk = true;
+    captureThreadActive = true;
+    captureThread = thread(captureLoop, cap);
+}
+
+void stopCaptureThread() {
+    captureThreadActive = false;
+    if (captureThread.joinable()) {
+        captureThread.join();
+    }
+}
+
+bool captureRunning() {
+    return captureOk;
+}
+
+bool takeLatestFrame(Mat& frame, OverlayLine& overlay, uint64_t& lastSequence) {
+    lock_guard<mutex> lock(frameMutex);
+    if (latestSequence == lastSequence || latestFrame.empty()) {
+        return false;
+    }
+
+    swap(frame, latestFrame);
+    overlay = latestOverlay;
+    lastSequence = latestSequence;
+    return true;
+}
+
+Size capturedFrameSize() {
+    lock_guard<mutex> lock(frameMutex);
+    return latestFrameSize;
+}
+
+double captureFps() {
+    return averageCaptureFps;
+}
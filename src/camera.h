@@ -15,4 +15,24 @@ string getCurrentTimeStr();
 // Get current date as string
 string getCurrentDateStr();
 
+// Start the capture thread. It reads every camera frame, feeds the recording
+// and publishes the newest frame for the UI, independent of the render rate.
+void startCaptureThread(VideoCapture* cap);
+
+// Stop the capture thread and wait for it
+void stopCaptureThread();
+
+// False once the camera stopped delivering frames
+bool captureRunning();
+
+// Swap in the newest captured frame if it is newer than lastSequence.
+// Buffers are swapped, never copied, so stale frames are simply skipped.
+bool takeLatestFrame(Mat& frame, OverlayLine& overlay, uint64_t& lastSequence);
+
+// Size of the camera frames, empty until the first frame was captured
+Size capturedFrameSize();
+
+// Average capture rate over the last FPS_HISTORY_SIZE frames
+double captureFps();
+
 #endif // CAMERA_H
@@ -0,0 +1,101 @@
+#include "clip_export.h"
+
+bool probeRecording(const string& path, ClipInfo& info) {
+    RecordingSource source;
+    if (!source.open(path)) {
+        return false;
+    }
+    info.frameCount = source.frameCount();
+    info.fps = source.fps();
+    return true;
+}
+
+bool exportClip(const string& srcPath, const string& aviPath, size_t firstFrame, size_t lastFrame) {
+    return joinClips({{srcPath, firstFrame, lastFrame}}, aviPath);
+}
+
+bool joinClips(const vector<ClipRange>& clips, const string& aviPath) {
+    if (clips.empty()) {
+        return false;
+    }
+
+    // Check every input first so a bad file doesn't leave a half written output
+    size_t totalFrames = 0;
+    double totalSeconds = 0;
+    Size size;
+
+    for (const ClipRange& clip : clips) {
+        RecordingSource source;
+        if (!source.open(clip.path)) {
+            cerr << "ERROR: Could not read index of " << clip.path << endl;
+            return false;
+        }
+        if (clip.firstFrame > clip.lastFrame || clip.lastFrame >= source.frameCount()) {
+            cerr << "ERROR: Clip range outside of " << clip.path << endl;
+            return false;
+        }
+        if (size.area() == 0) {
+            size = source.frameSize();
+        } else if (source.frameSize() != size) {
+            cerr << "ERROR: Frame size of " << clip.path << " differs from the first recording" << endl;
+            return false;
+        }
+
+        size_t frames = clip.lastFrame - clip.firstFrame + 1;
+        totalFrames += frames;
+        totalSeconds += frames / source.fps();
+    }
+
+    // One frame rate over the whole output keeps the timestamps continuous
+    // across the joins and the total duration equal to the recorded time
+    AviMjpegWriter writer;
+    if (!writer.open(aviPath, size.width, size.height, totalSeconds > 0 ? totalFrames / totalSeconds : 30.0)) {
+        cerr << "ERROR: Could not create AVI: " << aviPath << endl;
+        return false;
+    }
+
+    // Every MJPEG frame is a keyframe, so frames are copied straight from the
+    // index and only one compressed frame is held in memory at a time
+    progressValue = 0;
+    vector<uint8_t> frameData;
+    size_t written = 0;
+
+    for (const ClipRange& clip : clips) {
+        RecordingSource source;
+        if (!source.open(clip.path)) {
+            cerr << "ERROR: Could not read index of " << clip.path << endl;
+            writer.close();
+            remove(aviPath.c_str());
+            return false;
+        }
+
+        for (size_t i = clip.firstFrame; i <= clip.lastFrame; i++) {
+            // Shutting down, don't leave a partial file behind
+            if (!isProcessing) {
+                cerr << "Export cancelled: " << aviPath << endl;
+                writer.close();
+                remove(aviPath.c_str());
+                return false;
+            }
+            if (!source.readFrame(i, frameData) || !writer.writeFrame(frameData.data(), frameData.size())) {
+                cerr << "ERROR: Failed to copy frame " << i << " of " << clip.path << endl;
+                writer.close();
+                remove(aviPath.c_str());
+                return false;
+            }
+            progressValue = static_cast<int>(++written * 99 / totalFrames);
+        }
+    }
+
+    bool ok = writer.close();
+    progressValue = 100;
+    return ok;
+}
+
+string formatClipTime(size_t frame, double fps) {
+    long long totalMs = fps > 0 ? static_cast<long long>(frame * 1000.0 / fps + 0.5) : 0;
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld.%03lld",
+             totalMs / 3600000, (totalMs / 60000) % 60, (totalMs / 1000) % 60, totalMs % 1000);
+    return buffer;
+}
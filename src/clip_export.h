@@ -0,0 +1,62 @@
+#ifndef CLIP_EXPORT_H
+#define CLIP_EXPORT_H
+
+#include "common.h"
+#include "avi_mjpeg.h"
+#include "frame_store.h"
+
+// Indexed JPEG frames of either an MJPEG AVI or a frame store
+class RecordingSource {
+public:
+    bool open(const string& path) {
+        if (isFrameStoreFilename(path)) {
+            return store.open(frameStoreBasePath(path)) && store.frameCount() > 0;
+        }
+        return avi.open(path) && avi.frameCount() > 0;
+    }
+
+    size_t frameCount() const { return store.isOpened() ? store.frameCount() : avi.frameCount(); }
+    Size frameSize() const { return store.isOpened() ? store.frameSize() : Size(avi.width(), avi.height()); }
+
+    double fps() const {
+        double rate = store.isOpened() ? store.fps() : avi.fps();
+        return rate > 0 ? rate : 30.0;
+    }
+
+    bool readFrame(size_t index, vector<uint8_t>& data) {
+        return store.isOpened() ? store.readFrame(index, data) : avi.readFrame(index, data);
+    }
+
+private:
+    AviMjpegReader avi;
+    FrameStoreReader store;
+};
+
+// Frame count and rate of a recording, read from its index
+struct ClipInfo {
+    size_t frameCount;
+    double fps;
+};
+
+// Frames [firstFrame, lastFrame] of one recording
+struct ClipRange {
+    string path;
+    size_t firstFrame;
+    size_t lastFrame;
+};
+
+// Read the index of an MJPEG AVI or frame store without touching frame data
+bool probeRecording(const string& path, ClipInfo& info);
+
+// Copy frames [firstFrame, lastFrame] of an MJPEG AVI or frame store into a new
+// AVI without re-encoding, reporting progress through progressValue
+bool exportClip(const string& srcPath, const string& aviPath, size_t firstFrame, size_t lastFrame);
+
+// Join consecutive clips into one AVI with continuous timestamps. Frames are
+// copied one at a time without re-encoding, progress goes to progressValue.
+bool joinClips(const vector<ClipRange>& clips, const string& aviPath);
+
+// Format a frame position as "HH:MM:SS.mmm"
+string formatClipTime(size_t frame, double fps);
+
+#endif // CLIP_EXPORT_H
@@ -25,14 +25,37 @@ using namespace cv;
 using namespace std;
 using namespace chrono;
 
-extern queue<Mat> frameQueue;
+// Fixed-size overlay text line, so formatting and queuing it never allocates
+#define OVERLAY_TEXT_MAX 48
+struct OverlayLine {
+    char text[OVERLAY_TEXT_MAX] = {0};
+    size_t length = 0;
+};
+
+// A captured frame queued for the recording writer thread
+struct RecordingFrame {
+    Mat image;              // Full frame copy (empty when only ROI crops are recorded)
+    vector<Mat> crops;      // ROI crop copies
+    OverlayLine overlay;    // Date/time line burned into the recording
+    system_clock::time_point captureTime;
+    uint64_t sequence = 0;  // Capture sequence number within the recording
+
+    // Camera and pipeline state at capture time, for the metadata sidecar
+    int zoomLevel = 0;
+    uint16_t metadataFlags = 0;
+    double measuredFps = 0.0;
+    uint32_t detectorCount = 0;
+    float detectorScore = 0.0f;
+};
+
+extern queue<RecordingFrame> frameQueue;
 extern mutex queueMutex;
 extern condition_variable frameCondition;
 extern atomic<bool> recordingThreadActive;
 extern thread recordingThread;
 extern double recordingDurationSeconds;
 
-extern bool icrModeEnabled;
+extern atomic<bool> icrModeEnabled;
 extern bool irCorrectionEnabled;
 extern Rect icrButtonRect;
 extern Rect irCorrectionButtonRect;
@@ -45,24 +68,28 @@ extern string exportDestDir;
 extern vector<string> recordingFiles;
 extern vector<bool> fileSelection;
 extern bool keepOriginalFiles;
+extern bool exportProxiesOnly;
+extern bool exportJoinFiles;
+extern vector<int> trimStartFrames;
+extern vector<int> trimEndFrames;
+extern int trimFileIndex;
 extern int scrollOffset;
 extern const int maxFilesVisible;
 extern Rect fileListRect;
 extern Rect dirSelectRect;
 extern Rect keepFilesRect;
+extern Rect proxiesOnlyRect;
+extern Rect joinFilesRect;
 extern Rect exportConfirmRect;
 extern Rect exportCancelRect;
 extern Rect scrollUpRect;
 extern Rect scrollDownRect;
 
 // Global variables
-extern bool isRecording;
+extern atomic<bool> isRecording;
 extern VideoWriter videoWriter;
 extern string filename;
 extern string tempFilename;
-extern bool isFirstFrame;
-extern Size frameSize;
-extern deque<double> fpsHistory;
 extern const int FPS_HISTORY_SIZE;
 extern system_clock::time_point recordingStartTime;
 extern int WIDTH;
@@ -75,27 +102,25 @@ extern thread processingThread;
 extern atomic<bool> isProcessing;
 extern mutex frameMutex;
 
-extern atomic<bool> directoryDialogActive;
-extern mutex directoryResultMutex;
-extern string selectedDirectoryResult;
-extern bool directoryResultReady;
 
 // Zoom control variables
-extern int zoomLevel;
+extern atomic<int> zoomLevel;   // Also read by the capture thread
 extern int maxZoomLevel;
 extern Rect zoomInButtonRect;
 extern Rect zoomOutButtonRect;
-extern bool serialInitialized;
 
 // Button holding state variables
 extern bool isZoomInHeld;
 extern bool isZoomOutHeld;
-extern system_clock::time_point lastZoomTime;
+extern steady_clock::time_point lastZoomTime;
 extern int ZOOM_DELAY_MS;
 
 // Display options
 extern bool showFPS;
 
+// Running without a display, controlled through the control socket
+extern bool headlessMode;
+
 // Theme colors
 extern Scalar THEME_COLOR;
 extern Scalar PROGRESS_BAR_COLOR;
@@ -141,6 +166,7 @@ extern const int progressMax;
 // Log message
 extern string logMessage;
 extern mutex logMutex;
+extern atomic<uint64_t> logMessageVersion;   // Bumped whenever the message changes
 
 // Function to safely update log message
 void setLogMessage(const string& message);
@@ -6,14 +6,19 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <mutex>
+#include <shared_mutex>
 
 using namespace std;
 
-// Configuration class to handle loading and saving settings
+// Configuration class to handle loading and saving settings.
+// The UI thread reloads the file while capture and worker threads read
+// values, so the settings map is guarded by a reader/writer lock.
 class Config {
 private:
     string configFilePath;
     map<string, string> settings;
+    mutable shared_mutex settingsMutex;
 
 public:
 //    Config(const string& filePath = "/home/kng/Drip/config.ini") : configFilePath(filePath) {
@@ -21,8 +26,13 @@ public:
         loadConfig();
     }
 
+    // Switch to another config file and load it
+    bool loadConfig(const string& filePath) {
+        configFilePath = filePath;
+        return loadConfig();
+    }
+
     bool loadConfig() {
-        settings.clear();
         ifstream configFile(configFilePath);
 
         if (!configFile.is_open()) {
@@ -31,6 +41,8 @@ public:
             return false;
         }
 
+        // Parse into a new map and swap it in, readers never see a half loaded file
+        map<string, string> loaded;
         string line;
         while (getline(configFile, line)) {
             // Skip comments and empty lines
@@ -49,11 +61,14 @@ public:
                 value.erase(0, value.find_first_not_of(" \t"));
                 value.erase(value.find_last_not_of(" \t") + 1);
 
-                settings[key] = value;
+                loaded[key] = value;
             }
         }
 
         configFile.close();
+
+        unique_lock<shared_mutex> lock(settingsMutex);
+        settings.swap(loaded);
         return true;
     }
 
@@ -67,6 +82,7 @@ public:
         configFile << "# Water Dripping Investigation Recording Tools Configuration\n";
         configFile << "# Automatically generated - you can edit this file\n\n";
 
+        shared_lock<shared_mutex> lock(settingsMutex);
         for (const auto& setting : settings) {
             configFile << setting.first << " = " << setting.second << "\n";
         }
@@ -76,6 +92,9 @@ public:
     }
 
     void createDefaultConfig() {
+        unique_lock<shared_mutex> lock(settingsMutex);
+        settings.clear();
+
         // Set default values
         settings["DISPLAY_WIDTH"] = "1280";
         settings["DISPLAY_HEIGHT"] = "800";
@@ -87,13 +106,66 @@ public:
         settings["SHOW_FPS"] = "false";
         settings["SHOW_NAV_BAR"] = "true";
         settings["ZOOM_LEVEL"] = "512";
+        settings["VISCA_COMMAND_TIMEOUT_MS"] = "1000";
+        settings["VISCA_ZOOM_TIMEOUT_MS"] = "2000";
         settings["FULL_SCREEN"] = "true";
+        settings["DISPLAY_BACKEND"] = "auto";
+        settings["DISPLAY_MAX_FPS"] = "30";
+        settings["MAGNIFIER_WIDTH"] = "320";
+        settings["MAGNIFIER_HEIGHT"] = "240";
+        settings["MAGNIFIER_ZOOM"] = "4";
+        settings["OPTICAL_ZOOM_MAX"] = "30";
+        settings["EXPOSURE_METER"] = "true";
+        settings["EXPOSURE_ROW_STEP"] = "4";
+        settings["EXPOSURE_PIXEL_BUDGET"] = "65536";
+        settings["PERF_HUD"] = "false";
+        settings["HEADLESS"] = "false";
+        settings["HEADLESS_QUALITY_MAX"] = "98";
+        settings["CONTROL_SOCKET"] = "/tmp/drip_control.sock";
         settings["UPPERBOUND"] = "200";
         settings["LOWERBOUND"] = "0";
         settings["MIN_CONTOUR_AREA"] = "0";
         settings["MAX_CONTOUR_AREA"] = "300";
         settings["SHOW_BG_SUB_CONTROLS"] = "true";
         settings["CONSECUTIVE_FRAMES"] = "3";
+        settings["ROI_RECORDING"] = "true";
+        settings["ROI_SNAP_MACROBLOCK"] = "true";
+        settings["ROI_MACROBLOCK_SIZE"] = "16";
+        settings["ROI_MAX_COUNT"] = "4";
+        settings["PROXY_RECORDING"] = "false";
+        settings["PROXY_WIDTH"] = "320";
+        settings["PROXY_HEIGHT"] = "180";
+        settings["PROXY_JPEG_QUALITY"] = "40";
+        settings["PROXY_QUEUE_SIZE"] = "8";
+        settings["EXPORT_PROXIES_ONLY"] = "false";
+        settings["EXPORT_JOIN_FILES"] = "false";
+        settings["THUMBNAIL_CACHE_DIR"] = "./recordings/.thumbs/";
+        settings["RECORDING_QUEUE_MAX"] = "30";
+        settings["RECORDING_FORMAT"] = "avi";
+        settings["GOVERNOR_ENABLED"] = "true";
+        settings["GOVERNOR_QUALITY_MAX"] = "95";
+        settings["GOVERNOR_QUALITY_MIN"] = "60";
+        settings["GOVERNOR_QUALITY_STEP"] = "10";
+        settings["GOVERNOR_MAX_FRAME_INTERVAL"] = "3";
+        settings["GOVERNOR_QUEUE_HIGH"] = "8";
+        settings["GOVERNOR_QUEUE_LOW"] = "2";
+        settings["GOVERNOR_LATENCY_HIGH_MS"] = "30";
+        settings["GOVERNOR_LATENCY_LOW_MS"] = "15";
+        settings["GOVERNOR_CPU_IDLE_LOW"] = "10";
+        settings["GOVERNOR_CPU_IDLE_HIGH"] = "30";
+        settings["GOVERNOR_EVAL_MS"] = "1000";
+        settings["GOVERNOR_RECOVER_SECONDS"] = "5";
+        settings["METRICS_FILE"] = "/tmp/drip_metrics.prom";
+        settings["METRICS_INTERVAL_MS"] = "1000";
+        settings["THERMAL_MONITOR"] = "true";
+        settings["THERMAL_SYSFS_ROOT"] = "/sys";
+        settings["THERMAL_WARM_C"] = "70";
+        settings["THERMAL_HOT_C"] = "78";
+        settings["THERMAL_HYSTERESIS_C"] = "3";
+        settings["THERMAL_WARM_PREVIEW_INTERVAL"] = "2";
+        settings["THERMAL_HOT_PREVIEW_INTERVAL"] = "4";
+        settings["THERMAL_POLL_MS"] = "1000";
+        lock.unlock();
 
         // Save the default configuration
         saveConfig();
@@ -103,6 +175,7 @@ public:
 
     // Get value as string
     string getString(const string& key, const string& defaultValue = "") const {
+        shared_lock<shared_mutex> lock(settingsMutex);
         auto it = settings.find(key);
         if (it != settings.end()) {
             return it->second;
@@ -112,6 +185,7 @@ public:
 
     // Get value as int
     int getInt(const string& key, int defaultValue = 0) const {
+        shared_lock<shared_mutex> lock(settingsMutex);
         auto it = settings.find(key);
         if (it != settings.end()) {
             try {
@@ -125,6 +199,7 @@ public:
 
     // Get value as double
     double getDouble(const string& key, double defaultValue = 0.0) const {
+        shared_lock<shared_mutex> lock(settingsMutex);
         auto it = settings.find(key);
         if (it != settings.end()) {
             try {
@@ -138,6 +213,7 @@ public:
 
     // Get value as bool
     bool getBool(const string& key, bool defaultValue = false) const {
+        shared_lock<shared_mutex> lock(settingsMutex);
         auto it = settings.find(key);
         if (it != settings.end()) {
             string value = it->second;
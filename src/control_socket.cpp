@@ -0,0 +1,256 @@
+#include "control_socket.h"
+#include "recording.h"
+#include "serial.h"
+#include "camera.h"
+#include "thermal_monitor.h"
+#include "perf_hud.h"
+#include <cstring>
+#include <future>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define CONTROL_LINE_MAX 256
+#define CONTROL_REPLY_TIMEOUT_MS 5000
+
+// A command waiting for the main loop, the connection thread waits on the reply
+struct ControlRequest {
+    string command;
+    promise<string> reply;
+};
+
+static thread controlThread;
+static atomic<bool> controlActive(false);
+static atomic<bool> quitRequested(false);
+static int listenFd = -1;
+static string socketPath;
+
+static mutex controlMutex;
+static deque<shared_ptr<ControlRequest>> pendingRequests;
+
+static string runControlCommand(const string& command) {
+    istringstream words(command);
+    string verb;
+    string argument;
+    words >> verb >> argument;
+
+    if (verb == "status") {
+        ostringstream status;
+        status << fixed << setprecision(1)
+               << "OK recording=" << (isRecording ? 1 : 0)
+               << " processing=" << (isProcessing ? 1 : 0)
+               << " zoom=" << zoomLevel
+               << " icr=" << (icrModeEnabled ? 1 : 0)
+               << " fps=" << captureFps()
+               << " temp=" << thermalTemperature()
+               << " log=\"" << getLogMessage() << "\"";
+        return status.str();
+    }
+
+    if (verb == "record") {
+        if (argument == "start") {
+            if (isProcessing) {
+                return "ERR processing";
+            }
+            if (!isRecording) {
+                startRecording();
+            }
+            return "OK recording";
+        }
+        if (argument == "stop") {
+            if (isRecording) {
+                stopRecording();
+            }
+            return "OK stopped";
+        }
+        return "ERR usage: record start|stop";
+    }
+
+    if (verb == "zoom") {
+        if (argument == "in") {
+            zoomIn();
+        } else if (argument == "out") {
+            zoomOut();
+        } else if (!argument.empty() && all_of(argument.begin(), argument.end(), ::isdigit)) {
+            zoomLevel = min(maxZoomLevel, atoi(argument.c_str()));
+            sendZoomCommand(zoomLevel);
+        } else {
+            return "ERR usage: zoom in|out|<level>";
+        }
+        return "OK zoom=" + to_string(zoomLevel);
+    }
+
+    if (verb == "icr") {
+        if (argument != "on" && argument != "off") {
+            return "ERR usage: icr on|off";
+        }
+        icrModeEnabled = argument == "on";
+        sendICRCommand(icrModeEnabled);
+        return string("OK icr=") + (icrModeEnabled ? "1" : "0");
+    }
+
+    if (verb == "quit") {
+        quitRequested = true;
+        return "OK quitting";
+    }
+
+    return "ERR unknown command: " + verb;
+}
+
+void serviceControlCommands() {
+    deque<shared_ptr<ControlRequest>> requests;
+    {
+        lock_guard<mutex> lock(controlMutex);
+        requests.swap(pendingRequests);
+    }
+
+    for (auto& request : requests) {
+        string reply = runControlCommand(request->command);
+        cout << "Control: " << request->command << " -> " << reply << endl;
+        request->reply.set_value(reply);
+    }
+}
+
+bool controlQuitRequested() {
+    return quitRequested;
+}
+
+// Hand one command to the main loop and wait for its reply
+static string submitControlCommand(const string& command) {
+    auto request = make_shared<ControlRequest>();
+    request->command = command;
+    future<string> reply = request->reply.get_future();
+    {
+        lock_guard<mutex> lock(controlMutex);
+        pendingRequests.push_back(request);
+    }
+
+    // Wait in short steps so shutdown never waits for a whole timeout
+    for (int waited = 0; waited < CONTROL_REPLY_TIMEOUT_MS && controlActive; waited += 100) {
+        if (reply.wait_for(milliseconds(100)) == future_status::ready) {
+            return reply.get();
+        }
+    }
+    return "ERR timeout";
+}
+
+// Read commands from one client until it disconnects or goes quiet
+static void serveControlClient(int clientFd) {
+    string buffer;
+    char chunk[CONTROL_LINE_MAX];
+
+    while (controlActive) {
+        struct pollfd pfd = {clientFd, POLLIN, 0};
+        int ready = poll(&pfd, 1, 100);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        if (ready <= 0) {
+            continue;
+        }
+
+        ssize_t received = recv(clientFd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            break;
+        }
+        buffer.append(chunk, received);
+
+        size_t newline;
+        while ((newline = buffer.find('\n')) != string::npos) {
+            string command = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (!command.empty() && command.back() == '\r') {
+                command.pop_back();
+            }
+            if (command.empty()) {
+                continue;
+            }
+
+            string reply = submitControlCommand(command) + "\n";
+            send(clientFd, reply.data(), reply.size(), MSG_NOSIGNAL);
+        }
+
+        // A line longer than any command is garbage, drop the client
+        if (buffer.size() > CONTROL_LINE_MAX) {
+            break;
+        }
+    }
+
+    close(clientFd);
+}
+
+static void controlLoop() {
+    setCurrentThreadName("control");
+
+    while (controlActive) {
+        struct pollfd pfd = {listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+
+        int clientFd = accept(listenFd, NULL, NULL);
+        if (clientFd < 0) {
+            continue;
+        }
+        serveControlClient(clientFd);
+    }
+}
+
+bool startControlServer() {
+    socketPath = appConfig.getString("CONTROL_SOCKET", "/tmp/drip_control.sock");
+    if (socketPath.empty() || controlActive) {
+        return false;
+    }
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "ERROR: Control socket path too long: " << socketPath << endl;
+        return false;
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        cerr << "ERROR: Unable to create the control socket" << endl;
+        return false;
+    }
+
+    // A socket left behind by a previous run would make bind fail
+    unlink(socketPath.c_str());
+
+    // Only the user running Drip may send commands. The mode is set before
+    // listen, so nobody can connect while the socket still has the umask's.
+    if (bind(listenFd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        chmod(socketPath.c_str(), 0600) != 0 || listen(listenFd, 4) != 0) {
+        cerr << "ERROR: Unable to bind the control socket " << socketPath << endl;
+        close(listenFd);
+        unlink(socketPath.c_str());
+        listenFd = -1;
+        return false;
+    }
+
+    cout << "Control socket listening on " << socketPath << endl;
+    controlActive = true;
+    controlThread = thread(controlLoop);
+    return true;
+}
+
+void stopControlServer() {
+    if (!controlActive) {
+        return;
+    }
+
+    controlActive = false;
+    if (controlThread.joinable()) {
+        controlThread.join();
+    }
+    close(listenFd);
+    listenFd = -1;
+    unlink(socketPath.c_str());
+
+    // Nobody is waiting for these any more
+    lock_guard<mutex> lock(controlMutex);
+    pendingRequests.clear();
+}
@@ -0,0 +1,24 @@
+#ifndef CONTROL_SOCKET_H
+#define CONTROL_SOCKET_H
+
+#include "common.h"
+
+// Local control interface on a Unix domain socket (CONTROL_SOCKET), one
+// command per line, one reply line per command ("OK ..." or "ERR ...").
+// Commands: status, record start|stop, zoom in|out|<level>, icr on|off, quit.
+// A connection thread reads the commands, they run on the thread that calls
+// serviceControlCommands(), the one that owns the recording state.
+
+// Create the socket and start the connection thread, false if the socket can't be bound
+bool startControlServer();
+
+// Stop the connection thread and remove the socket
+void stopControlServer();
+
+// Run the queued commands and answer them, called from the main loop
+void serviceControlCommands();
+
+// True once a client sent "quit"
+bool controlQuitRequested();
+
+#endif // CONTROL_SOCKET_H
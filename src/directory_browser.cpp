@@ -0,0 +1,485 @@
+#include "directory_browser.h"
+#include "ui_helpers.h"
+#include "perf_hud.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+#define BROWSER_ROW_HEIGHT 30
+#define BROWSER_PLACE_HEIGHT 44
+#define BROWSER_CACHE_SECONDS 5
+#define BROWSER_CACHE_MAX 64
+#define BROWSER_MAX_ENTRIES 1000
+
+// Subdirectories of one directory and the free space of its filesystem
+struct DirectoryListing {
+    vector<string> subdirectories;
+    uint64_t freeBytes = 0;
+    bool readable = false;
+    steady_clock::time_point listedAt;
+};
+
+// A mount point or well-known directory offered on the left
+struct BrowserPlace {
+    string label;
+    string path;
+    bool removable;
+    uint64_t freeBytes;
+};
+
+static thread listerThread;
+static atomic<bool> listerActive(false);
+
+// Shared with the listing thread, guarded by browserMutex
+static mutex browserMutex;
+static condition_variable browserCondition;
+static deque<string> listRequests;
+static bool placesRequested = false;
+static map<string, DirectoryListing> listingCache;
+static vector<BrowserPlace> places;
+static uint64_t version = 0;
+
+// UI thread only
+static bool browserShown = false;
+static string currentDir;
+static int entryScroll = 0;
+static Rect panelRect;
+static Rect placesRect;
+static Rect entriesRect;
+static Rect entriesUpRect;
+static Rect entriesDownRect;
+static Rect upRect;
+static Rect selectRect;
+static Rect cancelRect;
+static vector<pair<Rect, string>> placeTargets;
+static vector<pair<Rect, string>> entryTargets;
+
+static uint64_t freeSpace(const string& path) {
+    struct statvfs info;
+    if (statvfs(path.c_str(), &info) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(info.f_bavail) * info.f_frsize;
+}
+
+// /proc/mounts escapes spaces and tabs as octal (\040)
+static string decodeMountPath(const string& field) {
+    string path;
+    for (size_t i = 0; i < field.size(); i++) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            path += static_cast<char>(strtol(field.substr(i + 1, 3).c_str(), NULL, 8));
+            i += 3;
+        } else {
+            path += field[i];
+        }
+    }
+    return path;
+}
+
+// Mounted under a media directory, or a block device the kernel marks removable
+static bool isRemovableMount(const string& device, const string& mountPoint) {
+    if (mountPoint.rfind("/media/", 0) == 0 || mountPoint.rfind("/run/media/", 0) == 0 ||
+        mountPoint.rfind("/mnt/", 0) == 0) {
+        return true;
+    }
+    if (device.rfind("/dev/sd", 0) != 0) {
+        return false;
+    }
+
+    // sda1 -> sda
+    string disk = device.substr(5);
+    while (!disk.empty() && isdigit(static_cast<unsigned char>(disk.back()))) {
+        disk.pop_back();
+    }
+    ifstream removable("/sys/block/" + disk + "/removable");
+    int flag = 0;
+    return (removable >> flag) && flag == 1;
+}
+
+static string normalizeDirectory(const string& path) {
+    error_code ec;
+    string normal = filesystem::absolute(path, ec).lexically_normal().string();
+    while (normal.size() > 1 && normal.back() == '/') {
+        normal.pop_back();
+    }
+    return normal.empty() ? "/" : normal;
+}
+
+// Removable media first, then the recordings, home and root directories.
+// statvfs may block on a sleeping drive, so this only runs on the listing thread.
+static vector<BrowserPlace> scanPlaces() {
+    vector<BrowserPlace> removable;
+    vector<BrowserPlace> fixed;
+
+    ifstream mounts("/proc/mounts");
+    string device, mountPoint, fsType, rest;
+    while (mounts >> device >> mountPoint >> fsType && getline(mounts, rest)) {
+        // Only real block devices, no proc, sysfs, tmpfs or overlays
+        if (device.rfind("/dev/", 0) != 0) {
+            continue;
+        }
+        mountPoint = decodeMountPath(mountPoint);
+        if (mountPoint.rfind("/boot", 0) == 0) {
+            continue;
+        }
+        if (isRemovableMount(device, mountPoint)) {
+            size_t slash = mountPoint.find_last_of('/');
+            removable.push_back({mountPoint.substr(slash + 1), mountPoint, true, 0});
+        }
+    }
+
+    fixed.push_back({"Recordings", normalizeDirectory("./recordings"), false, 0});
+    const char* home = getenv("HOME");
+    if (home && *home) {
+        fixed.push_back({"Home", normalizeDirectory(home), false, 0});
+    }
+    fixed.push_back({"Root", "/", false, 0});
+
+    removable.insert(removable.end(), fixed.begin(), fixed.end());
+    for (BrowserPlace& place : removable) {
+        place.freeBytes = freeSpace(place.path);
+    }
+    return removable;
+}
+
+static DirectoryListing listDirectory(const string& path) {
+    DirectoryListing listing;
+    listing.listedAt = steady_clock::now();
+
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return listing;
+    }
+    listing.readable = true;
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL && listing.subdirectories.size() < BROWSER_MAX_ENTRIES) {
+        string name = ent->d_name;
+        if (name.empty() || name[0] == '.') {
+            continue;
+        }
+
+        // Symlinks and filesystems without d_type need a stat
+        bool isDirectory = ent->d_type == DT_DIR;
+        if (ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK) {
+            struct stat info;
+            string fullPath = (path == "/" ? "" : path) + "/" + name;
+            isDirectory = stat(fullPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+        }
+        if (isDirectory) {
+            listing.subdirectories.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    sort(listing.subdirectories.begin(), listing.subdirectories.end());
+    listing.freeBytes = freeSpace(path);
+    return listing;
+}
+
+static void listerLoop() {
+    setCurrentThreadName("dir-lister");
+
+    unique_lock<mutex> lock(browserMutex);
+    while (listerActive) {
+        if (!placesRequested && listRequests.empty()) {
+            browserCondition.wait(lock);
+            continue;
+        }
+
+        if (placesRequested) {
+            placesRequested = false;
+            lock.unlock();
+            vector<BrowserPlace> found = scanPlaces();
+            lock.lock();
+            places.swap(found);
+            version++;
+            continue;
+        }
+
+        string path = listRequests.front();
+        listRequests.pop_front();
+        lock.unlock();
+        DirectoryListing listing = listDirectory(path);
+        lock.lock();
+
+        // Forget the least recently listed directories
+        if (listingCache.size() >= BROWSER_CACHE_MAX) {
+            auto oldest = listingCache.begin();
+            for (auto it = listingCache.begin(); it != listingCache.end(); ++it) {
+                if (it->second.listedAt < oldest->second.listedAt) {
+                    oldest = it;
+                }
+            }
+            listingCache.erase(oldest);
+        }
+        listingCache[path] = listing;
+        version++;
+    }
+}
+
+// Queue a listing unless a fresh one is cached, a stale one is still shown meanwhile
+static void requestListing(const string& path) {
+    {
+        lock_guard<mutex> lock(browserMutex);
+        auto cached = listingCache.find(path);
+        if (cached != listingCache.end() &&
+            steady_clock::now() - cached->second.listedAt < seconds(BROWSER_CACHE_SECONDS)) {
+            return;
+        }
+        if (find(listRequests.begin(), listRequests.end(), path) != listRequests.end()) {
+            return;
+        }
+        listRequests.push_back(path);
+    }
+    browserCondition.notify_one();
+}
+
+static void bumpVersion() {
+    lock_guard<mutex> lock(browserMutex);
+    version++;
+}
+
+static void navigateTo(const string& path) {
+    currentDir = normalizeDirectory(path);
+    entryScroll = 0;
+    requestListing(currentDir);
+    bumpVersion();
+}
+
+void openDirectoryBrowser(Rect panel) {
+    panelRect = panel;
+    int listTop = panel.y + 90;
+    int listHeight = panel.height - 170;
+    int scrollBtnSize = 30;
+
+    placesRect = Rect(panel.x + 20, listTop, panel.width * 35 / 100, listHeight);
+    entriesRect = Rect(placesRect.x + placesRect.width + 20, listTop,
+                       panel.width - placesRect.width - 70 - scrollBtnSize, listHeight);
+    entriesUpRect = Rect(entriesRect.x + entriesRect.width + 10, listTop, scrollBtnSize, scrollBtnSize);
+    entriesDownRect = Rect(entriesUpRect.x, listTop + listHeight - scrollBtnSize, scrollBtnSize, scrollBtnSize);
+
+    int btnWidth = 120;
+    int btnHeight = 40;
+    int btnY = panel.y + panel.height - btnHeight - 20;
+    upRect = Rect(entriesRect.x, btnY, btnWidth, btnHeight);
+    cancelRect = Rect(panel.x + panel.width - btnWidth - 20, btnY, btnWidth, btnHeight);
+    selectRect = Rect(cancelRect.x - btnWidth - 20, btnY, btnWidth, btnHeight);
+
+    if (!listerActive) {
+        listerActive = true;
+        listerThread = thread(listerLoop);
+    }
+
+    // Mount points change as media come and go, so places are scanned on every open
+    {
+        lock_guard<mutex> lock(browserMutex);
+        placesRequested = true;
+    }
+    browserCondition.notify_one();
+
+    // No stat here, the destination may be on a sleeping drive. A directory
+    // that is gone shows up as unreadable once the lister gets to it.
+    const char* home = getenv("HOME");
+    string start = !exportDestDir.empty() ? exportDestDir : (home ? home : "/");
+    browserShown = true;
+    navigateTo(start);
+}
+
+void closeDirectoryBrowser() {
+    if (!browserShown) {
+        return;
+    }
+    browserShown = false;
+    bumpVersion();
+}
+
+bool directoryBrowserActive() {
+    return browserShown;
+}
+
+uint64_t directoryBrowserVersion() {
+    lock_guard<mutex> lock(browserMutex);
+    return version;
+}
+
+static void drawScrollButton(Mat& img, Rect button, bool up) {
+    rectangle(img, button, Scalar(60, 60, 60), -1);
+    rectangle(img, button, Scalar(100, 100, 100), 1);
+    int tipY = up ? button.y + 5 : button.y + button.height - 5;
+    int baseY = up ? button.y + button.height - 5 : button.y + 5;
+    Point tip(button.x + button.width / 2, tipY);
+    line(img, tip, Point(button.x + 5, baseY), TEXT_COLOR, 2);
+    line(img, tip, Point(button.x + button.width - 5, baseY), TEXT_COLOR, 2);
+}
+
+static void drawButton(Mat& img, Rect button, const string& label, Scalar fill, Scalar border) {
+    rectangle(img, button, fill, -1);
+    rectangle(img, button, border, 1);
+    putText(img, label, Point(button.x + 20, button.y + 25), FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2);
+}
+
+// Keep the end of a long path, it is the part that tells directories apart
+static string fitPath(const string& path, size_t maxChars) {
+    if (path.length() <= maxChars) {
+        return path;
+    }
+    return "..." + path.substr(path.length() - (maxChars - 3));
+}
+
+void drawDirectoryBrowser(Mat& img) {
+    vector<BrowserPlace> shownPlaces;
+    DirectoryListing listing;
+    bool listed = false;
+    {
+        lock_guard<mutex> lock(browserMutex);
+        shownPlaces = places;
+        auto cached = listingCache.find(currentDir);
+        if (cached != listingCache.end()) {
+            listing = cached->second;
+            listed = true;
+        }
+    }
+
+    rectangle(img, panelRect, THEME_COLOR, -1);
+    rectangle(img, panelRect, Scalar(150, 150, 150), 2);
+    putText(img, "Select Export Directory", Point(panelRect.x + 20, panelRect.y + 30),
+            FONT_HERSHEY_SIMPLEX, 0.8, TEXT_COLOR, 2);
+
+    // Current directory with the free space of its filesystem
+    Rect pathRect(panelRect.x + 20, panelRect.y + 45, panelRect.width - 40, 30);
+    rectangle(img, pathRect, Scalar(50, 50, 50), -1);
+    rectangle(img, pathRect, Scalar(100, 100, 100), 1);
+    string freeText = listed && listing.readable ? formatFileSize(listing.freeBytes) + " free" : "";
+    size_t pathChars = max(10, (pathRect.width - 20 - static_cast<int>(freeText.size()) * 9) / 9);
+    putText(img, fitPath(currentDir, pathChars), Point(pathRect.x + 10, pathRect.y + 20),
+            FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 2);
+    if (!freeText.empty()) {
+        putText(img, freeText, Point(pathRect.x + pathRect.width - 10 - static_cast<int>(freeText.size()) * 9,
+                                     pathRect.y + 20),
+                FONT_HERSHEY_SIMPLEX, 0.5, Scalar(170, 170, 170), 1);
+    }
+
+    // Places, removable media in the highlight color
+    rectangle(img, placesRect, Scalar(50, 50, 50), -1);
+    rectangle(img, placesRect, Scalar(100, 100, 100), 1);
+    placeTargets.clear();
+    int y = placesRect.y;
+    if (shownPlaces.empty()) {
+        putText(img, "Looking for drives...", Point(placesRect.x + 10, y + 25),
+                FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
+    }
+    size_t placeChars = max(8, (placesRect.width - 20) / 9);
+    for (const BrowserPlace& place : shownPlaces) {
+        if (y + BROWSER_PLACE_HEIGHT > placesRect.y + placesRect.height) {
+            break;
+        }
+        Rect row(placesRect.x + 1, y + 1, placesRect.width - 2, BROWSER_PLACE_HEIGHT - 2);
+        if (place.path == currentDir) {
+            rectangle(img, row, HIGHLIGHT_COLOR, -1);
+        }
+
+        string label = (place.removable ? "USB: " : "") + place.label;
+        putText(img, fitPath(label, placeChars), Point(row.x + 10, row.y + 18), FONT_HERSHEY_SIMPLEX, 0.5,
+                place.removable ? Scalar(120, 220, 120) : TEXT_COLOR, 2);
+        putText(img, formatFileSize(place.freeBytes) + " free", Point(row.x + 10, row.y + 36),
+                FONT_HERSHEY_SIMPLEX, 0.45, Scalar(170, 170, 170), 1);
+
+        placeTargets.push_back({row, place.path});
+        y += BROWSER_PLACE_HEIGHT;
+    }
+
+    // Subdirectories of the current directory
+    rectangle(img, entriesRect, Scalar(50, 50, 50), -1);
+    rectangle(img, entriesRect, Scalar(100, 100, 100), 1);
+    entryTargets.clear();
+    int visibleRows = entriesRect.height / BROWSER_ROW_HEIGHT;
+
+    if (!listed) {
+        putText(img, "Listing...", Point(entriesRect.x + 10, entriesRect.y + 22),
+                FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
+    } else if (!listing.readable) {
+        putText(img, "Can't read this directory", Point(entriesRect.x + 10, entriesRect.y + 22),
+                FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
+    } else if (listing.subdirectories.empty()) {
+        putText(img, "No subdirectories", Point(entriesRect.x + 10, entriesRect.y + 22),
+                FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
+    } else {
+        entryScroll = max(0, min(entryScroll, static_cast<int>(listing.subdirectories.size()) - visibleRows));
+        size_t entryChars = max(8, (entriesRect.width - 20) / 9);
+        y = entriesRect.y;
+        for (int i = entryScroll; i < static_cast<int>(listing.subdirectories.size()) &&
+                                  i < entryScroll + visibleRows; i++) {
+            const string& name = listing.subdirectories[i];
+            Rect row(entriesRect.x + 1, y + 1, entriesRect.width - 2, BROWSER_ROW_HEIGHT - 2);
+            putText(img, fitPath(name + "/", entryChars), Point(row.x + 10, row.y + 19),
+                    FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 2);
+            entryTargets.push_back({row, (currentDir == "/" ? "" : currentDir) + "/" + name});
+            y += BROWSER_ROW_HEIGHT;
+        }
+
+        if (static_cast<int>(listing.subdirectories.size()) > visibleRows) {
+            drawScrollButton(img, entriesUpRect, true);
+            drawScrollButton(img, entriesDownRect, false);
+        }
+    }
+
+    drawButton(img, upRect, "Up", Scalar(60, 60, 60), Scalar(100, 100, 100));
+    drawButton(img, selectRect, "Select", Scalar(60, 100, 60), Scalar(100, 150, 100));
+    drawButton(img, cancelRect, "Cancel", Scalar(100, 60, 60), Scalar(150, 100, 100));
+}
+
+bool handleDirectoryBrowserMouse(int event, int x, int y) {
+    if (!browserShown) {
+        return false;
+    }
+
+    Point point(x, y);
+    if (event != EVENT_LBUTTONDOWN) {
+        return panelRect.contains(point);
+    }
+
+    for (const auto& target : placeTargets) {
+        if (target.first.contains(point)) {
+            navigateTo(target.second);
+            return true;
+        }
+    }
+    for (const auto& target : entryTargets) {
+        if (target.first.contains(point)) {
+            navigateTo(target.second);
+            return true;
+        }
+    }
+
+    int page = max(1, entriesRect.height / BROWSER_ROW_HEIGHT - 1);
+    if (entriesUpRect.contains(point)) {
+        entryScroll = max(0, entryScroll - page);
+        bumpVersion();
+    } else if (entriesDownRect.contains(point)) {
+        // Clamped against the listing when drawn
+        entryScroll += page;
+        bumpVersion();
+    } else if (upRect.contains(point)) {
+        navigateTo(filesystem::path(currentDir).parent_path().string());
+    } else if (selectRect.contains(point)) {
+        exportDestDir = currentDir == "/" ? currentDir : currentDir + "/";
+        setLogMessage("Directory selected: " + exportDestDir);
+        closeDirectoryBrowser();
+    } else if (cancelRect.contains(point)) {
+        closeDirectoryBrowser();
+    }
+
+    return panelRect.contains(point);
+}
+
+void stopDirectoryBrowser() {
+    {
+        lock_guard<mutex> lock(browserMutex);
+        listerActive = false;
+    }
+    browserCondition.notify_one();
+    if (listerThread.joinable()) {
+        listerThread.join();
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef DIRECTORY_BROWSER_H
+#define DIRECTORY_BROWSER_H
+
+#include "common.h"
+
+// Export directory browser drawn over the export dialog. Places on the left
+// (removable media first, each with its free space), the subdirectories of
+// the current directory on the right. Directories are listed on a background
+// thread and cached, so a slow or sleeping drive never stalls the UI.
+// Selecting a directory sets exportDestDir.
+
+// Open the browser in the panel, starting at exportDestDir
+void openDirectoryBrowser(Rect panel);
+
+// Hide the browser, a listing in progress finishes in the background
+void closeDirectoryBrowser();
+
+// True while the browser covers the export dialog
+bool directoryBrowserActive();
+
+// Changes whenever the browser needs redrawing
+uint64_t directoryBrowserVersion();
+
+// Render the browser into its panel
+void drawDirectoryBrowser(Mat& img);
+
+// Handle mouse input, returns true if consumed
+bool handleDirectoryBrowserMouse(int event, int x, int y);
+
+// Stop the listing thread, at exit
+void stopDirectoryBrowser();
+
+#endif // DIRECTORY_BROWSER_H
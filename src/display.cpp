@@ -0,0 +1,578 @@
+#include "display.h"
+#include "metrics.h"
+#include "perf_hud.h"
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <poll.h>
+
+static string windowTitle;
+static bool useShm = false;
+static bool highguiFullscreen = false;
+static bool windowOpen = false;
+static MouseCallback mouseHandler = nullptr;
+
+// X11 shared-memory backend state
+static Display* display = nullptr;
+static Window window = 0;
+static GC gc = 0;
+static Atom wmDeleteWindow = 0;
+static Visual* shmVisual = nullptr;
+static XShmSegmentInfo shmInfo;
+static XImage* shmImage = nullptr;
+static Mat shmFrame;            // BGRX view of the shared-memory image, window sized
+static Mat scaleBuffer;         // BGRX frame before scaling to the window
+static Size uiSize;             // Size of the frames the UI presents
+static Size configuredSize;     // Window size from the last ConfigureNotify
+static int shmCompletionEvent = 0;
+static bool shmPending = false; // Server hasn't finished reading the image yet
+static bool shmAttachFailed = false;
+static int mouseButtonState = 0;
+
+// An input event stamped with the time it was read from the server
+struct InputEvent {
+    int mouseEvent;     // EVENT_*, or -1 for a key press
+    int x;
+    int y;
+    int flags;
+    int key;
+    steady_clock::time_point time;
+};
+
+// Lock-free ring, the input thread is the only producer and the UI thread
+// the only consumer. Indices only grow, the slot is index % INPUT_QUEUE_SIZE.
+#define INPUT_QUEUE_SIZE 256
+static InputEvent inputQueue[INPUT_QUEUE_SIZE];
+static atomic<size_t> inputHead(0);
+static atomic<size_t> inputTail(0);
+
+// Input has its own connection, an Xlib connection is only used by one thread
+static Display* inputDisplay = nullptr;
+static thread inputThread;
+static atomic<bool> inputThreadActive(false);
+
+// Arrival time of the event being dispatched, and the worst latency this second
+static steady_clock::time_point currentEventTime;
+static double inputLatencyMaxMs = 0;
+static steady_clock::time_point inputLatencyWindowStart;
+
+static void waitForShmCompletion();
+
+static int shmErrorHandler(Display*, XErrorEvent*) {
+    shmAttachFailed = true;
+    return 0;
+}
+
+static void releaseShm() {
+    if (shmImage) {
+        XShmDetach(display, &shmInfo);
+        XDestroyImage(shmImage);
+        shmImage = nullptr;
+    }
+    if (shmInfo.shmaddr && shmInfo.shmaddr != reinterpret_cast<char*>(-1)) {
+        shmdt(shmInfo.shmaddr);
+    }
+    if (shmInfo.shmid >= 0) {
+        shmctl(shmInfo.shmid, IPC_RMID, nullptr);
+    }
+    shmInfo.shmaddr = nullptr;
+    shmInfo.shmid = -1;
+    shmFrame.release();
+}
+
+static void closeShmDisplay() {
+    if (!display) {
+        return;
+    }
+
+    releaseShm();
+    if (gc) {
+        XFreeGC(display, gc);
+        gc = 0;
+    }
+    if (window) {
+        XDestroyWindow(display, window);
+        window = 0;
+    }
+    XCloseDisplay(display);
+    display = nullptr;
+}
+
+static void setX11Fullscreen() {
+    Atom wmState = XInternAtom(display, "_NET_WM_STATE", False);
+    Atom fullscreenAtom = XInternAtom(display, "_NET_WM_STATE_FULLSCREEN", False);
+    XChangeProperty(display, window, wmState, XA_ATOM, 32, PropModeReplace,
+                    reinterpret_cast<unsigned char*>(&fullscreenAtom), 1);
+}
+
+// Create the shared-memory image, frames are scaled to its size on present
+static bool createShmImage(int width, int height) {
+    shmInfo.shmid = -1;
+    shmInfo.shmaddr = nullptr;
+
+    shmImage = XShmCreateImage(display, shmVisual, 24, ZPixmap, nullptr, &shmInfo, width, height);
+    if (!shmImage || shmImage->bits_per_pixel != 32) {
+        releaseShm();
+        return false;
+    }
+
+    shmInfo.shmid = shmget(IPC_PRIVATE, shmImage->bytes_per_line * shmImage->height, IPC_CREAT | 0600);
+    if (shmInfo.shmid < 0) {
+        releaseShm();
+        return false;
+    }
+    shmInfo.shmaddr = shmImage->data = static_cast<char*>(shmat(shmInfo.shmid, nullptr, 0));
+    shmInfo.readOnly = False;
+    if (shmInfo.shmaddr == reinterpret_cast<char*>(-1)) {
+        releaseShm();
+        return false;
+    }
+
+    // Attaching fails asynchronously on remote displays, so sync with a
+    // temporary error handler to find out
+    shmAttachFailed = false;
+    XErrorHandler previousHandler = XSetErrorHandler(shmErrorHandler);
+    XShmAttach(display, &shmInfo);
+    XSync(display, False);
+    XSetErrorHandler(previousHandler);
+
+    // The segment stays alive until both sides detach
+    shmctl(shmInfo.shmid, IPC_RMID, nullptr);
+    shmInfo.shmid = -1;
+
+    if (shmAttachFailed) {
+        XDestroyImage(shmImage);
+        shmImage = nullptr;
+        releaseShm();
+        return false;
+    }
+
+    shmFrame = Mat(height, width, CV_8UC4, shmInfo.shmaddr, shmImage->bytes_per_line);
+    return true;
+}
+
+static bool openShmDisplay(const string& title, int width, int height, bool fullscreen) {
+    shmInfo.shmid = -1;
+    shmInfo.shmaddr = nullptr;
+
+    display = XOpenDisplay(nullptr);
+    if (!display) {
+        return false;
+    }
+
+    // Frames are written as BGRX, so the visual must be 24-bit TrueColor with
+    // blue in the lowest byte
+    int screen = DefaultScreen(display);
+    shmVisual = DefaultVisual(display, screen);
+    if (!XShmQueryExtension(display) || DefaultDepth(display, screen) != 24 ||
+        shmVisual->red_mask != 0xff0000 || shmVisual->green_mask != 0x00ff00 || shmVisual->blue_mask != 0x0000ff) {
+        closeShmDisplay();
+        return false;
+    }
+
+    if (!createShmImage(width, height)) {
+        closeShmDisplay();
+        return false;
+    }
+    uiSize = Size(width, height);
+    configuredSize = uiSize;
+    shmCompletionEvent = XShmGetEventBase(display) + ShmCompletion;
+
+    window = XCreateSimpleWindow(display, RootWindow(display, screen), 0, 0, width, height, 0,
+                                 BlackPixel(display, screen), BlackPixel(display, screen));
+    XStoreName(display, window, title.c_str());
+    XSelectInput(display, window, ExposureMask | StructureNotifyMask);
+
+    wmDeleteWindow = XInternAtom(display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(display, window, &wmDeleteWindow, 1);
+
+    if (fullscreen) {
+        setX11Fullscreen();
+    }
+
+    gc = XCreateGC(display, window, 0, nullptr);
+    XMapWindow(display, window);
+    XFlush(display);
+    return true;
+}
+
+// Follow the window to the size it was given (fullscreen on a monitor of
+// another size), like highgui the UI is scaled to fill it
+static void resizeShmImage() {
+    if (configuredSize == Size(shmFrame.cols, shmFrame.rows) || configuredSize.area() == 0) {
+        return;
+    }
+
+    waitForShmCompletion();
+    releaseShm();
+    if (!createShmImage(configuredSize.width, configuredSize.height) &&
+        !createShmImage(uiSize.width, uiSize.height)) {
+        cerr << "ERROR: Could not recreate the shared-memory image" << endl;
+        windowOpen = false;
+        return;
+    }
+    cout << "Display window resized to " << shmFrame.cols << "x" << shmFrame.rows << endl;
+}
+
+static int translateButton(unsigned int button, bool pressed) {
+    switch (button) {
+        case Button1:
+            return pressed ? EVENT_LBUTTONDOWN : EVENT_LBUTTONUP;
+        case Button2:
+            return pressed ? EVENT_MBUTTONDOWN : EVENT_MBUTTONUP;
+        case Button3:
+            return pressed ? EVENT_RBUTTONDOWN : EVENT_RBUTTONUP;
+        default:
+            return -1;
+    }
+}
+
+static bool pushInputEvent(const InputEvent& input) {
+    size_t head = inputHead.load(memory_order_relaxed);
+    if (head - inputTail.load(memory_order_acquire) >= INPUT_QUEUE_SIZE) {
+        return false;
+    }
+    inputQueue[head % INPUT_QUEUE_SIZE] = input;
+    inputHead.store(head + 1, memory_order_release);
+    return true;
+}
+
+static bool popInputEvent(InputEvent& input) {
+    size_t tail = inputTail.load(memory_order_relaxed);
+    if (tail == inputHead.load(memory_order_acquire)) {
+        return false;
+    }
+    input = inputQueue[tail % INPUT_QUEUE_SIZE];
+    inputTail.store(tail + 1, memory_order_release);
+    return true;
+}
+
+// Turn a mouse or key XEvent into an InputEvent, false for anything else
+static bool translateInputEvent(const XEvent& event, int& buttonState, InputEvent& input) {
+    input = {-1, 0, 0, 0, -1, steady_clock::now()};
+
+    switch (event.type) {
+        case ButtonPress:
+        case ButtonRelease: {
+            bool pressed = event.type == ButtonPress;
+            input.mouseEvent = translateButton(event.xbutton.button, pressed);
+            if (event.xbutton.button == Button1) {
+                buttonState = pressed ? EVENT_FLAG_LBUTTON : 0;
+            }
+            input.x = event.xbutton.x;
+            input.y = event.xbutton.y;
+            input.flags = buttonState;
+            return input.mouseEvent >= 0;
+        }
+        case MotionNotify:
+            input.mouseEvent = EVENT_MOUSEMOVE;
+            input.x = event.xmotion.x;
+            input.y = event.xmotion.y;
+            input.flags = buttonState;
+            return true;
+        case KeyPress: {
+            char buffer[8];
+            KeySym keySym;
+            XKeyEvent keyEvent = event.xkey;
+            int length = XLookupString(&keyEvent, buffer, sizeof(buffer), &keySym, nullptr);
+            if (keySym == XK_Escape) {
+                input.key = 27;
+            } else if (length > 0) {
+                input.key = static_cast<unsigned char>(buffer[0]);
+            }
+            return input.key >= 0;
+        }
+        default:
+            return false;
+    }
+}
+
+// Reads input as soon as it arrives, so a slow frame doesn't delay or
+// coarsen the timestamps of button presses
+static void inputLoop() {
+    setCurrentThreadName("input");
+    int fd = ConnectionNumber(inputDisplay);
+    int buttonState = 0;
+
+    while (inputThreadActive) {
+        if (XPending(inputDisplay) == 0) {
+            // Wake up now and then to notice a stop request
+            pollfd pfd = {fd, POLLIN, 0};
+            poll(&pfd, 1, 50);
+            continue;
+        }
+
+        XEvent event;
+        XNextEvent(inputDisplay, &event);
+
+        InputEvent input;
+        if (translateInputEvent(event, buttonState, input) && !pushInputEvent(input)) {
+            incrementMetric("input_events_dropped");
+        }
+    }
+}
+
+static bool startInputThread() {
+    // The window must exist on the server before another connection can use it
+    XSync(display, False);
+
+    inputDisplay = XOpenDisplay(nullptr);
+    if (!inputDisplay) {
+        return false;
+    }
+
+    // Only one client may select button presses on a window, so the drawing
+    // connection leaves them to this one
+    XSelectInput(inputDisplay, window, KeyPressMask | ButtonPressMask | ButtonReleaseMask | PointerMotionMask);
+    XFlush(inputDisplay);
+
+    inputThreadActive = true;
+    inputThread = thread(inputLoop);
+    return true;
+}
+
+static void stopInputThread() {
+    inputThreadActive = false;
+    if (inputThread.joinable()) {
+        inputThread.join();
+    }
+    if (inputDisplay) {
+        XCloseDisplay(inputDisplay);
+        inputDisplay = nullptr;
+    }
+}
+
+// Export the time from an event arriving to its handler returning
+static void recordInputLatency(steady_clock::time_point eventTime) {
+    steady_clock::time_point now = steady_clock::now();
+    double latencyMs = duration<double, milli>(now - eventTime).count();
+    setMetric("input_latency_ms", latencyMs);
+
+    inputLatencyMaxMs = max(inputLatencyMaxMs, latencyMs);
+    if (now - inputLatencyWindowStart >= seconds(1)) {
+        setMetric("input_latency_max_ms", inputLatencyMaxMs);
+        inputLatencyMaxMs = 0;
+        inputLatencyWindowStart = now;
+    }
+}
+
+// Dispatch queued events up to and including the next key press
+static int dispatchInputEvents() {
+    InputEvent input;
+    while (popInputEvent(input)) {
+        currentEventTime = input.time;
+
+        // Window coordinates back to UI frame coordinates when the frame is scaled
+        if (input.mouseEvent >= 0 && useShm && shmFrame.cols > 0 && shmFrame.size() != uiSize) {
+            input.x = input.x * uiSize.width / shmFrame.cols;
+            input.y = input.y * uiSize.height / shmFrame.rows;
+        }
+        if (input.mouseEvent >= 0 && mouseHandler) {
+            mouseHandler(input.mouseEvent, input.x, input.y, input.flags, nullptr);
+        }
+        recordInputLatency(input.time);
+
+        if (input.key >= 0) {
+            return input.key;
+        }
+    }
+    return -1;
+}
+
+static void highguiMouseCallback(int event, int x, int y, int flags, void* userdata) {
+    currentEventTime = steady_clock::now();
+    if (mouseHandler) {
+        mouseHandler(event, x, y, flags, userdata);
+    }
+    recordInputLatency(currentEventTime);
+}
+
+bool openDisplay(const string& title, int width, int height, bool fullscreen, MouseCallback onMouse) {
+    windowTitle = title;
+    mouseHandler = onMouse;
+    useShm = false;
+
+    if (appConfig.getString("DISPLAY_BACKEND", "auto") != "highgui") {
+        useShm = openShmDisplay(title, width, height, fullscreen);
+        if (!useShm) {
+            cout << "X11 shared memory not available, using highgui for display" << endl;
+        } else if (!startInputThread()) {
+            // Read input between frames on the drawing connection instead
+            XSelectInput(display, window, ExposureMask | StructureNotifyMask | KeyPressMask |
+                                          ButtonPressMask | ButtonReleaseMask | PointerMotionMask);
+        }
+    }
+
+    if (!useShm) {
+        namedWindow(title, WINDOW_GUI_NORMAL);
+        resizeWindow(title, width, height);
+        if (fullscreen) {
+            // Enter true fullscreen mode (no window decorations)
+            setWindowProperty(title, WND_PROP_FULLSCREEN, WINDOW_FULLSCREEN);
+        }
+        setMouseCallback(title, highguiMouseCallback, NULL);
+    }
+
+    highguiFullscreen = fullscreen;
+    windowOpen = true;
+    return true;
+}
+
+// Wait until the server has copied the previous frame out of shared memory
+static void waitForShmCompletion() {
+    while (shmPending && display) {
+        XEvent event;
+        XIfEvent(display, &event, [](Display*, XEvent* e, XPointer) -> Bool {
+            return e->type == shmCompletionEvent;
+        }, nullptr);
+        shmPending = false;
+    }
+}
+
+void presentFrame(const Mat& frame) {
+    if (!windowOpen) {
+        return;
+    }
+
+    if (!useShm) {
+        if (highguiFullscreen) {
+            // Re-assert fullscreen, some window managers drop it
+            setWindowProperty(windowTitle, WND_PROP_FULLSCREEN, WINDOW_FULLSCREEN);
+        }
+        steady_clock::time_point start = steady_clock::now();
+        imshow(windowTitle, frame);
+        recordStageTime(STAGE_PRESENT, duration<double, milli>(steady_clock::now() - start).count());
+        return;
+    }
+
+    steady_clock::time_point start = steady_clock::now();
+    resizeShmImage();
+    if (!windowOpen) {
+        return;
+    }
+    waitForShmCompletion();
+
+    // Convert straight into the shared image, the server reads it without a copy through the socket.
+    // A window of another size gets the frame scaled, converted first so the scale writes the image.
+    steady_clock::time_point convertStart = steady_clock::now();
+    if (frame.size() == shmFrame.size()) {
+        cvtColor(frame, shmFrame, COLOR_BGR2BGRA);
+    } else {
+        cvtColor(frame, scaleBuffer, COLOR_BGR2BGRA);
+        resize(scaleBuffer, shmFrame, shmFrame.size(), 0, 0, INTER_LINEAR);
+    }
+    steady_clock::time_point convertEnd = steady_clock::now();
+
+    XShmPutImage(display, window, gc, shmImage, 0, 0, 0, 0, shmFrame.cols, shmFrame.rows, True);
+    XFlush(display);
+    shmPending = true;
+
+    // Present is the wait for the server plus the put, without the conversion
+    steady_clock::time_point end = steady_clock::now();
+    recordStageTime(STAGE_CONVERT, duration<double, milli>(convertEnd - convertStart).count());
+    recordStageTime(STAGE_PRESENT, duration<double, milli>((convertStart - start) + (end - convertEnd)).count());
+}
+
+int pollDisplayEvents(int waitMs) {
+    if (!windowOpen) {
+        return -1;
+    }
+
+    if (!useShm) {
+        return waitKey(waitMs);
+    }
+
+    // Frames pace the loop, so only what is already queued is handled here
+    while (display && XPending(display) > 0) {
+        XEvent event;
+        XNextEvent(display, &event);
+
+        if (event.type == shmCompletionEvent) {
+            shmPending = false;
+            continue;
+        }
+
+        // Without an input thread, input arrives on this connection
+        InputEvent input;
+        if (!inputThreadActive && translateInputEvent(event, mouseButtonState, input)) {
+            if (!pushInputEvent(input)) {
+                incrementMetric("input_events_dropped");
+            }
+            continue;
+        }
+
+        switch (event.type) {
+            case Expose:
+                // The UI may not redraw for a while (the export dialog is static),
+                // so repaint the last frame, which is still in shared memory
+                if (event.xexpose.count == 0 && !shmPending) {
+                    XShmPutImage(display, window, gc, shmImage, 0, 0, 0, 0,
+                                 shmFrame.cols, shmFrame.rows, True);
+                    XFlush(display);
+                    shmPending = true;
+                }
+                break;
+            case ConfigureNotify:
+                // The image follows on the next present
+                configuredSize = Size(event.xconfigure.width, event.xconfigure.height);
+                break;
+            case ClientMessage:
+                if (static_cast<Atom>(event.xclient.data.l[0]) == wmDeleteWindow) {
+                    windowOpen = false;
+                }
+                break;
+            case DestroyNotify:
+                windowOpen = false;
+                break;
+            default:
+                break;
+        }
+    }
+    return dispatchInputEvents();
+}
+
+bool displayOpen() {
+    if (!windowOpen) {
+        return false;
+    }
+    if (!useShm) {
+        return getWindowProperty(windowTitle, WND_PROP_VISIBLE) >= 1;
+    }
+    return true;
+}
+
+void minimizeDisplay() {
+    if (useShm && display) {
+        XIconifyWindow(display, window, DefaultScreen(display));
+        XFlush(display);
+    } else {
+        system(("xdotool search --name \"" + windowTitle + "\" windowminimize").c_str());
+    }
+}
+
+void closeDisplay() {
+    if (!windowOpen && !display) {
+        return;
+    }
+    windowOpen = false;
+
+    if (useShm) {
+        stopInputThread();
+        waitForShmCompletion();
+        closeShmDisplay();
+    } else {
+        destroyWindow(windowTitle);
+    }
+}
+
+steady_clock::time_point inputEventTime() {
+    return currentEventTime;
+}
+
+bool displayUsesSharedMemory() {
+    return useShm;
+}
@@ -0,0 +1,37 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "common.h"
+
+// Presents UI frames and delivers input. Uses its own X11 window with a
+// MIT-SHM shared-memory XImage when the server supports it, otherwise falls
+// back to highgui imshow/waitKey. DISPLAY_BACKEND = auto | highgui.
+// On X11 a dedicated input thread reads mouse and key events as they arrive
+// and queues them, stamped, for the UI thread.
+
+// Open the window and route mouse input to the callback
+bool openDisplay(const string& title, int width, int height, bool fullscreen, MouseCallback onMouse);
+
+// Present a BGR frame of the window size
+void presentFrame(const Mat& frame);
+
+// Dispatch queued input events up to the next key press and return that key,
+// or -1 when the queue is empty (like waitKey). Later events stay queued.
+int pollDisplayEvents(int waitMs);
+
+// Monotonic time the input event being dispatched arrived
+steady_clock::time_point inputEventTime();
+
+// False once the window was closed by the user or the window manager
+bool displayOpen();
+
+// Minimize the window
+void minimizeDisplay();
+
+// Close the window, displayOpen() returns false afterwards
+void closeDisplay();
+
+// True when frames go through the X11 shared-memory path
+bool displayUsesSharedMemory();
+
+#endif // DISPLAY_H
@@ -1,93 +1,57 @@
 #include "export_dialog.h"
+#include "proxy_recording.h"
+#include "frame_store.h"
+#include "frame_metadata.h"
+#include "clip_export.h"
+#include "review_player.h"
+#include "directory_browser.h"
+#include "thumbnail_cache.h"
+#include "ui_helpers.h"
 #include <dirent.h>
 #include <sys/stat.h>
 #include <fstream>
+#include <set>
 
 MouseCallbackData mouseData;
 
-string openDirectoryBrowser() {
-    // If a dialog is already active, don't open another one
-    if (directoryDialogActive.load()) {
-        setLogMessage("File dialog already open");
-        return "";
-    }
-    
-    // Reset result state
-    {
-        std::lock_guard<std::mutex> lock(directoryResultMutex);
-        selectedDirectoryResult = "";
-        directoryResultReady = false;
-    }
-    
-    // Set dialog as active
-    directoryDialogActive.store(true);
-    
-    // Create and start the thread for file dialog
-    std::thread dialogThread([]() {
-        // Create a temporary file to store the result
-        string tempFile = "/tmp/dir_selection.txt";
-        
-        // Run zenity file dialog and save result to temp file
-        string cmd = "zenity --file-selection --directory --title=\"Select Export Directory\" > " + tempFile;
-        int result = system(cmd.c_str());
-        
-        string selectedDir = "";
-        // Check if command succeeded
-        if (result == 0) {
-            // Read selected directory from temp file
-            ifstream file(tempFile);
-            if (file.is_open()) {
-                getline(file, selectedDir);
-                file.close();
-            }
-            
-            // Make sure the directory path ends with a slash
-            if (!selectedDir.empty() && selectedDir.back() != '/') {
-                selectedDir += "/";
-            }
-        }
-        
-        // Clean up temp file
-        remove(tempFile.c_str());
-        
-        // Store the result
-        {
-            std::lock_guard<std::mutex> lock(directoryResultMutex);
-            selectedDirectoryResult = selectedDir;
-            directoryResultReady = true;
-        }
-        
-        // Mark dialog as inactive
-        directoryDialogActive.store(false);
-    });
-    
-    // Detach the thread so it runs independently
-    dialogThread.detach();
-    
-    setLogMessage("Directory selection in progress...");
-    return "";
-}
-
-void checkDirectorySelection() {
-    bool isReady = false;
-    string result;
-    
-    // Check if result is ready
-    {
-        std::lock_guard<std::mutex> lock(directoryResultMutex);
-        if (directoryResultReady) {
-            isReady = true;
-            result = selectedDirectoryResult;
-            directoryResultReady = false; // Reset for next time
-        }
-    }
-    
-    // Process the result if ready
-    if (isReady && !result.empty()) {
-        exportDestDir = result;
-        setLogMessage("Directory selected: " + result);
-    }
-}
+// Frame count and rate of the file shown in the trim panel
+static ClipInfo trimFileInfo = {0, 0};
+
+// Length of the "YYYYMMDD_HHMMS" session stamp that starts every recording name
+#define RECORDING_STAMP_LENGTH 14
+
+// A selected recording and its clip range, -1 for the end of the file
+struct ExportItem {
+    string file;
+    int trimStart;
+    int trimEnd;
+};
+
+// Everything an export needs, copied from the dialog when it starts
+struct ExportJob {
+    vector<ExportItem> items;
+    string destDir;
+    bool keepOriginals;
+    bool proxiesOnly;
+    bool join;
+};
+
+#define LIST_ROW_HEIGHT 48
+static const Scalar LIST_BACKGROUND(50, 50, 50);
+
+// The dimmed preview behind the dialog, frozen when it is first drawn
+static Mat dialogBackground;
+
+// State of the dialog when it was last drawn
+static uint64_t dialogDrawnState = 0;
+static bool dialogDrawn = false;
+
+// Rendered file list rows, state 0 means not rendered yet
+struct ListRowCache {
+    uint64_t state = 0;
+    Mat pixels;
+};
+static vector<ListRowCache> listRowCache;
 
 void createExportDialog(int windowWidth, int windowHeight) {
     // Create export dialog in the center of the screen
@@ -98,38 +62,53 @@ void createExportDialog(int windowWidth, int windowHeight) {
 
     exportDialogRect = Rect(dialogX, dialogY, dialogWidth, dialogHeight);
 
-    // Create file list area (right side)
-    int fileListWidth = dialogWidth / 2;
-    fileListRect = Rect(dialogX + dialogWidth/2, dialogY + 50, fileListWidth, dialogHeight - 100);
+    // File list area (right side), narrow enough to leave room for the scroll buttons
+    int scrollBtnWidth = 30;
+    int scrollBtnSpacing = 10;
+    fileListRect = Rect(dialogX + dialogWidth/2, dialogY + 50,
+                        dialogWidth/2 - scrollBtnWidth - scrollBtnSpacing - 10,
+                        dialogHeight - 120);
+
+    // Scroll buttons inside the dialog, next to the file list
+    scrollUpRect = Rect(fileListRect.x + fileListRect.width + scrollBtnSpacing,
+                        fileListRect.y,
+                        scrollBtnWidth, scrollBtnWidth);
+    scrollDownRect = Rect(fileListRect.x + fileListRect.width + scrollBtnSpacing,
+                          fileListRect.y + fileListRect.height - scrollBtnWidth,
+                          scrollBtnWidth, scrollBtnWidth);
 
-    // Create directory selection area (left side)
-    dirSelectRect = Rect(dialogX + 20, dialogY + 50, dialogWidth/2 - 40, 40);
+    // Directory selection area (left side), the Browse button sits under the path
+    int dirAreaX = dialogX + 20;
+    int dirAreaWidth = dialogWidth/2 - 40;
+    dirSelectRect = Rect(dirAreaX, dialogY + 150, dirAreaWidth, 40);
 
-    // Create "Keep original files" option
-    keepFilesRect = Rect(dialogX + 20, dialogY + dialogHeight - 80, dialogWidth/2 - 40, 30);
+    // Options, stacked upwards from "Keep original files"
+    keepFilesRect = Rect(dirAreaX, dialogY + dialogHeight - 80, dirAreaWidth, 30);
+    proxiesOnlyRect = Rect(dirAreaX, keepFilesRect.y - 40, dirAreaWidth, 30);
+    joinFilesRect = Rect(dirAreaX, proxiesOnlyRect.y - 40, dirAreaWidth, 30);
 
-    // Create confirm and cancel buttons
+    // Confirm and cancel buttons side by side, centered at the bottom
     int btnWidth = 120;
     int btnHeight = 40;
-    exportConfirmRect = Rect(dialogX + 3/2 - btnWidth - 20,
-                           dialogY + dialogHeight - btnHeight - 20,
-                           btnWidth, btnHeight);
-
-    exportCancelRect = Rect(dialogX + dialogWidth/2 + 20,
-                          dialogY + dialogHeight - btnHeight - 20,
-                          btnWidth, btnHeight);
-
-    // Create scroll buttons
-    int scrollBtnSize = 30;
-    scrollUpRect = Rect(dialogX + dialogWidth - 40, dialogY + 60, scrollBtnSize, scrollBtnSize);
-    scrollDownRect = Rect(dialogX + dialogWidth - 40,
-                        dialogY + dialogHeight - 60 - scrollBtnSize,
-                        scrollBtnSize, scrollBtnSize);
+    int btnSpacing = 20;
+    int startX = dialogX + (dialogWidth - (btnWidth * 2 + btnSpacing)) / 2;
+    exportConfirmRect = Rect(startX, dialogY + dialogHeight - btnHeight - 20, btnWidth, btnHeight);
+    exportCancelRect = Rect(startX + btnWidth + btnSpacing, dialogY + dialogHeight - btnHeight - 20,
+                            btnWidth, btnHeight);
+
+    // A newly opened dialog freezes a fresh background
+    dialogBackground.release();
+    dialogDrawn = false;
 }
 
 void scanRecordingDirectory() {
     recordingFiles.clear();
     fileSelection.clear();
+    trimStartFrames.clear();
+    trimEndFrames.clear();
+    trimFileIndex = -1;
+    listRowCache.clear();
+    dialogDrawn = false;
 
     DIR *dir;
     struct dirent *ent;
@@ -138,32 +117,158 @@ void scanRecordingDirectory() {
         while ((ent = readdir(dir)) != NULL) {
             string filename = ent->d_name;
             // Skip . and .. directories and other non-video files
-            if (filename != "." && filename != ".." &&
+            // Proxies are exported through their full-resolution recording
+            if (filename != "." && filename != ".." && !isProxyFilename(filename) &&
                 (filename.find(".mp4") != string::npos ||
-                 filename.find(".avi") != string::npos)) {
+                 filename.find(".avi") != string::npos ||
+                 isFrameStoreFilename(filename))) {
                 recordingFiles.push_back(filename);
-                fileSelection.push_back(false); // Initially not selected
             }
         }
         closedir(dir);
 
         // Sort recordings alphabetically
         sort(recordingFiles.begin(), recordingFiles.end());
+
+        // Initially not selected and not trimmed
+        fileSelection.assign(recordingFiles.size(), false);
+        trimStartFrames.assign(recordingFiles.size(), 0);
+        trimEndFrames.assign(recordingFiles.size(), -1);
     }
 
     // Reset scroll position
     scrollOffset = 0;
 }
 
-void drawExportDialog(Mat& img) {
-    int dialogWidth = DISPLAY_WIDTH * 0.8;
-    int dialogHeight = DISPLAY_HEIGHT * 0.8;
-    if (!showExportDialog) return;
+// Hash of everything the dialog shows, it is only redrawn when this changes
+static uint64_t exportDialogState() {
+    uint64_t state = 1469598103934665603ULL;
+    auto mix = [&state](uint64_t value) {
+        state = (state ^ value) * 1099511628211ULL;
+    };
+
+    mix(scrollOffset);
+    mix(recordingFiles.size());
+    for (size_t i = 0; i < recordingFiles.size(); i++) {
+        mix(fileSelection[i]);
+        mix(static_cast<uint64_t>(trimStartFrames[i]));
+        mix(static_cast<uint64_t>(trimEndFrames[i]));
+    }
+    mix(static_cast<uint64_t>(trimFileIndex));
+    mix(trimFileInfo.frameCount);
+    mix(keepOriginalFiles | (exportProxiesOnly << 1) | (exportJoinFiles << 2));
+    mix(hash<string>()(exportDestDir));
+    mix(thumbnailVersion());
+    mix(reviewActive() ? updateReview() : 0);
+    mix(reviewActive());
+    mix(directoryBrowserVersion());
+    mix(directoryBrowserActive());
+    return state;
+}
+
+static void drawCheckmark(Mat& img, Rect box) {
+    line(img, Point(box.x + 3, box.y + 10), Point(box.x + 8, box.y + 15), TEXT_COLOR, 2);
+    line(img, Point(box.x + 8, box.y + 15), Point(box.x + 17, box.y + 5), TEXT_COLOR, 2);
+}
+
+// Render one file list row, centered on y = LIST_ROW_HEIGHT / 2 of its own image.
+// The sprite sheet sits at the right edge once the thumbnail worker produced it.
+static void renderListRow(Mat& row, size_t fileIndex, const RecordingThumbnail* thumbnail) {
+    int checkboxSize = 15;
+    int checkboxPadding = 20; // Space after checkbox
+    int y = LIST_ROW_HEIGHT / 2;
+
+    row.create(LIST_ROW_HEIGHT, fileListRect.width - 2, CV_8UC3);
+    row.setTo(LIST_BACKGROUND);
 
-    // Draw semi-transparent overlay for the entire screen
-    Mat overlay = img.clone();
-    rectangle(overlay, Rect(0, 0, img.cols, img.rows), Scalar(30, 30, 30), -1);
-    addWeighted(overlay, 0.7, img, 0.3, 0, img);
+    // Coordinates are relative to the list's inner left edge
+    Rect checkboxRect(9, y - checkboxSize/2, checkboxSize, checkboxSize);
+    rectangle(row, checkboxRect, TEXT_COLOR, 1);
+
+    if (fileSelection[fileIndex]) {
+        // Draw checkmark
+        line(row, Point(checkboxRect.x + 3, checkboxRect.y + checkboxSize/2),
+             Point(checkboxRect.x + checkboxSize/2, checkboxRect.y + checkboxSize - 3),
+             TEXT_COLOR, 2);
+        line(row, Point(checkboxRect.x + checkboxSize/2, checkboxRect.y + checkboxSize - 3),
+             Point(checkboxRect.x + checkboxSize - 3, checkboxRect.y + 3),
+             TEXT_COLOR, 2);
+    }
+
+    // Thumbnails at the right edge, a placeholder until they are ready
+    int spriteWidth = THUMBNAIL_WIDTH * THUMBNAIL_FRAMES;
+    Rect spriteRect(row.cols - spriteWidth - 6, (LIST_ROW_HEIGHT - THUMBNAIL_HEIGHT) / 2,
+                    spriteWidth, THUMBNAIL_HEIGHT);
+    if (thumbnail && !thumbnail->sprite.empty()) {
+        thumbnail->sprite.copyTo(row(spriteRect));
+    } else {
+        rectangle(row, spriteRect, Scalar(70, 70, 70), -1);
+    }
+
+    // Truncate the filename to the width left between the checkbox and the
+    // thumbnails, using an approximate character width for the font
+    int maxTextWidth = spriteRect.x - 10 - checkboxSize - checkboxPadding;
+    size_t maxChars = maxTextWidth / 9;
+    string displayName = recordingFiles[fileIndex];
+    if (displayName.length() > maxChars) {
+        // Keep first part and append '...'
+        displayName = displayName.substr(0, maxChars - 3) + "...";
+    }
+
+    // Outline the file shown in the trim panel
+    if (static_cast<int>(fileIndex) == trimFileIndex) {
+        rectangle(row, Rect(1, 1, row.cols - 2, LIST_ROW_HEIGHT - 2), HIGHLIGHT_COLOR, 1);
+    }
+
+    // Trimmed files in the highlight color, duration and size below the name
+    bool trimmed = trimStartFrames[fileIndex] > 0 || trimEndFrames[fileIndex] >= 0;
+    int textX = checkboxRect.x + checkboxSize + checkboxPadding;
+    putText(row, displayName, Point(textX, y - 4),
+            FONT_HERSHEY_SIMPLEX, 0.5, trimmed ? Scalar(120, 220, 120) : TEXT_COLOR, 2.0);
+
+    if (thumbnail) {
+        string details = formatFileSize(thumbnail->fileBytes);
+        if (thumbnail->durationSeconds > 0) {
+            // Milliseconds as 1000 fps frames, shown without the fraction
+            details = formatClipTime(static_cast<size_t>(thumbnail->durationSeconds * 1000), 1000.0).substr(0, 8) +
+                      "  " + details;
+        }
+        putText(row, details, Point(textX, y + 16), FONT_HERSHEY_SIMPLEX, 0.45, Scalar(170, 170, 170), 1);
+    }
+}
+
+void freezeExportDialogBackground(const Mat& background) {
+    background.copyTo(dialogBackground);
+    dialogDrawn = false;
+}
+
+bool exportDialogBackgroundFrozen() {
+    return !dialogBackground.empty();
+}
+
+bool drawExportDialog(Mat& img) {
+    if (!showExportDialog) return false;
+
+    uint64_t state = exportDialogState();
+    if (dialogDrawn && state == dialogDrawnState) {
+        return false;
+    }
+
+    if (!dialogBackground.empty()) {
+        dialogBackground.copyTo(img);
+    }
+
+    // The review player or the directory browser cover the dialog while open
+    if (reviewActive() || directoryBrowserActive()) {
+        if (reviewActive()) {
+            drawReview(img);
+        } else {
+            drawDirectoryBrowser(img);
+        }
+        dialogDrawnState = state;
+        dialogDrawn = true;
+        return true;
+    }
 
     // Draw dialog box
     rectangle(img, exportDialogRect, THEME_COLOR, -1);
@@ -174,88 +279,57 @@ void drawExportDialog(Mat& img) {
             Point(exportDialogRect.x + 20, exportDialogRect.y + 30),
             FONT_HERSHEY_SIMPLEX, 0.8, TEXT_COLOR, 2);
 
-    // Define scroll button dimensions and spacing
-    int scrollBtnWidth = 30;
-    int scrollBtnSpacing = 10;
-
-    // Adjust fileListRect to be shorter and narrower to fit scroll buttons within dialog
-    fileListRect = Rect(exportDialogRect.x + dialogWidth/2,
-                      exportDialogRect.y + 50,
-                      dialogWidth/2 - scrollBtnWidth - scrollBtnSpacing - 10, // Make it narrower
-                      dialogHeight - 120); // Make it shorter
-
     // Draw file list area (right side)
-    rectangle(img, fileListRect, Scalar(50, 50, 50), -1);
+    rectangle(img, fileListRect, LIST_BACKGROUND, -1);
     rectangle(img, fileListRect, Scalar(100, 100, 100), 1);
 
     putText(img, "Available Files",
             Point(fileListRect.x, fileListRect.y - 10),
             FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.0);
 
-    // Draw files with checkboxes
-    int y = fileListRect.y + 25;
+    // Draw files with checkboxes, each row is rendered once and then copied
+    // until its file's selection, trim or highlight changes
+    int y = fileListRect.y + 1 + LIST_ROW_HEIGHT / 2;
     int checkboxSize = 15;
     int maxY = fileListRect.y + fileListRect.height - 30;
 
     // Store rects for clickable areas
     vector<Rect> fileCheckboxRects;
     vector<Rect> fileTextRects;
-    fileCheckboxRects.clear();
-    fileTextRects.clear();
-
-    // Calculate maximum text width available for filenames
-    int checkboxPadding = 20; // Space after checkbox
-    int maxTextWidth = fileListRect.width - 10 - checkboxSize - checkboxPadding; // 10 is padding from left
 
-    // Character width approximation for the font
-    float charWidth = 9.0; // Approximate width of a character in pixels
-    int maxChars = maxTextWidth / charWidth;
+    // Thumbnails are only requested for the rows on screen
+    vector<string> visiblePaths;
 
+    listRowCache.resize(recordingFiles.size());
     for (size_t i = scrollOffset; i < recordingFiles.size() && y < maxY; i++) {
-        // Draw checkbox
-        Rect checkboxRect(fileListRect.x + 10, y - checkboxSize/2, checkboxSize, checkboxSize);
-        rectangle(img, checkboxRect, TEXT_COLOR, 1);
-        fileCheckboxRects.push_back(checkboxRect);
-
-        if (fileSelection[i]) {
-            // Draw checkmark
-            line(img, Point(checkboxRect.x + 3, checkboxRect.y + checkboxSize/2),
-                 Point(checkboxRect.x + checkboxSize/2, checkboxRect.y + checkboxSize - 3),
-                 TEXT_COLOR, 2);
-            line(img, Point(checkboxRect.x + checkboxSize/2, checkboxRect.y + checkboxSize - 3),
-                 Point(checkboxRect.x + checkboxSize - 3, checkboxRect.y + 3),
-                 TEXT_COLOR, 2);
+        string path = "./recordings/" + recordingFiles[i];
+        RecordingThumbnail thumbnail;
+        bool hasThumbnail = getThumbnail(path, thumbnail);
+        visiblePaths.push_back(path);
+
+        bool trimmed = trimStartFrames[i] > 0 || trimEndFrames[i] >= 0;
+        bool highlighted = static_cast<int>(i) == trimFileIndex;
+        uint64_t rowState = 1 | (fileSelection[i] << 1) | (trimmed << 2) | (highlighted << 3) | (hasThumbnail << 4);
+
+        ListRowCache& cached = listRowCache[i];
+        if (cached.state != rowState) {
+            renderListRow(cached.pixels, i, hasThumbnail ? &thumbnail : nullptr);
+            cached.state = rowState;
         }
+        cached.pixels.copyTo(img(Rect(fileListRect.x + 1, y - LIST_ROW_HEIGHT / 2,
+                                      cached.pixels.cols, cached.pixels.rows)));
 
-        // Get the filename and truncate if too long
-        string filename = recordingFiles[i];
-        string displayName = filename;
-
-        if (filename.length() > maxChars) {
-            // Keep first part and append '...'
-            displayName = filename.substr(0, maxChars - 3) + "...";
-        }
-
-        // Draw truncated filename
-        putText(img, displayName,
-                Point(checkboxRect.x + checkboxSize + checkboxPadding, y + 5),
-                FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 2.0);
+        Rect checkboxRect(fileListRect.x + 10, y - checkboxSize/2, checkboxSize, checkboxSize);
+        fileCheckboxRects.push_back(checkboxRect);
 
         // Create text clickable area (whole row except checkbox)
-        Rect textRect(checkboxRect.x + checkboxSize + 5, y - 15,
-                    fileListRect.width - checkboxSize - 25, 30);
+        Rect textRect(checkboxRect.x + checkboxSize + 5, y - LIST_ROW_HEIGHT / 2,
+                    fileListRect.width - checkboxSize - 25, LIST_ROW_HEIGHT);
         fileTextRects.push_back(textRect);
 
-        y += 30;
+        y += LIST_ROW_HEIGHT;
     }
-
-    // Reposition scroll buttons to be inside the dialog but next to the file list
-    scrollUpRect = Rect(fileListRect.x + fileListRect.width + scrollBtnSpacing,
-                      fileListRect.y,
-                      scrollBtnWidth, scrollBtnWidth);
-    scrollDownRect = Rect(fileListRect.x + fileListRect.width + scrollBtnSpacing,
-                        fileListRect.y + fileListRect.height - scrollBtnWidth,
-                        scrollBtnWidth, scrollBtnWidth);
+    requestThumbnails(visiblePaths);
 
     // Draw scroll buttons if needed
     if (recordingFiles.size() > maxFilesVisible) {
@@ -281,17 +355,17 @@ void drawExportDialog(Mat& img) {
     }
 
     // Directory selection area (left side)
-    int dirAreaX = exportDialogRect.x + 20;
-    int dirAreaY = exportDialogRect.y + 100;
-    int dirAreaWidth = dialogWidth/2 - 40;
+    int dirAreaX = dirSelectRect.x;
+    int dirAreaWidth = dirSelectRect.width;
 
     // Create directory path display box
-    Rect dirPathRect(dirAreaX, dirAreaY, dirAreaWidth, 30);
-    rectangle(img, dirPathRect, Scalar(50, 50, 50), -1);
+    Rect dirPathRect(dirAreaX, dirSelectRect.y - 50, dirAreaWidth, 30);
+    rectangle(img, dirPathRect, LIST_BACKGROUND, -1);
     rectangle(img, dirPathRect, Scalar(100, 100, 100), 1);
 
     // Display current export path (trimmed if too long)
     // Calculate character limit for path display
+    float charWidth = 9.0; // Approximate width of a character in pixels
     int pathMaxChars = dirAreaWidth / charWidth - 4; // -2 for padding
 
     string displayPath = exportDestDir;
@@ -310,50 +384,94 @@ void drawExportDialog(Mat& img) {
             Point(dirPathRect.x + 10, dirPathRect.y + 20),
             FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 2.0);
 
-    // Create Browse button
-    Rect browseButtonRect(dirAreaX, dirAreaY + 50, dirAreaWidth, 40);
-    rectangle(img, browseButtonRect, Scalar(60, 60, 100), -1);
-    rectangle(img, browseButtonRect, Scalar(100, 100, 150), 1);
+    // Browse button
+    rectangle(img, dirSelectRect, Scalar(60, 60, 100), -1);
+    rectangle(img, dirSelectRect, Scalar(100, 100, 150), 1);
     putText(img, "Browse...",
-            Point(browseButtonRect.x + browseButtonRect.width/2 - 40, browseButtonRect.y + 25),
+            Point(dirSelectRect.x + dirSelectRect.width/2 - 40, dirSelectRect.y + 25),
             FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.0);
 
-    // Update the browseButtonRect in global variables
-    dirSelectRect = browseButtonRect;
+    // Trim panel for the file whose name was clicked last
+    int trimY = dirSelectRect.y + dirSelectRect.height + 40;
+    vector<Rect> trimButtonRects;
+    Rect reviewButtonRect;
+
+    if (trimFileIndex < 0 || trimFileIndex >= static_cast<int>(recordingFiles.size())) {
+        putText(img, "Trim: click a file name",
+                Point(dirAreaX, trimY), FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.0);
+    } else if (trimFileInfo.frameCount == 0) {
+        putText(img, "Trim: no frame index, exported whole",
+                Point(dirAreaX, trimY), FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.0);
+    } else {
+        size_t lastFrame = trimFileInfo.frameCount - 1;
+        size_t startFrame = trimStartFrames[trimFileIndex];
+        size_t endFrame = trimEndFrames[trimFileIndex] < 0 ? lastFrame : trimEndFrames[trimFileIndex];
+
+        putText(img, "Trim: " + formatClipTime(endFrame - startFrame + 1, trimFileInfo.fps) +
+                     " (" + to_string(endFrame - startFrame + 1) + " frames)",
+                Point(dirAreaX, trimY), FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.0);
+
+        const char* labels[] = {"-1s", "-1f", "+1f", "+1s"};
+        int trimBtnWidth = 55;
+        int trimBtnHeight = 30;
+        int trimBtnX = dirAreaX + dirAreaWidth - 4 * (trimBtnWidth + 6);
+
+        for (int row = 0; row < 2; row++) {
+            int rowY = trimY + 20 + row * (trimBtnHeight + 10);
+            size_t frame = row == 0 ? startFrame : endFrame;
+            putText(img, string(row == 0 ? "Start " : "End   ") + formatClipTime(frame, trimFileInfo.fps),
+                    Point(dirAreaX, rowY + 21), FONT_HERSHEY_SIMPLEX, 0.55, TEXT_COLOR, 2.0);
+
+            for (int b = 0; b < 4; b++) {
+                Rect btn(trimBtnX + b * (trimBtnWidth + 6), rowY, trimBtnWidth, trimBtnHeight);
+                rectangle(img, btn, Scalar(60, 60, 60), -1);
+                rectangle(img, btn, Scalar(100, 100, 100), 1);
+                putText(img, labels[b], Point(btn.x + 12, btn.y + 21),
+                        FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
+                trimButtonRects.push_back(btn);
+            }
+        }
+
+        Rect resetRect(trimBtnX, trimY + 20 + 2 * (trimBtnHeight + 10), 2 * trimBtnWidth + 6, trimBtnHeight);
+        rectangle(img, resetRect, Scalar(100, 60, 60), -1);
+        rectangle(img, resetRect, Scalar(150, 100, 100), 1);
+        putText(img, "Whole file", Point(resetRect.x + 12, resetRect.y + 21),
+                FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
+        trimButtonRects.push_back(resetRect);
+
+        reviewButtonRect = Rect(resetRect.x + resetRect.width + 6, resetRect.y, resetRect.width, trimBtnHeight);
+        rectangle(img, reviewButtonRect, Scalar(60, 100, 60), -1);
+        rectangle(img, reviewButtonRect, Scalar(100, 150, 100), 1);
+        putText(img, "Review", Point(reviewButtonRect.x + 12, reviewButtonRect.y + 21),
+                FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
+    }
 
     // Draw "Keep original files" option
-    keepFilesRect = Rect(dirAreaX, exportDialogRect.y + dialogHeight - 80, dirAreaWidth, 30);
     rectangle(img, Rect(keepFilesRect.x, keepFilesRect.y, 20, 20), TEXT_COLOR, 1);
-
     if (keepOriginalFiles) {
-        // Draw checkmark
-        line(img, Point(keepFilesRect.x + 3, keepFilesRect.y + 10),
-             Point(keepFilesRect.x + 8, keepFilesRect.y + 15),
-             TEXT_COLOR, 2);
-        line(img, Point(keepFilesRect.x + 8, keepFilesRect.y + 15),
-             Point(keepFilesRect.x + 17, keepFilesRect.y + 5),
-             TEXT_COLOR, 2);
+        drawCheckmark(img, keepFilesRect);
     }
-
     putText(img, "Keep original files",
             Point(keepFilesRect.x + 30, keepFilesRect.y + 15),
             FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.0);
 
-    // Reposition buttons to be side by side at bottom
-    int btnWidth = 120;
-    int btnHeight = 40;
-    int btnSpacing = 20;
-
-    // Calculate positions to center both buttons
-    int totalBtnWidth = btnWidth * 2 + btnSpacing;
-    int startX = exportDialogRect.x + (dialogWidth - totalBtnWidth) / 2;
+    // Draw "Export proxies only" option
+    rectangle(img, Rect(proxiesOnlyRect.x, proxiesOnlyRect.y, 20, 20), TEXT_COLOR, 1);
+    if (exportProxiesOnly) {
+        drawCheckmark(img, proxiesOnlyRect);
+    }
+    putText(img, "Export proxies only",
+            Point(proxiesOnlyRect.x + 30, proxiesOnlyRect.y + 15),
+            FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.0);
 
-    // Draw buttons
-    exportConfirmRect = Rect(startX, exportDialogRect.y + dialogHeight - btnHeight - 20,
-                           btnWidth, btnHeight);
-    exportCancelRect = Rect(startX + btnWidth + btnSpacing,
-                          exportDialogRect.y + dialogHeight - btnHeight - 20,
-                          btnWidth, btnHeight);
+    // Draw "Join selected into one file" option
+    rectangle(img, Rect(joinFilesRect.x, joinFilesRect.y, 20, 20), TEXT_COLOR, 1);
+    if (exportJoinFiles) {
+        drawCheckmark(img, joinFilesRect);
+    }
+    putText(img, "Join selected into one file",
+            Point(joinFilesRect.x + 30, joinFilesRect.y + 15),
+            FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.0);
 
     rectangle(img, exportConfirmRect, Scalar(60, 100, 60), -1);
     rectangle(img, exportConfirmRect, Scalar(100, 150, 100), 1);
@@ -370,87 +488,505 @@ void drawExportDialog(Mat& img) {
     // Store the clickable areas to make them accessible in mouseCallback
     mouseData.fileCheckboxRects = fileCheckboxRects;
     mouseData.fileTextRects = fileTextRects;
+    mouseData.trimButtonRects = trimButtonRects;
+    mouseData.reviewButtonRect = reviewButtonRect;
+
+    dialogDrawnState = state;
+    dialogDrawn = true;
+    return true;
+}
+
+void selectTrimFile(size_t fileIndex) {
+    if (fileIndex >= recordingFiles.size()) {
+        return;
+    }
+
+    trimFileIndex = static_cast<int>(fileIndex);
+
+    // Only the index is read, so this is cheap even for very large recordings
+    if (!probeRecording("./recordings/" + recordingFiles[fileIndex], trimFileInfo)) {
+        trimFileInfo = {0, 0};
+    }
+}
+
+void adjustTrim(int button) {
+    if (trimFileIndex < 0 || trimFileInfo.frameCount == 0) {
+        return;
+    }
+
+    int lastFrame = static_cast<int>(trimFileInfo.frameCount) - 1;
+    int& start = trimStartFrames[trimFileIndex];
+    int end = trimEndFrames[trimFileIndex] < 0 ? lastFrame : trimEndFrames[trimFileIndex];
+
+    // One second steps use the recording's own frame rate
+    int second = max(1, static_cast<int>(trimFileInfo.fps + 0.5));
+    int steps[] = {-second, -1, 1, second};
+
+    if (button >= 0 && button < 4) {
+        start = max(0, min(start + steps[button], end));
+    } else if (button >= 4 && button < 8) {
+        end = max(start, min(end + steps[button - 4], lastFrame));
+    } else {
+        start = 0;
+        end = lastFrame;
+    }
+
+    trimEndFrames[trimFileIndex] = end == lastFrame ? -1 : end;
+
+    // Trimming a file implies exporting it
+    if (start > 0 || end < lastFrame) {
+        fileSelection[trimFileIndex] = true;
+    }
+}
+
+void setTrimPoint(bool start, size_t frame) {
+    if (trimFileIndex < 0 || trimFileInfo.frameCount == 0) {
+        return;
+    }
+
+    int lastFrame = static_cast<int>(trimFileInfo.frameCount) - 1;
+    int point = min(static_cast<int>(frame), lastFrame);
+    int& startFrame = trimStartFrames[trimFileIndex];
+    int end = trimEndFrames[trimFileIndex] < 0 ? lastFrame : trimEndFrames[trimFileIndex];
+
+    // A start past the end moves the end along, and the other way round
+    if (start) {
+        startFrame = point;
+        end = max(end, point);
+    } else {
+        end = point;
+        startFrame = min(startFrame, point);
+    }
+
+    trimEndFrames[trimFileIndex] = end == lastFrame ? -1 : end;
+    if (startFrame > 0 || end < lastFrame) {
+        fileSelection[trimFileIndex] = true;
+    }
+}
+
+void openTrimFileReview() {
+    if (trimFileIndex < 0 || trimFileInfo.frameCount == 0) {
+        return;
+    }
+    openReview("./recordings/" + recordingFiles[trimFileIndex], exportDialogRect);
+}
+
+// A retimed frame store repeats frames in the AVI, the per-frame metadata
+// repeats their records so it stays one record per written frame
+static void repeatFrameMetadata(const string& path, const vector<size_t>& sourceFrames) {
+    vector<FrameMetadataRecord> records;
+    if (!readFrameMetadataFile(path, records) || records.size() == sourceFrames.size()) {
+        return;
+    }
+    if (sourceFrames.empty() || sourceFrames.back() >= records.size()) {
+        cerr << "Frame metadata doesn't match the frame store: " << path << endl;
+        return;
+    }
+
+    FrameMetadataWriter writer;
+    if (!writer.open(path)) {
+        cerr << "Failed to rewrite metadata: " << path << endl;
+        return;
+    }
+    for (size_t frame : sourceFrames) {
+        writer.append(records[frame]);
+    }
+}
+
+// Copy the recording and per-frame metadata that belong to an exported file.
+// For clips only the per-frame records of the exported frames are kept.
+static void exportSidecarFiles(const string& srcStem, const string& destStem, bool removeOriginals,
+                               size_t firstFrame = 0, size_t endFrame = SIZE_MAX) {
+    for (const string& extension : {string(".meta"), string(FRAME_METADATA_EXT)}) {
+        string srcPath = srcStem + extension;
+        if (access(srcPath.c_str(), F_OK) != 0) {
+            continue;
+        }
+
+        error_code ec;
+        if (extension == FRAME_METADATA_EXT && (firstFrame > 0 || endFrame != SIZE_MAX)) {
+            FrameMetadataWriter writer;
+            if (!writer.open(destStem + extension) ||
+                !appendFrameMetadataRange(writer, srcPath, firstFrame, endFrame)) {
+                ec = make_error_code(errc::io_error);
+            }
+        } else {
+            filesystem::copy_file(srcPath, destStem + extension, filesystem::copy_options::overwrite_existing, ec);
+        }
+        if (ec) {
+            cerr << "Failed to copy metadata: " << srcPath << endl;
+        } else if (removeOriginals) {
+            remove(srcPath.c_str());
+        }
+    }
+}
+
+// Join the sidecars of several recordings in the same order as their frames
+static void joinSidecarFiles(const vector<string>& srcStems, const vector<ClipRange>& clips,
+                             const string& destStem) {
+    ofstream metaLog;
+    FrameMetadataWriter frameMetadata;
+
+    for (size_t i = 0; i < srcStems.size(); i++) {
+        ifstream srcLog(srcStems[i] + ".meta", ios::binary);
+        if (srcLog) {
+            if (!metaLog.is_open()) {
+                metaLog.open(destStem + ".meta", ios::binary);
+            }
+            metaLog << srcLog.rdbuf();
+        }
+
+        string fmetaPath = srcStems[i] + FRAME_METADATA_EXT;
+        if (access(fmetaPath.c_str(), F_OK) == 0) {
+            if (!frameMetadata.isOpened() && !frameMetadata.open(destStem + FRAME_METADATA_EXT)) {
+                cerr << "Failed to create metadata: " << destStem << FRAME_METADATA_EXT << endl;
+                return;
+            }
+            if (!appendFrameMetadataRange(frameMetadata, fmetaPath, clips[i].firstFrame, clips[i].lastFrame + 1)) {
+                cerr << "Failed to copy metadata: " << fmetaPath << endl;
+            }
+        }
+    }
+}
+
+static string fileStem(const string& path) {
+    size_t dotPos = path.rfind('.');
+    size_t slashPos = path.rfind('/');
+    if (dotPos == string::npos || (slashPos != string::npos && dotPos < slashPos)) {
+        return path;
+    }
+    return path.substr(0, dotPos);
+}
+
+// Proxies are always AVI, even for frame store recordings
+static string proxyExportName(const string& recordingFile) {
+    return proxyFilenameFor(isFrameStoreFilename(recordingFile)
+        ? frameStoreBasePath(recordingFile) + ".avi" : recordingFile);
+}
+
+// "YYYYMMDD_HHMMS<suffix>", the suffix tells the streams of a session apart
+// (none for the full frame, _roiN, _proxy)
+static bool splitRecordingName(const string& name, string& stamp, string& suffix) {
+    string stem = isFrameStoreFilename(name) ? frameStoreBasePath(name) : fileStem(name);
+    stem = stem.substr(stem.rfind('/') + 1);
+    if (stem.length() < RECORDING_STAMP_LENGTH || stem[8] != '_' ||
+        !all_of(stem.begin(), stem.begin() + 8, [](char c) { return isdigit(static_cast<unsigned char>(c)); })) {
+        return false;
+    }
+    stamp = stem.substr(0, RECORDING_STAMP_LENGTH);
+    suffix = stem.substr(RECORDING_STAMP_LENGTH);
+    return true;
+}
+
+// Only consecutive segments of one stream join into a continuous file: the
+// same stream of each session, every clip starting after the previous one
+// ended. The per-frame capture times decide where the sidecars exist, the
+// session stamps otherwise.
+static bool checkJoinOrder(const vector<ClipRange>& clips, const vector<string>& metadataPaths) {
+    string firstStamp, firstSuffix;
+    if (!splitRecordingName(clips[0].path, firstStamp, firstSuffix)) {
+        setLogMessage("Cannot join " + clips[0].path.substr(clips[0].path.rfind('/') + 1));
+        return false;
+    }
+
+    string previousStamp = firstStamp;
+    FrameMetadataRecord previousEnd = {};
+    bool previousTimed = !metadataPaths[0].empty() &&
+                         readFrameMetadataRecord(metadataPaths[0], clips[0].lastFrame, previousEnd);
+
+    for (size_t i = 1; i < clips.size(); i++) {
+        string stamp, suffix;
+        if (!splitRecordingName(clips[i].path, stamp, suffix) || suffix != firstSuffix) {
+            setLogMessage("Can only join one stream");
+            return false;
+        }
+
+        FrameMetadataRecord start = {}, end = {};
+        bool timed = !metadataPaths[i].empty() &&
+                     readFrameMetadataRecord(metadataPaths[i], clips[i].firstFrame, start) &&
+                     readFrameMetadataRecord(metadataPaths[i], clips[i].lastFrame, end);
+        bool follows = previousTimed && timed ? start.captureTimeUs > previousEnd.captureTimeUs
+                                              : stamp > previousStamp;
+        if (!follows) {
+            setLogMessage("Join files overlap in time");
+            return false;
+        }
+
+        previousStamp = stamp;
+        previousEnd = end;
+        previousTimed = timed;
+    }
+    return true;
+}
+
+// Stitch all selected recordings, in name (and so time) order, into one AVI
+static void performJoinExport(const ExportJob& job) {
+    vector<ClipRange> clips;
+    vector<string> srcStems;
+    vector<string> metadataPaths;
+    set<string> joinedProxies;
+    bool anyTrimmed = false;
+
+    for (const ExportItem& item : job.items) {
+        // The ROI streams of a session share its proxy, which joins once
+        string exportName = item.file;
+        if (job.proxiesOnly) {
+            exportName = proxyExportName(exportName);
+            if (!joinedProxies.insert(exportName).second) {
+                continue;
+            }
+        }
+
+        string srcPath = "./recordings/" + exportName;
+        ClipInfo info;
+        if (!probeRecording(srcPath, info)) {
+            setLogMessage("Cannot join " + exportName);
+            return;
+        }
+
+        // Proxies don't share frame numbers with their recording, so they join whole
+        ClipRange clip = {srcPath, 0, info.frameCount - 1};
+        string metadataPath;
+        if (!job.proxiesOnly) {
+            clip.firstFrame = min(static_cast<size_t>(item.trimStart), clip.lastFrame);
+            if (item.trimEnd >= 0) {
+                clip.lastFrame = min(static_cast<size_t>(item.trimEnd), clip.lastFrame);
+            }
+            anyTrimmed = anyTrimmed || item.trimStart > 0 || item.trimEnd >= 0;
+            srcStems.push_back(isFrameStoreFilename(srcPath) ? frameStoreBasePath(srcPath) : fileStem(srcPath));
+            metadataPath = srcStems.back() + FRAME_METADATA_EXT;
+        }
+        clips.push_back(clip);
+        metadataPaths.push_back(metadataPath);
+    }
+
+    if (!checkJoinOrder(clips, metadataPaths)) {
+        return;
+    }
+
+    string firstName = clips[0].path.substr(clips[0].path.rfind('/') + 1);
+    string destStem = job.destDir + (isFrameStoreFilename(firstName) ? frameStoreBasePath(firstName) : fileStem(firstName)) + "_joined";
+
+    if (!joinClips(clips, destStem + ".avi")) {
+        setLogMessage("Join failed");
+        return;
+    }
+
+    if (!job.proxiesOnly) {
+        joinSidecarFiles(srcStems, clips, destStem);
+    }
+
+    // Originals are only removed when the joined file holds all of their frames
+    if (!job.keepOriginals && !anyTrimmed) {
+        for (const ClipRange& clip : clips) {
+            if (isFrameStoreFilename(clip.path)) {
+                string basePath = frameStoreBasePath(clip.path);
+                remove((basePath + FRAME_STORE_DATA_EXT).c_str());
+                remove((basePath + FRAME_STORE_INDEX_EXT).c_str());
+            } else {
+                remove(clip.path.c_str());
+            }
+        }
+        for (const string& stem : srcStems) {
+            remove((stem + ".meta").c_str());
+            remove((stem + FRAME_METADATA_EXT).c_str());
+        }
+    }
+
+    setLogMessage("Joined " + to_string(clips.size()) + (job.proxiesOnly ? " proxies" : " files"));
 }
 
-void performExport() {
+static void performExport(const ExportJob& job) {
     // Make sure destination directory exists
-    mkdir(exportDestDir.c_str(), 0777);
+    mkdir(job.destDir.c_str(), 0777);
+
+    // Joining needs at least two recordings, a single one exports normally
+    if (job.join && job.items.size() > 1) {
+        performJoinExport(job);
+        return;
+    }
 
     int exportCount = 0;
-    for (size_t i = 0; i < recordingFiles.size(); i++) {
-        if (fileSelection[i]) {
-            string srcPath = "./recordings/" + recordingFiles[i];
-            string destPath = exportDestDir + recordingFiles[i];
-
-            // Copy file to destination using better file handling
-            bool copySuccess = false;
-
-            // Open source file in binary mode
-            std::ifstream src(srcPath, std::ios::binary);
-            if (src) {
-                // Open destination file in binary mode
-                std::ofstream dst(destPath, std::ios::binary);
-                if (dst) {
-                    // Get source file size
-                    src.seekg(0, std::ios::end);
-                    std::streamsize size = src.tellg();
-                    src.seekg(0, std::ios::beg);
-
-                    // Allocate buffer
-                    const int bufferSize = 4096;
-                    char buffer[bufferSize];
-
-                    // Copy file in chunks
-                    while (size > 0) {
-                        std::streamsize bytesToRead = std::min(static_cast<std::streamsize>(bufferSize), size);
-                        src.read(buffer, bytesToRead);
-                        dst.write(buffer, src.gcount());
-                        size -= src.gcount();
-                    }
-
-                    dst.close();
-                    copySuccess = true;
-                }
-                src.close();
+    int clipCount = 0;
+    int missingProxies = 0;
+    set<string> exportedProxies;
+    for (const ExportItem& item : job.items) {
+        // For fast triage, export the low-resolution proxy instead of the original
+        string exportName = item.file;
+        if (job.proxiesOnly) {
+            // The ROI streams of a session share its proxy, which is exported once
+            exportName = proxyExportName(item.file);
+            if (!exportedProxies.insert(exportName).second) {
+                continue;
             }
+            if (access(("./recordings/" + exportName).c_str(), F_OK) != 0) {
+                cerr << "No proxy for " << item.file << endl;
+                missingProxies++;
+                continue;
+            }
+        }
 
-            // Check file sizes to confirm copy worked
-            struct stat srcStat, dstStat;
-            bool sizeCheckOk = false;
-
-            if (stat(srcPath.c_str(), &srcStat) == 0 &&
-                stat(destPath.c_str(), &dstStat) == 0) {
-                sizeCheckOk = (srcStat.st_size == dstStat.st_size && srcStat.st_size > 0);
+        string srcPath = "./recordings/" + exportName;
+        string destPath = job.destDir + exportName;
+
+        // Trimmed files are written as a new clip, the original is always kept
+        bool trimmed = item.trimStart > 0 || item.trimEnd >= 0;
+        if (trimmed && !job.proxiesOnly) {
+            string srcStem = isFrameStoreFilename(exportName) ? frameStoreBasePath(srcPath) : fileStem(srcPath);
+            string destStem = (isFrameStoreFilename(exportName) ? frameStoreBasePath(destPath) : fileStem(destPath)) + "_clip";
+            size_t firstFrame = item.trimStart;
+            size_t lastFrame = item.trimEnd;
+
+            if (item.trimEnd < 0) {
+                ClipInfo info;
+                if (!probeRecording(srcPath, info)) {
+                    cerr << "Failed to read index of " << srcPath << endl;
+                    continue;
+                }
+                lastFrame = info.frameCount - 1;
             }
 
-            if (copySuccess && sizeCheckOk) {
+            if (exportClip(srcPath, destStem + ".avi", firstFrame, lastFrame)) {
                 exportCount++;
+                clipCount++;
+                exportSidecarFiles(srcStem, destStem, false, firstFrame, lastFrame + 1);
+            } else {
+                cerr << "Failed to export clip of " << srcPath << endl;
+            }
+            continue;
+        }
+
+        // Frame stores are converted to a standard AVI on the way out
+        if (isFrameStoreFilename(exportName)) {
+            string basePath = frameStoreBasePath(srcPath);
+            string aviPath = frameStoreBasePath(destPath) + ".avi";
 
-                // Delete original file if not keeping them
-                if (!keepOriginalFiles) {
-                    if (remove(srcPath.c_str()) == 0) {
-                        cout << "Deleted original file: " << srcPath << endl;
-                    } else {
-                        cerr << "Failed to delete original file: " << srcPath << endl;
-                    }
+            vector<size_t> sourceFrames;
+            if (convertFrameStoreToAvi(basePath, aviPath, 0, SIZE_MAX, &sourceFrames)) {
+                exportCount++;
+                exportSidecarFiles(basePath, frameStoreBasePath(destPath), !job.keepOriginals);
+                repeatFrameMetadata(frameStoreBasePath(destPath) + FRAME_METADATA_EXT, sourceFrames);
+
+                // Delete original data and index if not keeping them
+                if (!job.keepOriginals) {
+                    remove((basePath + FRAME_STORE_DATA_EXT).c_str());
+                    remove((basePath + FRAME_STORE_INDEX_EXT).c_str());
+                    cout << "Deleted original frame store: " << basePath << endl;
                 }
             } else {
-                cerr << "Failed to copy file: " << srcPath << " to " << destPath << endl;
-                if (copySuccess && !sizeCheckOk) {
-                    cerr << "File size mismatch after copy!" << endl;
+                cerr << "Failed to convert frame store: " << srcPath << " to " << aviPath << endl;
+            }
+            continue;
+        }
+
+        // Copy file to destination using better file handling
+        bool copySuccess = false;
+
+        // Open source file in binary mode
+        std::ifstream src(srcPath, std::ios::binary);
+        if (src) {
+            // Open destination file in binary mode
+            std::ofstream dst(destPath, std::ios::binary);
+            if (dst) {
+                // Get source file size
+                src.seekg(0, std::ios::end);
+                std::streamsize size = src.tellg();
+                src.seekg(0, std::ios::beg);
+
+                // Allocate buffer
+                const int bufferSize = 4096;
+                char buffer[bufferSize];
+
+                // Copy file in chunks
+                while (size > 0) {
+                    std::streamsize bytesToRead = std::min(static_cast<std::streamsize>(bufferSize), size);
+                    src.read(buffer, bytesToRead);
+                    dst.write(buffer, src.gcount());
+                    size -= src.gcount();
                 }
+
+                dst.close();
+                copySuccess = true;
+            }
+            src.close();
+        }
+
+        // Check file sizes to confirm copy worked
+        struct stat srcStat, dstStat;
+        bool sizeCheckOk = false;
+
+        if (stat(srcPath.c_str(), &srcStat) == 0 &&
+            stat(destPath.c_str(), &dstStat) == 0) {
+            sizeCheckOk = (srcStat.st_size == dstStat.st_size && srcStat.st_size > 0);
+        }
+
+        if (copySuccess && sizeCheckOk) {
+            exportCount++;
+
+            // Proxies have no metadata of their own
+            if (!job.proxiesOnly) {
+                exportSidecarFiles(fileStem(srcPath), fileStem(destPath), !job.keepOriginals);
+            }
+
+            // Delete original file if not keeping them
+            if (!job.keepOriginals) {
+                if (remove(srcPath.c_str()) == 0) {
+                    cout << "Deleted original file: " << srcPath << endl;
+                } else {
+                    cerr << "Failed to delete original file: " << srcPath << endl;
+                }
+            }
+        } else {
+            cerr << "Failed to copy file: " << srcPath << " to " << destPath << endl;
+            if (copySuccess && !sizeCheckOk) {
+                cerr << "File size mismatch after copy!" << endl;
             }
         }
     }
 
     if (exportCount > 0) {
-        setLogMessage("Exported " + to_string(exportCount) + " files");
-
-        // Refresh the file list (some might have been deleted)
-        if (!keepOriginalFiles) {
-            scanRecordingDirectory();
+        string message = "Exported " + to_string(exportCount) + (job.proxiesOnly ? " proxies" : " files");
+        if (clipCount > 0) {
+            message += " (" + to_string(clipCount) + " clips)";
         }
+        if (missingProxies > 0) {
+            message += ", " + to_string(missingProxies) + " without proxy";
+        }
+        setLogMessage(message);
+    } else if (missingProxies > 0) {
+        setLogMessage("No proxies for selected files");
     } else {
         setLogMessage("No files selected for export");
     }
 }
+
+// The dialog state is copied when the export starts, the worker never touches
+// the dialog's globals. The file list is rescanned when the dialog opens next.
+void startExport() {
+    if (isProcessing) {
+        setLogMessage("Processing...");
+        return;
+    }
+
+    ExportJob job;
+    job.destDir = exportDestDir;
+    job.keepOriginals = keepOriginalFiles;
+    job.proxiesOnly = exportProxiesOnly;
+    job.join = exportJoinFiles;
+    for (size_t i = 0; i < recordingFiles.size(); i++) {
+        if (fileSelection[i]) {
+            job.items.push_back({recordingFiles[i], trimStartFrames[i], trimEndFrames[i]});
+        }
+    }
+
+    // Copies of multi-GB recordings run next to the UI, like post-processing
+    if (processingThread.joinable()) {
+        processingThread.join();
+    }
+    progressValue = 0;
+    isProcessing = true;
+    processingThread = thread([job]() {
+        performExport(job);
+        isProcessing = false;
+    });
+}
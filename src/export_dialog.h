@@ -6,25 +6,41 @@
 // Initialize export dialog with window dimensions
 void createExportDialog(int windowWidth, int windowHeight);
 
-// Draw export dialog on UI frame
-void drawExportDialog(Mat& img);
+// Draw export dialog on UI frame. Only redraws when the dialog changed since the
+// last call, otherwise returns false and leaves img untouched.
+bool drawExportDialog(Mat& img);
+
+// Keep a copy of the dimmed preview to draw the dialog over until it closes
+void freezeExportDialogBackground(const Mat& background);
+
+// True once the background of the open dialog has been frozen
+bool exportDialogBackgroundFrozen();
 
 // Scan available recording files
 void scanRecordingDirectory();
 
-// Open directory browser dialog
-string openDirectoryBrowser();
+// Export the selected files on the processing thread, progress goes to
+// progressValue and the result to the log message
+void startExport();
+
+// Select the file whose clip range is edited in the trim panel
+void selectTrimFile(size_t fileIndex);
+
+// Apply a trim panel button (0-3 move the start, 4-7 move the end, 8 resets)
+void adjustTrim(int button);
 
-// Check if directory selection has completed
-void checkDirectorySelection();
+// Set the start or end of the trim file's clip to a frame, from the review player
+void setTrimPoint(bool start, size_t frame);
 
-// Perform export operation
-void performExport();
+// Open the file shown in the trim panel in the review player
+void openTrimFileReview();
 
 // MouseCallbackData structure for handling export UI interaction
 struct MouseCallbackData {
     vector<Rect> fileCheckboxRects;
     vector<Rect> fileTextRects;
+    vector<Rect> trimButtonRects;
+    Rect reviewButtonRect;
 };
 
 extern MouseCallbackData mouseData;
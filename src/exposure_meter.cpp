@@ -0,0 +1,177 @@
+#include "exposure_meter.h"
+#include "metrics.h"
+#include "thermal_monitor.h"
+#include <opencv2/core/hal/intrin.hpp>
+
+#define EXPOSURE_CLIP_HIGH 250
+#define EXPOSURE_CLIP_LOW 5
+
+// Capture thread state: a 256-bin histogram per band of grid rows, and their sum
+static vector<uint32_t> bandHistograms;
+static vector<uint64_t> gridHistogram;
+static size_t nextBand = 0;
+static Size gridFrameSize;
+static int gridRowStep = 0;
+static int gridBandRows = 0;
+static vector<uchar> lumaRow;
+
+static mutex exposureMutex;
+static ExposureStats latestStats = {};
+
+// BT.601 luma with 8-bit weights (29 + 150 + 77 = 256), the same math in both loops
+static void computeRowLuma(const uchar* bgr, int width, uchar* luma) {
+    int x = 0;
+
+#if CV_SIMD128
+    v_uint16x8 weightB = v_setall_u16(29);
+    v_uint16x8 weightG = v_setall_u16(150);
+    v_uint16x8 weightR = v_setall_u16(77);
+    v_uint16x8 round = v_setall_u16(128);
+
+    for (; x + 16 <= width; x += 16) {
+        v_uint8x16 b, g, r;
+        v_load_deinterleave(bgr + x * 3, b, g, r);
+
+        v_uint16x8 b0, b1, g0, g1, r0, r1;
+        v_expand(b, b0, b1);
+        v_expand(g, g0, g1);
+        v_expand(r, r0, r1);
+
+        v_uint16x8 y0 = v_add_wrap(v_add_wrap(v_mul_wrap(b0, weightB), v_mul_wrap(g0, weightG)),
+                                   v_add_wrap(v_mul_wrap(r0, weightR), round));
+        v_uint16x8 y1 = v_add_wrap(v_add_wrap(v_mul_wrap(b1, weightB), v_mul_wrap(g1, weightG)),
+                                   v_add_wrap(v_mul_wrap(r1, weightR), round));
+        v_store(luma + x, v_pack(v_shr<8>(y0), v_shr<8>(y1)));
+    }
+#endif
+
+    for (; x < width; x++) {
+        const uchar* p = bgr + x * 3;
+        luma[x] = static_cast<uchar>((p[0] * 29 + p[1] * 150 + p[2] * 77 + 128) >> 8);
+    }
+}
+
+static void publishExposureStats() {
+    ExposureStats stats = {};
+    uint64_t sum = 0;
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    for (int value = 0; value < 256; value++) {
+        uint64_t count = gridHistogram[value];
+        stats.samples += count;
+        sum += count * value;
+        if (value >= EXPOSURE_CLIP_HIGH) high += count;
+        if (value <= EXPOSURE_CLIP_LOW) low += count;
+        stats.bins[value * EXPOSURE_BINS / 256] += static_cast<uint32_t>(count);
+    }
+
+    if (stats.samples == 0) {
+        return;
+    }
+
+    stats.meanLuma = static_cast<double>(sum) / stats.samples;
+    stats.clippedHigh = static_cast<double>(high) / stats.samples;
+    stats.clippedLow = static_cast<double>(low) / stats.samples;
+
+    setMetric("exposure_mean_luma", stats.meanLuma);
+    setMetric("exposure_clipped_high_ratio", stats.clippedHigh);
+    setMetric("exposure_clipped_low_ratio", stats.clippedLow);
+
+    lock_guard<mutex> lock(exposureMutex);
+    stats.version = latestStats.version + 1;
+    latestStats = stats;
+}
+
+void updateExposureMeter(const Mat& frame, int rowStep, int pixelBudget) {
+    // The meter is optional work, it pauses while the SoC runs hot
+    if (frame.empty() || frame.type() != CV_8UC3 || thermalShedOptionalWork()) {
+        return;
+    }
+
+    steady_clock::time_point start = steady_clock::now();
+
+    // Whole rows keep the luma loop contiguous for SIMD, the grid is every rowStep-th row
+    rowStep = max(1, rowStep);
+    int budget = max(frame.cols, pixelBudget);
+    int gridRows = (frame.rows + rowStep - 1) / rowStep;
+    int bandRows = budget / frame.cols;
+    size_t bands = (gridRows + bandRows - 1) / bandRows;
+
+    // Start over when the frame or the grid changes
+    if (frame.size() != gridFrameSize || rowStep != gridRowStep || bandRows != gridBandRows) {
+        bandHistograms.assign(bands * 256, 0);
+        gridHistogram.assign(256, 0);
+        lumaRow.resize(frame.cols);
+        nextBand = 0;
+        gridFrameSize = frame.size();
+        gridRowStep = rowStep;
+        gridBandRows = bandRows;
+    }
+
+    // Replace this band's counts from its previous pass
+    uint32_t* band = &bandHistograms[nextBand * 256];
+    for (int value = 0; value < 256; value++) {
+        gridHistogram[value] -= band[value];
+        band[value] = 0;
+    }
+
+    int firstRow = static_cast<int>(nextBand) * bandRows;
+    int endRow = min(firstRow + bandRows, gridRows);
+    for (int row = firstRow; row < endRow; row++) {
+        computeRowLuma(frame.ptr<uchar>(row * rowStep), frame.cols, lumaRow.data());
+        for (int x = 0; x < frame.cols; x++) {
+            band[lumaRow[x]]++;
+        }
+    }
+
+    for (int value = 0; value < 256; value++) {
+        gridHistogram[value] += band[value];
+    }
+
+    if (++nextBand == bands) {
+        nextBand = 0;
+        publishExposureStats();
+    }
+
+    setMetric("exposure_update_ms", duration<double, milli>(steady_clock::now() - start).count());
+}
+
+void getExposureStats(ExposureStats& stats) {
+    lock_guard<mutex> lock(exposureMutex);
+    stats = latestStats;
+}
+
+void drawExposureMeter(Mat& img, Rect area, const ExposureStats& stats) {
+    rectangle(img, area, Scalar(100, 150, 100), 1);
+
+    if (stats.version == 0) {
+        putText(img, "Exposure: sampling...", Point(area.x + 6, area.y + area.height - 8),
+                FONT_HERSHEY_SIMPLEX, 0.45, TEXT_COLOR, 1);
+        return;
+    }
+
+    // Bars scaled to the tallest bin, the outermost bins in red when they hold clipped pixels
+    Rect plot(area.x + 2, area.y + 4, area.width - 4, area.height - 28);
+    uint32_t peak = *max_element(stats.bins, stats.bins + EXPOSURE_BINS);
+    int barWidth = max(1, plot.width / EXPOSURE_BINS);
+    int plotX = plot.x + (plot.width - barWidth * EXPOSURE_BINS) / 2;
+
+    for (int b = 0; b < EXPOSURE_BINS; b++) {
+        int height = peak ? static_cast<int>(static_cast<uint64_t>(stats.bins[b]) * plot.height / peak) : 0;
+        if (height == 0) {
+            continue;
+        }
+        bool edge = b == 0 || b == EXPOSURE_BINS - 1;
+        rectangle(img, Rect(plotX + b * barWidth, plot.y + plot.height - height, barWidth, height),
+                  edge ? Scalar(0, 0, 255) : Scalar(200, 200, 200), -1);
+    }
+
+    // Clipping meter, red once more than 1% of the picture is lost at either end
+    char text[64];
+    snprintf(text, sizeof(text), "Mean %d  Hi %.1f%%  Lo %.1f%%",
+             static_cast<int>(stats.meanLuma), stats.clippedHigh * 100.0, stats.clippedLow * 100.0);
+    bool clipping = stats.clippedHigh > 0.01 || stats.clippedLow > 0.01;
+    putText(img, text, Point(area.x + 6, area.y + area.height - 8),
+            FONT_HERSHEY_SIMPLEX, 0.45, clipping ? Scalar(0, 0, 255) : TEXT_COLOR, 1);
+}
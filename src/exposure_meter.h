@@ -0,0 +1,29 @@
+#ifndef EXPOSURE_METER_H
+#define EXPOSURE_METER_H
+
+#include "common.h"
+
+#define EXPOSURE_BINS 64
+
+// Luma statistics over the most recent complete pass of the sampling grid
+struct ExposureStats {
+    uint32_t bins[EXPOSURE_BINS];
+    double meanLuma;
+    double clippedHigh;     // Fraction of samples at or above EXPOSURE_CLIP_HIGH
+    double clippedLow;      // Fraction of samples at or below EXPOSURE_CLIP_LOW
+    uint64_t samples;
+    uint64_t version;       // Bumped on every completed pass, 0 before the first
+};
+
+// Sample the next band of grid rows (every rowStep-th row, EXPOSURE_ROW_STEP)
+// of a captured frame. At most pixelBudget pixels (EXPOSURE_PIXEL_BUDGET) are
+// read per call, the histogram of the whole grid is kept up to date band by band.
+void updateExposureMeter(const Mat& frame, int rowStep, int pixelBudget);
+
+// Copy of the latest statistics, safe to call from any thread
+void getExposureStats(ExposureStats& stats);
+
+// Render the histogram and clipping meter widget
+void drawExposureMeter(Mat& img, Rect area, const ExposureStats& stats);
+
+#endif // EXPOSURE_METER_H
@@ -0,0 +1,120 @@
+#include "frame_metadata.h"
+#include <cstring>
+
+// Flush at least once a second at 30 fps so a crash loses little metadata
+static const uint32_t FLUSH_INTERVAL_RECORDS = 30;
+
+FrameMetadataWriter::FrameMetadataWriter() : file(nullptr), unflushed(0) {
+}
+
+FrameMetadataWriter::~FrameMetadataWriter() {
+    close();
+}
+
+bool FrameMetadataWriter::open(const std::string& path) {
+    close();
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    FrameMetadataHeader header = {};
+    memcpy(header.magic, FRAME_METADATA_MAGIC, sizeof(header.magic));
+    header.version = FRAME_METADATA_VERSION;
+    header.recordSize = sizeof(FrameMetadataRecord);
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1) {
+        close();
+        return false;
+    }
+
+    unflushed = 0;
+    return true;
+}
+
+bool FrameMetadataWriter::append(const FrameMetadataRecord& record) {
+    if (!file || fwrite(&record, sizeof(record), 1, file) != 1) {
+        return false;
+    }
+
+    if (++unflushed >= FLUSH_INTERVAL_RECORDS) {
+        fflush(file);
+        unflushed = 0;
+    }
+    return true;
+}
+
+void FrameMetadataWriter::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool appendFrameMetadataRange(FrameMetadataWriter& writer, const std::string& srcPath,
+                              uint64_t firstRecord, uint64_t endRecord) {
+    FILE* src = fopen(srcPath.c_str(), "rb");
+    if (!src) {
+        return false;
+    }
+
+    FrameMetadataHeader header;
+    if (fread(&header, sizeof(header), 1, src) != 1 ||
+        memcmp(header.magic, FRAME_METADATA_MAGIC, sizeof(header.magic)) != 0 ||
+        header.recordSize != sizeof(FrameMetadataRecord) ||
+        fseeko(src, static_cast<off_t>(sizeof(header) + firstRecord * sizeof(FrameMetadataRecord)), SEEK_SET) != 0) {
+        fclose(src);
+        return false;
+    }
+
+    FrameMetadataRecord record;
+    bool ok = true;
+    for (uint64_t i = firstRecord; i < endRecord && fread(&record, sizeof(record), 1, src) == 1; i++) {
+        if (!writer.append(record)) {
+            ok = false;
+            break;
+        }
+    }
+
+    fclose(src);
+    return ok;
+}
+
+bool readFrameMetadataRecord(const std::string& path, uint64_t index, FrameMetadataRecord& record) {
+    FILE* src = fopen(path.c_str(), "rb");
+    if (!src) {
+        return false;
+    }
+
+    FrameMetadataHeader header;
+    bool ok = fread(&header, sizeof(header), 1, src) == 1 &&
+              memcmp(header.magic, FRAME_METADATA_MAGIC, sizeof(header.magic)) == 0 &&
+              header.recordSize == sizeof(FrameMetadataRecord) &&
+              fseeko(src, static_cast<off_t>(sizeof(header) + index * sizeof(FrameMetadataRecord)), SEEK_SET) == 0 &&
+              fread(&record, sizeof(record), 1, src) == 1;
+
+    fclose(src);
+    return ok;
+}
+
+bool readFrameMetadataFile(const std::string& path, std::vector<FrameMetadataRecord>& records) {
+    records.clear();
+    FILE* src = fopen(path.c_str(), "rb");
+    if (!src) {
+        return false;
+    }
+
+    FrameMetadataHeader header;
+    bool ok = fread(&header, sizeof(header), 1, src) == 1 &&
+              memcmp(header.magic, FRAME_METADATA_MAGIC, sizeof(header.magic)) == 0 &&
+              header.recordSize == sizeof(FrameMetadataRecord);
+
+    FrameMetadataRecord record;
+    while (ok && fread(&record, sizeof(record), 1, src) == 1) {
+        records.push_back(record);
+    }
+
+    fclose(src);
+    return ok;
+}
@@ -0,0 +1,75 @@
+#ifndef FRAME_METADATA_H
+#define FRAME_METADATA_H
+
+// Binary per-frame metadata sidecar (<recording>.fmeta). The file is a
+// FrameMetadataHeader followed by one fixed-size FrameMetadataRecord per
+// written frame, appended while recording. Records are sorted by capture
+// time, so readers can mmap the file and binary search it.
+//
+// This header has no OpenCV dependency so standalone tools can use it.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define FRAME_METADATA_EXT ".fmeta"
+#define FRAME_METADATA_VERSION 1
+
+// Record flags
+#define META_FLAG_ICR           0x0001
+#define META_FLAG_STABILIZER    0x0002
+#define META_FLAG_ROI           0x0004
+
+struct FrameMetadataHeader {
+    char magic[8];              // "DRIPMETA"
+    uint32_t version;           // FRAME_METADATA_VERSION
+    uint32_t recordSize;        // sizeof(FrameMetadataRecord)
+};
+
+struct FrameMetadataRecord {
+    int64_t captureTimeUs;      // Capture time, microseconds since the Unix epoch
+    uint64_t sequence;          // Capture sequence number within the recording
+    int32_t zoomLevel;          // VISCA zoom position at capture time
+    uint16_t flags;             // META_FLAG_*
+    uint16_t jpegQuality;       // Encoder quality used for this frame
+    uint32_t encodeLatencyUs;   // Time spent encoding and writing the frame
+    uint32_t measuredFpsMilli;  // Measured capture rate x 1000
+    uint32_t detectorCount;     // Detections in this frame (0 when no detector runs)
+    float detectorScore;        // Strongest detection score
+};
+
+static_assert(sizeof(FrameMetadataHeader) == 16, "FrameMetadataHeader layout");
+static_assert(sizeof(FrameMetadataRecord) == 40, "FrameMetadataRecord layout");
+
+static const char FRAME_METADATA_MAGIC[8] = {'D', 'R', 'I', 'P', 'M', 'E', 'T', 'A'};
+
+// Appends records to a sidecar file
+class FrameMetadataWriter {
+public:
+    FrameMetadataWriter();
+    ~FrameMetadataWriter();
+
+    bool open(const std::string& path);
+    bool append(const FrameMetadataRecord& record);
+    void close();
+
+    bool isOpened() const { return file != nullptr; }
+
+private:
+    FILE* file;
+    uint32_t unflushed;
+};
+
+// Append records [firstRecord, endRecord) of a sidecar to an open writer, used
+// when recordings are trimmed or joined on export (one record per written frame)
+bool appendFrameMetadataRange(FrameMetadataWriter& writer, const std::string& srcPath,
+                              uint64_t firstRecord, uint64_t endRecord);
+
+// Read every record of a sidecar
+bool readFrameMetadataFile(const std::string& path, std::vector<FrameMetadataRecord>& records);
+
+// Read the record of one frame, false if the sidecar has no such record
+bool readFrameMetadataRecord(const std::string& path, uint64_t index, FrameMetadataRecord& record);
+
+#endif // FRAME_METADATA_H
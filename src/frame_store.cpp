@@ -0,0 +1,311 @@
+#include "frame_store.h"
+#include "avi_mjpeg.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char FRAME_INDEX_MAGIC[8] = {'D', 'R', 'I', 'P', 'I', 'D', 'X', '1'};
+
+FrameStoreWriter::FrameStoreWriter()
+    : dataFile(nullptr), indexFile(nullptr), dataOffset(0), frames(0) {
+}
+
+FrameStoreWriter::~FrameStoreWriter() {
+    close();
+}
+
+bool FrameStoreWriter::open(const string& basePath, Size size) {
+    close();
+
+    dataFile = fopen((basePath + FRAME_STORE_DATA_EXT).c_str(), "wb");
+    indexFile = fopen((basePath + FRAME_STORE_INDEX_EXT).c_str(), "wb");
+    if (!dataFile || !indexFile) {
+        close();
+        return false;
+    }
+
+    FrameIndexHeader header = {};
+    memcpy(header.magic, FRAME_INDEX_MAGIC, sizeof(header.magic));
+    header.version = 1;
+    header.recordSize = sizeof(FrameIndexRecord);
+    header.width = static_cast<uint32_t>(size.width);
+    header.height = static_cast<uint32_t>(size.height);
+    if (fwrite(&header, sizeof(header), 1, indexFile) != 1 || fflush(indexFile) != 0) {
+        close();
+        return false;
+    }
+
+    dataOffset = 0;
+    frames = 0;
+    return true;
+}
+
+bool FrameStoreWriter::append(const uint8_t* data, size_t size, int64_t timestampUs, uint32_t flags) {
+    if (!dataFile) {
+        return false;
+    }
+
+    if (fwrite(data, 1, size, dataFile) != size) {
+        return false;
+    }
+
+    // Data is flushed before its index record, so a crash never leaves an
+    // index entry pointing past the end of the data file
+    fflush(dataFile);
+
+    FrameIndexRecord record = {timestampUs, dataOffset, static_cast<uint32_t>(size), flags};
+    if (fwrite(&record, sizeof(record), 1, indexFile) != 1) {
+        return false;
+    }
+    fflush(indexFile);
+
+    dataOffset += size;
+    frames++;
+    return true;
+}
+
+void FrameStoreWriter::close() {
+    if (dataFile) {
+        fclose(dataFile);
+        dataFile = nullptr;
+    }
+    if (indexFile) {
+        fclose(indexFile);
+        indexFile = nullptr;
+    }
+}
+
+FrameStoreReader::FrameStoreReader()
+    : indexFd(-1), dataFd(-1), mapping(nullptr), mappingSize(0), records(nullptr), count(0) {
+}
+
+FrameStoreReader::~FrameStoreReader() {
+    close();
+}
+
+bool FrameStoreReader::open(const string& basePath) {
+    close();
+
+    indexFd = ::open((basePath + FRAME_STORE_INDEX_EXT).c_str(), O_RDONLY);
+    dataFd = ::open((basePath + FRAME_STORE_DATA_EXT).c_str(), O_RDONLY);
+    if (indexFd < 0 || dataFd < 0) {
+        close();
+        return false;
+    }
+
+    struct stat indexStat, dataStat;
+    if (fstat(indexFd, &indexStat) != 0 || fstat(dataFd, &dataStat) != 0 ||
+        indexStat.st_size < static_cast<off_t>(sizeof(FrameIndexHeader))) {
+        close();
+        return false;
+    }
+
+    mappingSize = static_cast<size_t>(indexStat.st_size);
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, indexFd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        close();
+        return false;
+    }
+
+    const FrameIndexHeader* header = static_cast<const FrameIndexHeader*>(mapping);
+    if (memcmp(header->magic, FRAME_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->recordSize != sizeof(FrameIndexRecord)) {
+        close();
+        return false;
+    }
+
+    size = Size(static_cast<int>(header->width), static_cast<int>(header->height));
+    records = reinterpret_cast<const FrameIndexRecord*>(static_cast<const uint8_t*>(mapping) + sizeof(FrameIndexHeader));
+    count = (mappingSize - sizeof(FrameIndexHeader)) / sizeof(FrameIndexRecord);
+
+    // Ignore trailing records whose data never made it to disk
+    uint64_t dataSize = static_cast<uint64_t>(dataStat.st_size);
+    while (count > 0 && records[count - 1].offset + records[count - 1].size > dataSize) {
+        count--;
+    }
+
+    return true;
+}
+
+void FrameStoreReader::close() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+    }
+    if (indexFd >= 0) {
+        ::close(indexFd);
+        indexFd = -1;
+    }
+    if (dataFd >= 0) {
+        ::close(dataFd);
+        dataFd = -1;
+    }
+    records = nullptr;
+    count = 0;
+    mappingSize = 0;
+}
+
+size_t FrameStoreReader::findFrame(int64_t timestampUs) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    // First record after the timestamp, then step back one
+    const FrameIndexRecord* end = records + count;
+    const FrameIndexRecord* it = upper_bound(records, end, timestampUs,
+        [](int64_t ts, const FrameIndexRecord& record) { return ts < record.timestampUs; });
+
+    if (it == records) {
+        return 0;
+    }
+    return static_cast<size_t>(it - records) - 1;
+}
+
+bool FrameStoreReader::readFrame(size_t index, vector<uint8_t>& data) const {
+    if (index >= count) {
+        return false;
+    }
+
+    const FrameIndexRecord& record = records[index];
+    data.resize(record.size);
+    return pread(dataFd, data.data(), record.size, static_cast<off_t>(record.offset)) ==
+           static_cast<ssize_t>(record.size);
+}
+
+double FrameStoreReader::fps() const {
+    if (count < 2) {
+        return 30.0;
+    }
+
+    double seconds = (records[count - 1].timestampUs - records[0].timestampUs) / 1000000.0;
+    return seconds > 0 ? (count - 1) / seconds : 30.0;
+}
+
+string frameStoreBasePath(const string& path) {
+    for (const char* ext : {FRAME_STORE_DATA_EXT, FRAME_STORE_INDEX_EXT}) {
+        size_t extLen = strlen(ext);
+        if (path.size() > extLen && path.compare(path.size() - extLen, extLen, ext) == 0) {
+            return path.substr(0, path.size() - extLen);
+        }
+    }
+    return path;
+}
+
+bool isFrameStoreFilename(const string& filename) {
+    size_t extLen = strlen(FRAME_STORE_DATA_EXT);
+    return filename.size() > extLen &&
+           filename.compare(filename.size() - extLen, extLen, FRAME_STORE_DATA_EXT) == 0;
+}
+
+// Capture interval in microseconds of frames [firstFrame, endFrame) recorded
+// back to back: the mean of the intervals close to the shortest ones, so
+// stretches the governor thinned out don't count. 0 for a single frame.
+static double captureIntervalUs(const FrameStoreReader& reader, size_t firstFrame, size_t endFrame) {
+    vector<int64_t> intervals;
+    for (size_t i = firstFrame + 1; i < endFrame; i++) {
+        int64_t interval = reader.record(i).timestampUs - reader.record(i - 1).timestampUs;
+        if (interval > 0) {
+            intervals.push_back(interval);
+        }
+    }
+    if (intervals.empty()) {
+        return 0;
+    }
+
+    vector<int64_t> sorted = intervals;
+    nth_element(sorted.begin(), sorted.begin() + sorted.size() / 10, sorted.end());
+    double shortest = static_cast<double>(sorted[sorted.size() / 10]);
+
+    double sum = 0;
+    size_t count = 0;
+    for (int64_t interval : intervals) {
+        if (interval <= shortest * 1.5) {
+            sum += interval;
+            count++;
+        }
+    }
+    return sum / count;
+}
+
+bool convertFrameStoreToAvi(const string& basePath, const string& aviPath,
+                            size_t firstFrame, size_t endFrame, vector<size_t>* sourceFrames) {
+    FrameStoreReader reader;
+    if (!reader.open(basePath)) {
+        cerr << "ERROR: Could not open frame store: " << basePath << endl;
+        return false;
+    }
+
+    endFrame = min(endFrame, reader.frameCount());
+    if (firstFrame >= endFrame) {
+        cerr << "ERROR: Clip range outside of " << basePath << endl;
+        return false;
+    }
+
+    // Frames left out by the governor or a full queue leave gaps in the
+    // timestamps. An average rate would play those stretches fast, so the AVI
+    // runs at the capture rate and frames repeat until the next one was captured.
+    double intervalUs = captureIntervalUs(reader, firstFrame, endFrame);
+    bool retime = false;
+    for (size_t i = firstFrame + 1; i < endFrame && intervalUs > 0 && !retime; i++) {
+        retime = reader.record(i).timestampUs - reader.record(i - 1).timestampUs > intervalUs * 1.5;
+    }
+    double fps = retime ? 1e6 / intervalUs : reader.fps();
+
+    AviMjpegWriter writer;
+    if (!writer.open(aviPath, reader.frameSize().width, reader.frameSize().height, fps)) {
+        cerr << "ERROR: Could not create AVI: " << aviPath << endl;
+        return false;
+    }
+
+    progressValue = 0;
+    vector<uint8_t> frameData;
+    size_t total = endFrame - firstFrame;
+    int64_t startUs = reader.record(firstFrame).timestampUs;
+    uint64_t written = 0;
+    if (sourceFrames) {
+        sourceFrames->clear();
+    }
+
+    for (size_t i = firstFrame; i < endFrame; i++) {
+        // Shutting down, don't leave a partial file behind
+        if (!isProcessing) {
+            cerr << "Export cancelled: " << aviPath << endl;
+            writer.close();
+            remove(aviPath.c_str());
+            return false;
+        }
+
+        // Frames due by the time the next one was captured, at least this one
+        uint64_t repeats = 1;
+        if (retime && i + 1 < endFrame) {
+            long long due = llround((reader.record(i + 1).timestampUs - startUs) / intervalUs);
+            repeats = due > static_cast<long long>(written) ? static_cast<uint64_t>(due) - written : 1;
+        }
+
+        if (!reader.readFrame(i, frameData)) {
+            cerr << "ERROR: Failed to copy frame " << i << " of " << basePath << endl;
+            writer.close();
+            return false;
+        }
+        for (uint64_t r = 0; r < repeats; r++) {
+            if (!writer.writeFrame(frameData.data(), frameData.size())) {
+                cerr << "ERROR: Failed to copy frame " << i << " of " << basePath << endl;
+                writer.close();
+                return false;
+            }
+            if (sourceFrames) {
+                sourceFrames->push_back(i);
+            }
+        }
+        written += repeats;
+        progressValue = static_cast<int>((i - firstFrame + 1) * 99 / total);
+    }
+
+    bool ok = writer.close();
+    if (ok && retime) {
+        cout << "Retimed " << aviPath << " to " << written << " frames at " << fps << " fps" << endl;
+    }
+    progressValue = 100;
+    return ok;
+}
@@ -0,0 +1,103 @@
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include "common.h"
+
+// Native recording store: an append-only data file of encoded frames
+// (<name>.dfs) plus a fixed-record index file (<name>.dfi) that can be
+// memory-mapped and binary searched by timestamp.
+
+#define FRAME_STORE_DATA_EXT ".dfs"
+#define FRAME_STORE_INDEX_EXT ".dfi"
+
+// Frame flags
+#define FRAME_FLAG_KEYFRAME 0x1
+
+// Index file header, followed by one FrameIndexRecord per frame
+struct FrameIndexHeader {
+    char magic[8];          // "DRIPIDX1"
+    uint32_t version;
+    uint32_t recordSize;    // sizeof(FrameIndexRecord)
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved[2];
+};
+
+struct FrameIndexRecord {
+    int64_t timestampUs;    // Capture time, microseconds since the Unix epoch
+    uint64_t offset;        // Byte offset of the frame in the data file
+    uint32_t size;          // Encoded size in bytes
+    uint32_t flags;         // FRAME_FLAG_*
+};
+
+static_assert(sizeof(FrameIndexHeader) == 32, "FrameIndexHeader layout");
+static_assert(sizeof(FrameIndexRecord) == 24, "FrameIndexRecord layout");
+
+class FrameStoreWriter {
+public:
+    FrameStoreWriter();
+    ~FrameStoreWriter();
+
+    // basePath without extension
+    bool open(const string& basePath, Size size);
+    bool append(const uint8_t* data, size_t size, int64_t timestampUs, uint32_t flags = FRAME_FLAG_KEYFRAME);
+    void close();
+
+    bool isOpened() const { return dataFile != nullptr; }
+    uint64_t frameCount() const { return frames; }
+
+private:
+    FILE* dataFile;
+    FILE* indexFile;
+    uint64_t dataOffset;
+    uint64_t frames;
+};
+
+class FrameStoreReader {
+public:
+    FrameStoreReader();
+    ~FrameStoreReader();
+
+    // basePath without extension
+    bool open(const string& basePath);
+    void close();
+
+    bool isOpened() const { return records != nullptr; }
+    size_t frameCount() const { return count; }
+    Size frameSize() const { return size; }
+    const FrameIndexRecord& record(size_t index) const { return records[index]; }
+
+    // Index of the last frame captured at or before timestampUs (binary search)
+    size_t findFrame(int64_t timestampUs) const;
+
+    // Read the encoded data of one frame
+    bool readFrame(size_t index, vector<uint8_t>& data) const;
+
+    // Average frame rate over the whole store
+    double fps() const;
+
+private:
+    int indexFd;
+    int dataFd;
+    void* mapping;
+    size_t mappingSize;
+    const FrameIndexRecord* records;
+    size_t count;
+    Size size;
+};
+
+// Strip the store extension from a .dfs/.dfi path
+string frameStoreBasePath(const string& path);
+
+// True for frame store data files
+bool isFrameStoreFilename(const string& filename);
+
+// Copy the stored JPEG frames [firstFrame, endFrame) into a standard MJPEG AVI
+// without re-encoding, reporting progress through progressValue. Stretches with
+// left out frames play in real time, frames repeat until the next capture time.
+// sourceFrames receives the store frame of every AVI frame.
+bool convertFrameStoreToAvi(const string& basePath, const string& aviPath,
+                            size_t firstFrame = 0, size_t endFrame = SIZE_MAX,
+                            vector<size_t>* sourceFrames = nullptr);
+
+#endif // FRAME_STORE_H
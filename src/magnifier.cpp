@@ -0,0 +1,141 @@
+#include "magnifier.h"
+#include "camera.h"
+#include "preview_scaler.h"
+#include "roi_recording.h"
+
+static bool magnifierShown = false;
+
+// Inset in preview coordinates, magnified region center in camera frame coordinates
+static Rect insetRect;
+static Point2d regionCenter(-1, -1);
+static int regionZoomLevel = 0;
+
+// Drag state, either the inset or the region outline
+static bool insetDragActive = false;
+static bool regionDragActive = false;
+static Point dragLast;
+
+static PreviewScaler magnifierScaler;
+
+static Size cameraFrameSize() {
+    Size frameSize = capturedFrameSize();
+    if (frameSize.width > 0 && frameSize.height > 0) {
+        return frameSize;
+    }
+    return Size(WIDTH, HEIGHT);
+}
+
+// Optical magnification for a VISCA zoom position, same scale as the zoom log message
+static double opticalMagnification(int level) {
+    return 1.0 + (level / 16384.0) * (appConfig.getDouble("OPTICAL_ZOOM_MAX", 30.0) - 1.0);
+}
+
+// Camera frame area shown in the inset
+static Rect regionRect(Size cameraSize) {
+    double zoom = max(1.0, appConfig.getDouble("MAGNIFIER_ZOOM", 4.0));
+    Size size(min(cameraSize.width, max(1, cvRound(insetRect.width / zoom))),
+              min(cameraSize.height, max(1, cvRound(insetRect.height / zoom))));
+
+    // Keep the whole region inside the frame
+    regionCenter.x = min(max(regionCenter.x, size.width / 2.0), cameraSize.width - size.width / 2.0);
+    regionCenter.y = min(max(regionCenter.y, size.height / 2.0), cameraSize.height - size.height / 2.0);
+
+    return Rect(cvRound(regionCenter.x - size.width / 2.0), cvRound(regionCenter.y - size.height / 2.0),
+                size.width, size.height) & Rect(0, 0, cameraSize.width, cameraSize.height);
+}
+
+// The scene scales around the frame center with the optical zoom, so move the
+// region center the same way to keep the same object under the magnifier
+static void followZoom(Size cameraSize) {
+    if (zoomLevel == regionZoomLevel) {
+        return;
+    }
+
+    double ratio = opticalMagnification(zoomLevel) / opticalMagnification(regionZoomLevel);
+    double centerX = cameraSize.width / 2.0;
+    double centerY = cameraSize.height / 2.0;
+    regionCenter.x = centerX + (regionCenter.x - centerX) * ratio;
+    regionCenter.y = centerY + (regionCenter.y - centerY) * ratio;
+    regionZoomLevel = zoomLevel;
+}
+
+void toggleMagnifier() {
+    magnifierShown = !magnifierShown;
+    insetDragActive = false;
+    regionDragActive = false;
+
+    if (magnifierShown && insetRect.empty()) {
+        // Start above the nav bar in the bottom-right corner, looking at the frame center
+        int width = appConfig.getInt("MAGNIFIER_WIDTH", 320);
+        int height = appConfig.getInt("MAGNIFIER_HEIGHT", 240);
+        insetRect = Rect(DISPLAY_WIDTH - width - 10, DISPLAY_HEIGHT - NAV_BAR_HEIGHT - height - 10, width, height);
+
+        Size cameraSize = cameraFrameSize();
+        regionCenter = Point2d(cameraSize.width / 2.0, cameraSize.height / 2.0);
+        regionZoomLevel = zoomLevel;
+    }
+
+    setLogMessage(magnifierShown ? "Magnifier: ON" : "Magnifier: OFF");
+}
+
+bool handleMagnifierMouse(int event, int x, int y) {
+    if (!magnifierShown) {
+        return false;
+    }
+
+    Point point(x, y);
+    if (event == EVENT_LBUTTONDOWN) {
+        Size cameraSize = cameraFrameSize();
+        Rect outline = frameToPreviewRect(regionRect(cameraSize), cameraSize, Size(DISPLAY_WIDTH, DISPLAY_HEIGHT));
+
+        // Give small outlines a few pixels of slack so they can still be grabbed
+        Rect grab(outline.x - 6, outline.y - 6, outline.width + 12, outline.height + 12);
+        insetDragActive = insetRect.contains(point);
+        regionDragActive = !insetDragActive && grab.contains(point);
+        dragLast = point;
+        return insetDragActive || regionDragActive;
+    }
+    else if (event == EVENT_MOUSEMOVE && (insetDragActive || regionDragActive)) {
+        Point delta = point - dragLast;
+        dragLast = point;
+
+        if (insetDragActive) {
+            insetRect.x = min(max(insetRect.x + delta.x, 0), DISPLAY_WIDTH - insetRect.width);
+            insetRect.y = min(max(insetRect.y + delta.y, 0), DISPLAY_HEIGHT - insetRect.height);
+        } else {
+            Size cameraSize = cameraFrameSize();
+            regionCenter.x += delta.x * static_cast<double>(cameraSize.width) / DISPLAY_WIDTH;
+            regionCenter.y += delta.y * static_cast<double>(cameraSize.height) / DISPLAY_HEIGHT;
+        }
+        return true;
+    }
+    else if (event == EVENT_LBUTTONUP && (insetDragActive || regionDragActive)) {
+        insetDragActive = false;
+        regionDragActive = false;
+        return true;
+    }
+
+    return false;
+}
+
+void drawMagnifier(Mat& uiFrame, const Mat& frame) {
+    if (!magnifierShown || frame.empty()) {
+        return;
+    }
+
+    Size cameraSize = frame.size();
+    followZoom(cameraSize);
+    Rect region = regionRect(cameraSize);
+    Rect inset = insetRect & Rect(0, 0, uiFrame.cols, uiFrame.rows);
+    if (region.empty() || inset.empty()) {
+        return;
+    }
+
+    // Outline what is magnified on the preview
+    Rect outline = frameToPreviewRect(region, cameraSize, uiFrame.size());
+    rectangle(uiFrame, outline, HIGHLIGHT_COLOR, 1);
+
+    // Upscale straight from the full resolution frame, the work is per inset pixel
+    magnifierScaler.scale(frame, region, uiFrame, inset);
+    rectangle(uiFrame, inset, HIGHLIGHT_COLOR, 2);
+}
@@ -0,0 +1,21 @@
+#ifndef MAGNIFIER_H
+#define MAGNIFIER_H
+
+#include "common.h"
+
+// Picture-in-picture magnifier: a small region of the full resolution camera
+// frame upscaled into an inset on the preview. The inset and the magnified
+// region (outlined on the preview) can both be dragged. When the optical zoom
+// changes, the region moves with the scene. MAGNIFIER_ZOOM is inset pixels
+// per camera pixel.
+
+// Show or hide the magnifier
+void toggleMagnifier();
+
+// Handle mouse input on the inset or the region outline, returns true if consumed
+bool handleMagnifierMouse(int event, int x, int y);
+
+// Draw the region outline and the inset, only the inset's pixels are scaled
+void drawMagnifier(Mat& uiFrame, const Mat& frame);
+
+#endif // MAGNIFIER_H
@@ -7,6 +7,20 @@
 #include "export_dialog.h"
 #include "ui_helpers.h"
 #include "navigation_bar.h"
+#include "roi_recording.h"
+#include "metrics.h"
+#include "thermal_monitor.h"
+#include "text_overlay.h"
+#include "ui_compositor.h"
+#include "display.h"
+#include "preview_scaler.h"
+#include "magnifier.h"
+#include "perf_hud.h"
+#include "control_socket.h"
+#include "review_player.h"
+#include "thumbnail_cache.h"
+#include "directory_browser.h"
+#include <csignal>
 
 // Global variables that need to be in main
 Config appConfig;
@@ -16,17 +30,24 @@ string exportDestDir = "./recordings/";
 vector<string> recordingFiles;
 vector<bool> fileSelection;
 bool keepOriginalFiles = true;
+bool exportProxiesOnly = false;
+bool exportJoinFiles = false;
+vector<int> trimStartFrames;
+vector<int> trimEndFrames;
+int trimFileIndex = -1;
 int scrollOffset = 0;
 const int maxFilesVisible = 10;
 Rect fileListRect;
 Rect dirSelectRect;
 Rect keepFilesRect;
+Rect proxiesOnlyRect;
+Rect joinFilesRect;
 Rect exportConfirmRect;
 Rect exportCancelRect;
 Rect scrollUpRect;
 Rect scrollDownRect;
 
-queue<Mat> frameQueue;
+queue<RecordingFrame> frameQueue;
 mutex queueMutex;
 condition_variable frameCondition;
 atomic<bool> recordingThreadActive(false);
@@ -34,13 +55,10 @@ thread recordingThread;
 double recordingDurationSeconds = 0.0;
 
 // Define global variables
-bool isRecording = false;
+atomic<bool> isRecording(false);
 VideoWriter videoWriter;
 string filename;
 string tempFilename;
-bool isFirstFrame = true;
-Size frameSize;
-deque<double> fpsHistory;
 const int FPS_HISTORY_SIZE = 30;
 system_clock::time_point recordingStartTime;
 int WIDTH = 1280;
@@ -53,33 +71,27 @@ thread processingThread;
 atomic<bool> isProcessing(false);
 mutex frameMutex;
 
-// Directory dialog variables
-atomic<bool> directoryDialogActive(false);
-mutex directoryResultMutex;
-string selectedDirectoryResult = "";
-bool directoryResultReady = false;
-
 // Zoom control variables
-int zoomLevel = 0;
+atomic<int> zoomLevel(0);
 int maxZoomLevel = 0x4000;
 Rect zoomInButtonRect;
 Rect zoomOutButtonRect;
-bool serialInitialized = false;
 
 // Button holding state variables
 bool isZoomInHeld = false;
 bool isZoomOutHeld = false;
-system_clock::time_point lastZoomTime;
+steady_clock::time_point lastZoomTime;
 int ZOOM_DELAY_MS = 100;
 
 // New control variables for ICR and IR Correction
-bool icrModeEnabled = false;
+atomic<bool> icrModeEnabled(false);
 Rect icrButtonRect;
-bool stabilizerEnabled = false;
+atomic<bool> stabilizerEnabled(false);
 Rect stabilizerButtonRect;
 
 // Display options
 bool showFPS = false;
+bool headlessMode = false;
 bool showNavBar = true;
 Rect navBarRect;
 Rect toggleNavButtonRect;
@@ -120,13 +132,17 @@ const int progressMax = 100;
 // Log message
 string logMessage = "";
 mutex logMutex;
+atomic<uint64_t> logMessageVersion(0);
 
 int isFullscreen = true;
 
 // Function to safely update log message
 void setLogMessage(const string& message) {
     lock_guard<mutex> lock(logMutex);
-    logMessage = message;
+    if (logMessage != message) {
+        logMessage = message;
+        logMessageVersion++;
+    }
 }
 
 // Function to safely get log message
@@ -135,6 +151,96 @@ string getLogMessage() {
     return logMessage;
 }
 
+// SIGINT/SIGTERM end the headless loop so the recording is closed cleanly
+static atomic<bool> shutdownRequested(false);
+
+static void requestShutdown(int) {
+    shutdownRequested = true;
+}
+
+// Stop capture and every background thread, close a running recording
+static void shutdownPipeline(VideoCapture& cap) {
+    stopCaptureThread();
+    stopControlServer();
+    if (isRecording && recordingStreamsOpen()) {
+        closeRecordingStreams();
+        cout << "Stopped recording and saved to " << tempFilename << endl;
+    }
+
+    // Cancel any ongoing processing
+    if (isProcessing) {
+        isProcessing = false;
+        if (processingThread.joinable()) {
+            processingThread.join();
+        }
+    }
+
+    // Writes still queued go out before the port is closed
+    stopViscaEngine();
+
+    stopThermalMonitor();
+    stopMetricsExporter();
+
+    cout << "Closing the camera" << endl;
+    cap.release();
+}
+
+// Capture, recording and serial control without a window. Nothing is
+// rendered, commands arrive through the control socket.
+static int runHeadless() {
+    signal(SIGINT, requestShutdown);
+    signal(SIGTERM, requestShutdown);
+
+    startMetricsExporter();
+    startThermalMonitor();
+    startViscaEngine();
+
+    VideoCapture cap;
+    cameraConfig(&cap);
+    if (!startControlServer()) {
+        cerr << "ERROR: Headless mode without a control socket" << endl;
+    }
+
+    cout << "Running headless. Send SIGTERM or \"quit\" to exit." << endl;
+    setLogMessage("");
+    startCaptureThread(&cap);
+
+    string shownLog;
+    while (!shutdownRequested && !controlQuitRequested() && captureRunning()) {
+        // A failed writer stops the recording here, like in the UI loop
+        if (isRecording && recordingStreamsOpen() && recordingWriteFailed()) {
+            stopRecording();
+            setLogMessage("Error");
+        }
+
+        serviceControlCommands();
+
+        // Keep the stage timings in the exported metrics
+        refreshPerfHud(false);
+
+        // The status line that would be on screen goes to the log instead
+        string log = getLogMessage();
+        if (log != shownLog) {
+            cout << "Status: " << log << endl;
+            shownLog = log;
+        }
+
+        this_thread::sleep_for(milliseconds(20));
+    }
+
+    // Wait for the post-processing of the last recording instead of cancelling it
+    if (isRecording) {
+        stopRecording();
+    }
+    if (processingThread.joinable()) {
+        processingThread.join();
+    }
+
+    shutdownPipeline(cap);
+    cout << "Bye!" << endl;
+    return 0;
+}
+
 int main(int argc, char** argv) {
     int result = system("/opt/license");
     if (result != 0) {
@@ -151,28 +257,30 @@ int main(int argc, char** argv) {
     HEIGHT = appConfig.getInt("CAMERA_HEIGHT", 720);
     exportDestDir = appConfig.getString("EXPORT_DEST_DIR", "./recordings/");
     keepOriginalFiles = appConfig.getBool("KEEP_ORIGINAL_FILES", true);
+    exportProxiesOnly = appConfig.getBool("EXPORT_PROXIES_ONLY", false);
+    exportJoinFiles = appConfig.getBool("EXPORT_JOIN_FILES", false);
     showFPS = appConfig.getBool("SHOW_FPS", false);
     showNavBar = appConfig.getBool("SHOW_NAV_BAR", true);
     bool useFullscreen = appConfig.getBool("FULL_SCREEN", true);
+
+    // --headless or HEADLESS = true: no window, no X11 connection
+    headlessMode = appConfig.getBool("HEADLESS", false);
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--headless") {
+            headlessMode = true;
+        }
+    }
+    if (headlessMode) {
+        return runHeadless();
+    }
     
     // Create a window with a specific size
     int windowWidth = DISPLAY_WIDTH;
     int windowHeight = DISPLAY_HEIGHT;
 
-    // Create a window and set it to fullscreen consistently
-    namedWindow("Water Dripping Investigation Recording Tools", WINDOW_GUI_NORMAL);
-    resizeWindow("Water Dripping Investigation Recording Tools", windowWidth, windowHeight);
-
-    if (useFullscreen) {
-        // Enter true fullscreen mode (no window decorations)
-        setWindowProperty("Water Dripping Investigation Recording Tools", WND_PROP_FULLSCREEN, WINDOW_FULLSCREEN);
-    } else {
-        destroyWindow("Water Dripping Investigation Recording Tools");
-        namedWindow("Water Dripping Investigation Recording Tools", WINDOW_GUI_NORMAL);
-        resizeWindow("Water Dripping Investigation Recording Tools", windowWidth, windowHeight);
-    }
-
-    setMouseCallback("Water Dripping Investigation Recording Tools", mouseCallback, NULL);
+    // Create the window, presenting through X11 shared memory when available
+    openDisplay("Water Dripping Investigation Recording Tools", windowWidth, windowHeight, useFullscreen, mouseCallback);
+    isFullscreen = useFullscreen;
 
     // Initialize UI component positions
     initializeUI(windowWidth, windowHeight);
@@ -183,6 +291,15 @@ int main(int argc, char** argv) {
     // Update toggle button position
     updateToggleButtonPosition(windowWidth);
 
+    // Export metrics for monitoring
+    startMetricsExporter();
+
+    // Watch the SoC temperature and shed optional work before the firmware throttles
+    startThermalMonitor();
+
+    // Camera control commands are written on their own thread
+    startViscaEngine();
+
     // Configure camera
     VideoCapture cap;
     cameraConfig(&cap);
@@ -192,10 +309,6 @@ int main(int argc, char** argv) {
     cout << "Camera opened successfully. Press ESC to exit." << endl;
     setLogMessage("");
 
-    bool videoWriterInitialized = false;
-    system_clock::time_point previousFrameTime = system_clock::now();
-    double currentFPS = 0.0;
-
     // Load record and stop images/icons
     Mat recIcon(BTN_HEIGHT, BTN_HEIGHT, CV_8UC3, Scalar(0, 200, 0));  // Green
     Mat stopIcon(BTN_HEIGHT, BTN_HEIGHT, CV_8UC3, Scalar(200, 0, 0)); // Red
@@ -208,82 +321,134 @@ int main(int argc, char** argv) {
     // Create overlay for navigation bar
     Mat navBarOverlay(NAV_BAR_HEIGHT, windowWidth, CV_8UC3, Scalar(40, 40, 40));
 
+    // Glyphs are rendered once, each frame only blits the characters that changed
+    TextOverlay previewOverlay(FONT_HERSHEY_SIMPLEX, 0.7, 2);
+
+    // Capture runs on its own thread at camera rate. The UI renders the newest
+    // frame at most DISPLAY_MAX_FPS times a second and skips the rest.
+    double maxRenderFps = max(1.0, appConfig.getDouble("DISPLAY_MAX_FPS", 30.0));
+    steady_clock::time_point nextRender = steady_clock::now();
+    steady_clock::time_point renderWindowStart = nextRender;
+    int renderedInWindow = 0;
+    double renderFps = 0.0;
+    uint64_t shownSequence = 0;
+    OverlayLine overlayLine;
+    PreviewScaler previewScaler;
+    vector<PreviewTint> previewTints;
+
+    // Recording list thumbnails for the export dialog, at idle priority
+    startThumbnailWorker();
+
+    // The control socket works alongside the window as well
+    startControlServer();
+
+    startCaptureThread(&cap);
+
     while (true) {
-        if (getWindowProperty("Water Dripping Investigation Recording Tools", WND_PROP_VISIBLE) < 1) {
+        if (!displayOpen()) {
             cout << "Window closed, exiting..." << endl;
             break;
         }
 
-        bool frameRead = cap.read(frame);
-        if (!frameRead || frame.empty()) {
-            cerr << "ERROR: Unable to grab from the camera" << endl;
-            setLogMessage("Error");
+        if (!captureRunning()) {
             break;
         }
-        
-        // Calculate FPS
-        currentFPS = calculateFPS(previousFrameTime);
-
-        // Update FPS history
-        fpsHistory.push_back(currentFPS);
-        if (fpsHistory.size() > FPS_HISTORY_SIZE) {
-            fpsHistory.pop_front();
+
+        // A failed writer stops the recording here, on the thread that owns the UI state
+        if (isRecording && recordingStreamsOpen() && recordingWriteFailed()) {
+            stopRecording();
+            setLogMessage("Error");
         }
 
-        // Calculate average FPS from history
-        double avgFPS = 0;
-        for (const auto& fps : fpsHistory) {
-            avgFPS += fps;
+        // Check for held zoom buttons and perform continuous zooming
+        auto currentTime = steady_clock::now();
+        duration<double, milli> elapsed = currentTime - lastZoomTime;
+
+        if ((isZoomInHeld || isZoomOutHeld) && elapsed.count() >= ZOOM_DELAY_MS) {
+            if (isZoomInHeld) {
+                zoomIn();
+            }
+            else if (isZoomOutHeld) {
+                zoomOut();
+            }
+            lastZoomTime = currentTime;
+        }
+
+        // Remote commands run here, on the thread that owns the recording state
+        serviceControlCommands();
+        if (controlQuitRequested())
+            break;
+
+        // Input is handled between renders as well
+        int key = pollDisplayEvents(1);
+        if (key == 27) // ESC key
+            break;
+        if (key >= 0) {
+            handleShortcutKey(key);
         }
-        avgFPS = avgFPS / fpsHistory.size();
 
-        // Store frame size on first successful capture
-        if (isFirstFrame) {
-            frameSize = frame.size();
-            isFirstFrame = false;
-            cout << "Actual frame size: " << frameSize.width << "x" << frameSize.height << endl;
+        // When running hot the render period is stretched, capture is unaffected
+        steady_clock::time_point now = steady_clock::now();
+        if (now < nextRender) {
+            this_thread::sleep_for(min(duration_cast<microseconds>(nextRender - now), microseconds(5000)));
+            continue;
         }
 
-        // Initialize VideoWriter if recording is requested and not yet initialized
-        if (isRecording && !videoWriterInitialized) {
-            // Check if we have valid frame dimensions
-            if (frameSize.width > 0 && frameSize.height > 0) {
-                int codec = VideoWriter::fourcc('M', 'J', 'P', 'G');
-                double fps = 30.0; // Target FPS for raw recording
-
-                // Use temp filename for direct recording to file
-                videoWriter.open(tempFilename, codec, fps, frameSize, true);
-
-                if (!videoWriter.isOpened()) {
-                    cerr << "ERROR: Could not open the output video file for write" << endl;
-                    isRecording = false;
-                    setLogMessage("Error");
-                } else {
-                    videoWriterInitialized = true;
-                    cout << "Started recording to " << tempFilename << endl;
-                    setLogMessage("Recording...");
-                }
-            } else {
-                cerr << "ERROR: Invalid frame dimensions: " << frameSize.width << "x" << frameSize.height << endl;
-                isRecording = false;
-                setLogMessage("Error");
+        auto renderPeriod = duration_cast<steady_clock::duration>(
+            duration<double>(thermalPreviewInterval() / maxRenderFps));
+
+        // The preview behind the export dialog stays frozen, so the UI only
+        // redraws when the dialog changes and capture keeps the CPU
+        if (showExportDialog && exportDialogBackgroundFrozen()) {
+            nextRender = now + renderPeriod;
+            if (drawExportDialog(uiFrame)) {
+                // Keep the window controls above the dialog
+                compositeUiLayer(uiFrame, LAYER_WINDOW_CONTROLS);
+                presentFrame(uiFrame);
             }
+            continue;
+        }
+
+        // Only the newest frame is rendered, frames captured in between are never shown
+        if (!takeLatestFrame(frame, overlayLine, shownSequence)) {
+            this_thread::sleep_for(milliseconds(1));
+            continue;
         }
 
-        // Create a full screen frame from camera input
-        resize(frame, uiFrame, Size(windowWidth, windowHeight));
+        nextRender = max(nextRender + renderPeriod, now);
+
+        // Rendered fps is reported next to the captured fps
+        renderedInWindow++;
+        double windowSeconds = duration<double>(now - renderWindowStart).count();
+        if (windowSeconds >= 1.0) {
+            renderFps = renderedInWindow / windowSeconds;
+            setMetric("render_fps", renderFps);
+            renderedInWindow = 0;
+            renderWindowStart = now;
+        }
 
-        // Display date, time and FPS on the video
-        string dateStr = getCurrentDateStr();
-        string timeStr = getCurrentTimeStr();
-        string displayStr = dateStr + " " + timeStr;
         if (showFPS) {
-            displayStr += " FPS: " + to_string(int(avgFPS));
+            int written = snprintf(overlayLine.text + overlayLine.length, OVERLAY_TEXT_MAX - overlayLine.length,
+                                   " UI: %d", int(renderFps));
+            overlayLine.length = min(static_cast<size_t>(OVERLAY_TEXT_MAX - 1), overlayLine.length + max(0, written));
+        }
+
+        // Downscale the camera frame and blend the nav bar panel and dialog
+        // dimming in the same pass over the full screen frame
+        steady_clock::time_point resizeStart = steady_clock::now();
+        collectPreviewTints(previewTints);
+        previewScaler.scale(frame, uiFrame, Size(windowWidth, windowHeight), previewTints);
+        steady_clock::time_point overlayStart = steady_clock::now();
+        recordStageTime(STAGE_RESIZE, duration<double, milli>(overlayStart - resizeStart).count());
+
+        // Everything else behind the export dialog stays hidden under the dimming
+        if (!showExportDialog) {
+            // Display date, time and FPS on the video
+            previewOverlay.draw(uiFrame, overlayLine, Point(10, 30), TEXT_COLOR);
         }
-        putText(uiFrame, displayStr, Point(10, 30), FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
 
         // Show recording indicator in top-right corner if recording
-        if (isRecording) {
+        if (isRecording && !showExportDialog) {
             // Position the recording indicator to avoid conflict with minimize/close buttons
             int recIndicatorX = minimizeButtonRect.x - 140; // Leave space for text
             Rect recIndicator(recIndicatorX, 10, 20, 20);
@@ -302,116 +467,37 @@ int main(int argc, char** argv) {
             putText(uiFrame, timeBuffer, timePos, FONT_HERSHEY_SIMPLEX, UI_FONT_SIZE, Scalar(255, 255, 255), 2);
         }
 
-        // Draw navigation bar if visible
-        if (showNavBar) {
-            drawNavigationBar(uiFrame, windowWidth, isRecording, isProcessing, isZoomInHeld, isZoomOutHeld);
-        }
-
-        // Update toggle button position and draw it
+        // Update toggle button position, then re-render only the widgets whose state changed
         updateToggleButtonPosition(windowWidth);
+        updateUiLayers(windowWidth);
 
-        if (showNavBar) {
-            // Draw down arrow (to hide navigation bar)
-            downArrowImage.copyTo(uiFrame(toggleNavButtonRect));
-        } else {
-            // Draw up arrow (to show navigation bar)
-            upArrowImage.copyTo(uiFrame(toggleNavButtonRect));
-        }
+        if (!showExportDialog) {
+            // Draw recording ROIs on the preview
+            drawRecordingRois(uiFrame, windowWidth, windowHeight);
 
-        // Check for held zoom buttons and perform continuous zooming
-        auto currentTime = system_clock::now();
-        duration<double, milli> elapsed = currentTime - lastZoomTime;
+            // Inset of the full resolution frame, below the UI widgets
+            drawMagnifier(uiFrame, frame);
 
-        if ((isZoomInHeld || isZoomOutHeld) && elapsed.count() >= ZOOM_DELAY_MS) {
-            if (isZoomInHeld) {
-                zoomIn();
-            }
-            else if (isZoomOutHeld) {
-                zoomOut();
-            }
-            lastZoomTime = currentTime;
-        }
-
-        // If recording, write frame directly to temp file
-        if (isRecording && videoWriterInitialized) {
-            try {
-                // Add overlays to the frame before saving
-                Mat frameWithOverlay = frame.clone();
-
-                // Add date, time and FPS in a single line
-                string dateStr = getCurrentDateStr();
-                string timeStr = getCurrentTimeStr();
-                string displayStr = dateStr + " " + timeStr;
-                if (showFPS) {
-                    displayStr += " FPS: " + to_string(int(avgFPS));
-                }
-
-                putText(frameWithOverlay, displayStr, Point(10, 30),
-                        FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
-
-                videoWriter.write(frameWithOverlay);
-            } catch (const cv::Exception& e) {
-                cerr << "ERROR: Exception while writing video: " << e.what() << endl;
-                videoWriter.release();
-                isRecording = false;
-                videoWriterInitialized = false;
-                setLogMessage("Error");
-            }
+            // Blend the cached nav bar, toggle, ICR and window control layers
+            compositeUiLayers(uiFrame);
         } else {
-            // Reset videoWriterInitialized when not recording
-            videoWriterInitialized = false;
-        }
-        
-        if (showExportDialog) {
+            freezeExportDialogBackground(uiFrame);
             drawExportDialog(uiFrame);
-        }
-        
-        // Draw window controls
-        drawWindowControls(uiFrame);
-        
-        if (useFullscreen) {
-            // Enter true fullscreen mode (no window decorations)
-            setWindowProperty("Water Dripping Investigation Recording Tools", WND_PROP_FULLSCREEN, WINDOW_FULLSCREEN);
-            isFullscreen = true;
-        } else {
-            // Normal window
-            isFullscreen = false;
-        }
 
-        checkDirectorySelection();
-        
-        // Draw ICR controls
-        drawIR(uiFrame, false); // Always pass false for bgSubtractionActive parameter
-
-        imshow("Water Dripping Investigation Recording Tools", uiFrame);
-
-        // Check for key press
-        int key = waitKey(1);
-        if (key == 27) // ESC key
-            break;
-    }
-
-    // Clean up
-    if (isRecording && videoWriter.isOpened()) {
-        videoWriter.release();
-        cout << "Stopped recording and saved to " << tempFilename << endl;
-    }
-
-    // Cancel any ongoing processing
-    if (isProcessing) {
-        isProcessing = false;
-        if (processingThread.joinable()) {
-            processingThread.join();
+            // Keep the window controls above the dialog
+            compositeUiLayer(uiFrame, LAYER_WINDOW_CONTROLS);
         }
-    }
+        recordStageTime(STAGE_OVERLAY, duration<double, milli>(steady_clock::now() - overlayStart).count());
 
-    if (serialInitialized) {
-        cameraSerial.closeDevice();
+        presentFrame(uiFrame);
     }
 
-    cout << "Closing the camera" << endl;
-    cap.release();
-    destroyAllWindows();
+    // Clean up
+    closeReview();
+    stopThumbnailWorker();
+    stopDirectoryBrowser();
+    shutdownPipeline(cap);
+    closeDisplay();
     cout << "Bye!" << endl;
     return 0;
 }
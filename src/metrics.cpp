@@ -0,0 +1,80 @@
+#include "metrics.h"
+#include "perf_hud.h"
+#include <map>
+
+static map<string, double> metricValues;
+static mutex metricsMutex;
+static thread metricsThread;
+static atomic<bool> metricsExporterActive(false);
+
+void setMetric(const string& name, double value) {
+    lock_guard<mutex> lock(metricsMutex);
+    metricValues[name] = value;
+}
+
+void incrementMetric(const string& name, double delta) {
+    lock_guard<mutex> lock(metricsMutex);
+    metricValues[name] += delta;
+}
+
+double getMetric(const string& name) {
+    lock_guard<mutex> lock(metricsMutex);
+    auto it = metricValues.find(name);
+    if (it != metricValues.end()) {
+        return it->second;
+    }
+    return 0.0;
+}
+
+static void writeMetricsFile(const string& path) {
+    map<string, double> snapshot;
+    {
+        lock_guard<mutex> lock(metricsMutex);
+        snapshot = metricValues;
+    }
+
+    // Write to a temp file and rename so readers never see a partial file
+    string tempPath = path + ".tmp";
+    ofstream out(tempPath);
+    if (!out.is_open()) {
+        return;
+    }
+
+    // Full precision, large counters would otherwise print as 1.23457e+06
+    out << setprecision(17);
+    for (const auto& metric : snapshot) {
+        out << "drip_" << metric.first << " " << metric.second << "\n";
+    }
+    out.close();
+
+    rename(tempPath.c_str(), path.c_str());
+}
+
+static void metricsExporterLoop(string path, int intervalMs) {
+    setCurrentThreadName("metrics");
+    while (metricsExporterActive) {
+        writeMetricsFile(path);
+
+        // Sleep in small steps so shutdown stays responsive
+        for (int waited = 0; waited < intervalMs && metricsExporterActive; waited += 50) {
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+    }
+}
+
+void startMetricsExporter() {
+    string path = appConfig.getString("METRICS_FILE", "/tmp/drip_metrics.prom");
+    if (path.empty() || metricsExporterActive) {
+        return;
+    }
+
+    metricsExporterActive = true;
+    metricsThread = thread(metricsExporterLoop, path, max(100, appConfig.getInt("METRICS_INTERVAL_MS", 1000)));
+}
+
+void stopMetricsExporter() {
+    metricsExporterActive = false;
+    if (metricsThread.joinable()) {
+        metricsThread.join();
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+
+// Set a gauge to the given value
+void setMetric(const string& name, double value);
+
+// Add to a counter
+void incrementMetric(const string& name, double delta = 1.0);
+
+// Read the current value of a metric (0 if unknown)
+double getMetric(const string& name);
+
+// Start/stop the background exporter that periodically writes all metrics
+// to METRICS_FILE in Prometheus text format (node_exporter textfile collector)
+void startMetricsExporter();
+void stopMetricsExporter();
+
+#endif // METRICS_H
@@ -1,5 +1,6 @@
 #include "navigation_bar.h"
 #include "ui_helpers.h"
+#include "roi_recording.h"
 
 void initNavigationBar(int windowWidth, int windowHeight) {
     // Bottom navigation bar (full width, 80px height at bottom)
@@ -26,6 +27,10 @@ void initNavigationBar(int windowWidth, int windowHeight) {
 
     // Zoom Out button
     zoomOutButtonRect = Rect(startX, buttonY, btnWidth, btnHeight);
+    startX += btnWidth + btnSpacing;
+
+    // ROI button
+    roiButtonRect = Rect(startX, buttonY, btnWidth, btnHeight);
 }
 
 void drawNavigationBar(Mat& img, int windowWidth, bool isRecording, bool isProcessing, 
@@ -34,12 +39,7 @@ void drawNavigationBar(Mat& img, int windowWidth, bool isRecording, bool isProce
         return;
     }
     
-    // Create semi-transparent navigation bar at the bottom
-    Mat bottomBar = img(navBarRect).clone();
-    Mat overlay(bottomBar.rows, bottomBar.cols, bottomBar.type(), Scalar(20, 60, 20));
-    double alpha = 0.7; // Transparency level (0.0 = fully transparent, 1.0 = opaque)
-    addWeighted(overlay, alpha, bottomBar, 1.0 - alpha, 0.0, bottomBar);
-    bottomBar.copyTo(img(navBarRect));
+    // The semi-transparent bar background is the compositor's panel (see updateUiLayers)
 
     // Draw record/stop button
     rectangle(img, recordButtonRect, isRecording ? Scalar(60, 0, 0) : BUTTON_COLOR, -1);
@@ -70,13 +70,29 @@ void drawNavigationBar(Mat& img, int windowWidth, bool isRecording, bool isProce
             Point(zoomOutButtonRect.x + 10, zoomOutButtonRect.y + zoomOutButtonRect.height/2 + 5),
             FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.2);
 
+    // ROI button
+    rectangle(img, roiButtonRect, roiEditMode ? Scalar(100, 200, 100) : BUTTON_COLOR, -1);
+    rectangle(img, roiButtonRect, Scalar(100, 100, 100), 1);
+    putText(img, recordingRois.empty() ? "ROI" : "ROI (" + to_string(recordingRois.size()) + ")",
+            Point(roiButtonRect.x + 10, roiButtonRect.y + roiButtonRect.height/2 + 5),
+            FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.2);
+
     // Status display
-    int statusX = zoomOutButtonRect.x + zoomOutButtonRect.width + 20;
-    Rect statusRect(statusX, navBarRect.y + 10, windowWidth - statusX - PADDING, zoomOutButtonRect.height);
+    int statusX = roiButtonRect.x + roiButtonRect.width + 20;
+    Rect statusRect(statusX, navBarRect.y + 10, windowWidth - statusX - PADDING, roiButtonRect.height);
     rectangle(img, statusRect, Scalar(40, 40, 40), -1);
 
+    // Post-processing and export progress fills the status box from the left
+    string status = getLogMessage();
+    if (isProcessing) {
+        int progress = max(0, min(100, progressValue.load()));
+        Rect progressRect(statusRect.x, statusRect.y, statusRect.width * progress / 100, statusRect.height);
+        rectangle(img, progressRect, Scalar(40, 90, 40), -1);
+        status += " " + to_string(progress) + "%";
+    }
+
     // Show status/log message
-    putText(img, getLogMessage(), 
+    putText(img, status,
             Point(statusRect.x + 10, statusRect.y + statusRect.height/2 + 5),
             FONT_HERSHEY_SIMPLEX, 0.6, TEXT_COLOR, 2.2);
 }
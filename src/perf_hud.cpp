@@ -0,0 +1,228 @@
+#include "perf_hud.h"
+#include "metrics.h"
+#include "proxy_recording.h"
+#include <dirent.h>
+#include <pthread.h>
+
+#define PERF_SAMPLES 120
+
+static const char* stageNames[STAGE_COUNT] = {
+    "capture", "convert", "resize", "overlay", "write", "present"
+};
+
+// Rolling window of the last PERF_SAMPLES samples per stage
+struct StageSamples {
+    double samples[PERF_SAMPLES];
+    size_t count = 0;
+    size_t next = 0;
+};
+
+static mutex perfMutex;
+static StageSamples stageSamples[STAGE_COUNT];
+static atomic<size_t> queueDepth(0);
+static atomic<size_t> maxQueueDepth(0);
+
+// What the HUD shows, only touched by the UI thread
+struct ThreadCpu {
+    string name;
+    double percent;
+};
+
+struct PerfSnapshot {
+    double average[STAGE_COUNT];
+    double peak[STAGE_COUNT];
+    size_t queueDepth;
+    size_t maxQueueDepth;
+    double recordingDropped;
+    int proxyDropped;
+    double inputDropped;
+    double captureFps;
+    vector<ThreadCpu> threads;
+};
+
+static PerfSnapshot snapshot = {};
+static uint64_t snapshotVersion = 0;
+static steady_clock::time_point lastRefresh;
+
+// CPU ticks per thread id at the previous sample
+static map<int, unsigned long long> previousTicks;
+static steady_clock::time_point previousCpuSample;
+
+void recordStageTime(PerfStage stage, double ms) {
+    lock_guard<mutex> lock(perfMutex);
+    StageSamples& s = stageSamples[stage];
+    s.samples[s.next] = ms;
+    s.next = (s.next + 1) % PERF_SAMPLES;
+    s.count = min(s.count + 1, static_cast<size_t>(PERF_SAMPLES));
+}
+
+void recordQueueDepth(size_t depth) {
+    queueDepth = depth;
+    if (depth > maxQueueDepth) {
+        maxQueueDepth = depth;
+    }
+}
+
+void setCurrentThreadName(const char* name) {
+    pthread_setname_np(pthread_self(), name);
+}
+
+// utime + stime of every thread of this process, from /proc/self/task/<tid>/stat
+static void sampleThreadCpu(vector<ThreadCpu>& threads) {
+    steady_clock::time_point now = steady_clock::now();
+    double elapsedTicks = duration<double>(now - previousCpuSample).count() * sysconf(_SC_CLK_TCK);
+    bool havePrevious = !previousTicks.empty();
+
+    map<int, unsigned long long> ticks;
+    threads.clear();
+
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) {
+        return;
+    }
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        int tid = atoi(ent->d_name);
+        if (tid <= 0) {
+            continue;
+        }
+
+        ifstream statFile("/proc/self/task/" + string(ent->d_name) + "/stat");
+        string line;
+        if (!getline(statFile, line)) {
+            continue;
+        }
+
+        // The name is in parentheses and may contain spaces, fields follow the last ')'
+        size_t open = line.find('(');
+        size_t close = line.rfind(')');
+        if (open == string::npos || close == string::npos) {
+            continue;
+        }
+        string name = line.substr(open + 1, close - open - 1);
+
+        // After ')' come state (3) ... utime (14) and stime (15)
+        istringstream fields(line.substr(close + 2));
+        string field;
+        unsigned long long utime = 0;
+        unsigned long long stime = 0;
+        for (int index = 3; index <= 15 && fields >> field; index++) {
+            if (index == 14) utime = stoull(field);
+            if (index == 15) stime = stoull(field);
+        }
+        ticks[tid] = utime + stime;
+
+        auto previous = previousTicks.find(tid);
+        if (havePrevious && previous != previousTicks.end() && elapsedTicks > 0) {
+            threads.push_back({name, (ticks[tid] - previous->second) * 100.0 / elapsedTicks});
+        }
+    }
+    closedir(dir);
+
+    // Busiest threads first
+    sort(threads.begin(), threads.end(), [](const ThreadCpu& a, const ThreadCpu& b) {
+        return a.percent > b.percent;
+    });
+
+    previousTicks.swap(ticks);
+    previousCpuSample = now;
+}
+
+uint64_t refreshPerfHud(bool hudShown) {
+    steady_clock::time_point now = steady_clock::now();
+    if (snapshotVersion > 0 && now - lastRefresh < milliseconds(500)) {
+        return snapshotVersion;
+    }
+    lastRefresh = now;
+
+    {
+        lock_guard<mutex> lock(perfMutex);
+        for (int stage = 0; stage < STAGE_COUNT; stage++) {
+            const StageSamples& s = stageSamples[stage];
+            double sum = 0;
+            double peak = 0;
+            for (size_t i = 0; i < s.count; i++) {
+                sum += s.samples[i];
+                peak = max(peak, s.samples[i]);
+            }
+            snapshot.average[stage] = s.count ? sum / s.count : 0;
+            snapshot.peak[stage] = peak;
+        }
+    }
+
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        setMetric(string("stage_") + stageNames[stage] + "_ms", snapshot.average[stage]);
+    }
+
+    snapshot.queueDepth = queueDepth;
+    snapshot.maxQueueDepth = maxQueueDepth.exchange(queueDepth);
+    snapshot.recordingDropped = getMetric("recording_dropped_frames");
+    snapshot.proxyDropped = proxyDroppedFrames();
+    snapshot.inputDropped = getMetric("input_events_dropped");
+    snapshot.captureFps = getMetric("capture_fps");
+
+    if (hudShown) {
+        sampleThreadCpu(snapshot.threads);
+    } else {
+        // Start a fresh CPU interval when the HUD is shown again
+        previousTicks.clear();
+        previousCpuSample = now;
+    }
+
+    return ++snapshotVersion;
+}
+
+void drawPerfHud(Mat& img, Rect area) {
+    rectangle(img, area, Scalar(100, 150, 100), 1);
+
+    int lineHeight = 16;
+    int x = area.x + 8;
+    int y = area.y + 18;
+    char text[96];
+
+    // Bars are scaled to the time one captured frame may take
+    double budgetMs = snapshot.captureFps > 1 ? 1000.0 / snapshot.captureFps : 1000.0 / 30.0;
+    snprintf(text, sizeof(text), "Frame budget %.1f ms (%.1f fps)", budgetMs, snapshot.captureFps);
+    putText(img, text, Point(x, y), FONT_HERSHEY_SIMPLEX, 0.42, TEXT_COLOR, 1);
+    y += lineHeight + 2;
+
+    int labelWidth = 64;
+    int barMax = 140;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        double load = snapshot.average[stage] / budgetMs;
+        Scalar barColor = load < 0.5 ? Scalar(80, 200, 80) : (load < 1.0 ? Scalar(0, 200, 220) : Scalar(0, 0, 255));
+        int barWidth = static_cast<int>(min(1.0, load) * barMax);
+
+        putText(img, stageNames[stage], Point(x, y), FONT_HERSHEY_SIMPLEX, 0.42, TEXT_COLOR, 1);
+        rectangle(img, Rect(x + labelWidth, y - 10, barMax, 10), Scalar(60, 60, 60), -1);
+        if (barWidth > 0) {
+            rectangle(img, Rect(x + labelWidth, y - 10, barWidth, 10), barColor, -1);
+        }
+
+        snprintf(text, sizeof(text), "%.1f / %.1f ms", snapshot.average[stage], snapshot.peak[stage]);
+        putText(img, text, Point(x + labelWidth + barMax + 8, y), FONT_HERSHEY_SIMPLEX, 0.42, TEXT_COLOR, 1);
+        y += lineHeight;
+    }
+
+    snprintf(text, sizeof(text), "Rec queue %zu (max %zu)", snapshot.queueDepth, snapshot.maxQueueDepth);
+    putText(img, text, Point(x, y), FONT_HERSHEY_SIMPLEX, 0.42, TEXT_COLOR, 1);
+    y += lineHeight;
+
+    snprintf(text, sizeof(text), "Dropped: rec %.0f  proxy %d  input %.0f",
+             snapshot.recordingDropped, snapshot.proxyDropped, snapshot.inputDropped);
+    putText(img, text, Point(x, y), FONT_HERSHEY_SIMPLEX, 0.42, TEXT_COLOR, 1);
+    y += lineHeight + 4;
+
+    putText(img, "CPU per thread", Point(x, y), FONT_HERSHEY_SIMPLEX, 0.42, TEXT_COLOR, 1);
+    y += lineHeight;
+
+    for (const ThreadCpu& thread : snapshot.threads) {
+        if (y > area.y + area.height - 6) {
+            break;
+        }
+        snprintf(text, sizeof(text), "%-15s %5.1f%%", thread.name.c_str(), thread.percent);
+        putText(img, text, Point(x, y), FONT_HERSHEY_SIMPLEX, 0.42, TEXT_COLOR, 1);
+        y += lineHeight;
+    }
+}
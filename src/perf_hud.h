@@ -0,0 +1,34 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include "common.h"
+
+// Pipeline stages timed for the performance HUD
+enum PerfStage {
+    STAGE_CAPTURE,      // Camera read and decode
+    STAGE_CONVERT,      // BGR to the display's pixel format
+    STAGE_RESIZE,       // Preview downscale
+    STAGE_OVERLAY,      // Text, widgets and layer compositing
+    STAGE_WRITE,        // Recording encode and write, per frame
+    STAGE_PRESENT,      // Handing the frame to the display
+    STAGE_COUNT
+};
+
+// Add one timing sample in milliseconds, callable from any thread
+void recordStageTime(PerfStage stage, double ms);
+
+// Frames waiting in the recording queue
+void recordQueueDepth(size_t depth);
+
+// Name the calling thread (up to 15 characters) for the HUD's CPU list
+void setCurrentThreadName(const char* name);
+
+// Fold in the latest samples twice a second and export the stage averages as
+// metrics. Per-thread CPU is only sampled while the HUD is shown. Returns a
+// version that changes whenever the HUD needs re-rendering.
+uint64_t refreshPerfHud(bool hudShown);
+
+// Rolling stage timings, queue depth, dropped frames and CPU per thread
+void drawPerfHud(Mat& img, Rect area);
+
+#endif // PERF_HUD_H
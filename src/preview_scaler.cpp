@@ -0,0 +1,209 @@
+#include "preview_scaler.h"
+#include <opencv2/core/hal/intrin.hpp>
+
+// Finish one output row segment [begin, end) of elements: blend the two scaled
+// source rows vertically, round to 8 bits and apply the active tints in order.
+// The SIMD loop and the scalar tail compute exactly the same integer math.
+static void blendRowSegment(const uint16_t* top, const uint16_t* bottom, uint16_t weight,
+                            const uint16_t* const* terms, const uint16_t* factors, int tintCount,
+                            int begin, int end, uchar* out) {
+    uint16_t topWeight = static_cast<uint16_t>(65536 - weight);
+    int i = begin;
+
+#if CV_SIMD128
+    v_uint16x8 vTopWeight = v_setall_u16(topWeight);
+    v_uint16x8 vWeight = v_setall_u16(weight);
+    v_uint16x8 vRound = v_setall_u16(128);
+
+    for (; i + 8 <= end; i += 8) {
+        v_uint16x8 v = v_load(top + i);
+        if (weight) {
+            v = v_add_wrap(v_mul_hi(v, vTopWeight), v_mul_hi(v_load(bottom + i), vWeight));
+        }
+        v = v_shr<8>(v_add_wrap(v, vRound));
+
+        for (int t = 0; t < tintCount; t++) {
+            v = v_shr<8>(v_add_wrap(v_mul_wrap(v, v_setall_u16(factors[t])), v_load(terms[t] + i)));
+        }
+        v_pack_store(out + i, v);
+    }
+#endif
+
+    for (; i < end; i++) {
+        uint32_t v = top[i];
+        if (weight) {
+            // 32 bit products, uint16_t operands would promote to int and overflow
+            v = ((static_cast<uint32_t>(top[i]) * topWeight) >> 16) +
+                ((static_cast<uint32_t>(bottom[i]) * weight) >> 16);
+        }
+        v = (v + 128) >> 8;
+
+        for (int t = 0; t < tintCount; t++) {
+            v = (v * factors[t] + terms[t][i]) >> 8;
+        }
+        out[i] = static_cast<uchar>(v);
+    }
+}
+
+PreviewScaler::PreviewScaler() {
+    rowSource[0] = rowSource[1] = -1;
+}
+
+void PreviewScaler::prepare(Size srcSize, Size dstSize) {
+    if (srcSize == srcGeometry && dstSize == dstGeometry) {
+        return;
+    }
+
+    // Pixel centers are aligned the same way resize(INTER_LINEAR) does,
+    // source coordinates outside the image are clamped to the edge
+    double scaleX = static_cast<double>(srcSize.width) / dstSize.width;
+    xLeft.resize(dstSize.width);
+    xRight.resize(dstSize.width);
+    xWeights.resize(dstSize.width);
+    for (int dx = 0; dx < dstSize.width; dx++) {
+        double fx = (dx + 0.5) * scaleX - 0.5;
+        int sx = cvFloor(fx);
+        double w = fx - sx;
+        if (sx < 0) {
+            sx = 0;
+            w = 0;
+        }
+        if (sx >= srcSize.width - 1) {
+            sx = srcSize.width - 1;
+            w = 0;
+        }
+        xLeft[dx] = sx;
+        xRight[dx] = min(sx + 1, srcSize.width - 1);
+        xWeights[dx] = static_cast<uint16_t>(cvRound(w * 256));
+    }
+
+    double scaleY = static_cast<double>(srcSize.height) / dstSize.height;
+    yTop.resize(dstSize.height);
+    yWeights.resize(dstSize.height);
+    for (int dy = 0; dy < dstSize.height; dy++) {
+        double fy = (dy + 0.5) * scaleY - 0.5;
+        int sy = cvFloor(fy);
+        double w = fy - sy;
+        if (sy < 0) {
+            sy = 0;
+            w = 0;
+        }
+        if (sy >= srcSize.height - 1) {
+            sy = srcSize.height - 1;
+            w = 0;
+        }
+        yTop[dy] = sy;
+        yWeights[dy] = static_cast<uint16_t>(min(cvRound(w * 65536), 65535));
+    }
+
+    for (int i = 0; i < 2; i++) {
+        rows[i].resize(dstSize.width * 3);
+    }
+
+    srcGeometry = srcSize;
+    dstGeometry = dstSize;
+}
+
+const uint16_t* PreviewScaler::horizontalRow(const Mat& src, Rect srcRect, int sy) {
+    for (int i = 0; i < 2; i++) {
+        if (rowSource[i] == sy) {
+            return rows[i].data();
+        }
+    }
+
+    // Rows are requested top to bottom, so the lower numbered one is no longer needed
+    int slot = (rowSource[0] < rowSource[1]) ? 0 : 1;
+    uint16_t* row = rows[slot].data();
+    const uchar* p = src.ptr<uchar>(srcRect.y + sy) + srcRect.x * 3;
+
+    for (int dx = 0; dx < dstGeometry.width; dx++) {
+        const uchar* left = p + xLeft[dx] * 3;
+        const uchar* right = p + xRight[dx] * 3;
+        int w = xWeights[dx];
+        for (int c = 0; c < 3; c++) {
+            row[dx * 3 + c] = static_cast<uint16_t>(left[c] * (256 - w) + right[c] * w);
+        }
+    }
+
+    rowSource[slot] = sy;
+    return row;
+}
+
+void PreviewScaler::scale(const Mat& src, Rect srcRect, Mat& dst, Rect dstRect,
+                          const vector<PreviewTint>& tints) {
+    CV_Assert(src.type() == CV_8UC3 && dst.type() == CV_8UC3);
+    srcRect &= Rect(0, 0, src.cols, src.rows);
+    if (srcRect.empty() || dstRect.empty()) {
+        return;
+    }
+    CV_Assert((dstRect & Rect(0, 0, dst.cols, dst.rows)) == dstRect);
+
+    prepare(srcRect.size(), dstRect.size());
+
+    // A new source image, forget the cached rows
+    rowSource[0] = rowSource[1] = -1;
+
+    // Tint terms are per element of the dstRect row, so every channel gets its own color
+    int elements = dstRect.width * 3;
+    tintTerms.resize(tints.size());
+    tintFactors.resize(tints.size());
+    for (size_t t = 0; t < tints.size(); t++) {
+        int alpha = cvRound(min(max(tints[t].alpha, 0.0), 1.0) * 256);
+        tintFactors[t] = static_cast<uint16_t>(256 - alpha);
+        tintTerms[t].resize(elements);
+        for (int i = 0; i < elements; i++) {
+            int color = saturate_cast<uchar>(tints[t].color[i % 3]);
+            tintTerms[t][i] = static_cast<uint16_t>(color * alpha + 128);
+        }
+    }
+
+    vector<int> breaks;
+    vector<const uint16_t*> activeTerms;
+    vector<uint16_t> activeFactors;
+
+    for (int dy = 0; dy < dstRect.height; dy++) {
+        int sy = yTop[dy];
+        uint16_t weight = yWeights[dy];
+        const uint16_t* top = horizontalRow(src, srcRect, sy);
+        const uint16_t* bottom = weight ? horizontalRow(src, srcRect, sy + 1) : top;
+        uchar* out = dst.ptr<uchar>(dstRect.y + dy) + dstRect.x * 3;
+
+        // Split the row where a tint starts or ends, each piece has a fixed set of tints
+        int y = dstRect.y + dy;
+        breaks.assign(1, 0);
+        breaks.push_back(elements);
+        for (const PreviewTint& tint : tints) {
+            if (y < tint.area.y || y >= tint.area.y + tint.area.height) {
+                continue;
+            }
+            breaks.push_back(min(max(tint.area.x - dstRect.x, 0), dstRect.width) * 3);
+            breaks.push_back(min(max(tint.area.x + tint.area.width - dstRect.x, 0), dstRect.width) * 3);
+        }
+        sort(breaks.begin(), breaks.end());
+        breaks.erase(unique(breaks.begin(), breaks.end()), breaks.end());
+
+        for (size_t b = 0; b + 1 < breaks.size(); b++) {
+            int begin = breaks[b];
+            int end = breaks[b + 1];
+            int x = dstRect.x + begin / 3;
+
+            activeTerms.clear();
+            activeFactors.clear();
+            for (size_t t = 0; t < tints.size(); t++) {
+                const Rect& area = tints[t].area;
+                if (y >= area.y && y < area.y + area.height && x >= area.x && x < area.x + area.width) {
+                    activeTerms.push_back(tintTerms[t].data());
+                    activeFactors.push_back(tintFactors[t]);
+                }
+            }
+
+            blendRowSegment(top, bottom, weight, activeTerms.data(), activeFactors.data(),
+                            static_cast<int>(activeTerms.size()), begin, end, out);
+        }
+    }
+}
+
+void PreviewScaler::scale(const Mat& src, Mat& dst, Size dstSize, const vector<PreviewTint>& tints) {
+    dst.create(dstSize, CV_8UC3);
+    scale(src, Rect(0, 0, src.cols, src.rows), dst, Rect(Point(0, 0), dstSize), tints);
+}
@@ -0,0 +1,58 @@
+#ifndef PREVIEW_SCALER_H
+#define PREVIEW_SCALER_H
+
+#include "common.h"
+
+// A uniform translucent panel, blended as addWeighted(color, alpha, img, 1 - alpha)
+struct PreviewTint {
+    Rect area;          // Destination coordinates
+    Scalar color;
+    double alpha;       // Weight of the panel color, 0..1
+};
+
+// Bilinear scaler for CV_8UC3 images that blends translucent panels into the
+// output in the same pass, so the preview is written once per frame instead of
+// once for the resize and once per panel. Uses OpenCV universal intrinsics
+// (NEON on the Pi, SSE on x86) with a scalar fallback that gives the same result.
+// Output is within one level of resize(INTER_LINEAR), plus one per tint for the
+// 8 bit alpha, of addWeighted on top (see preview_scaler_test/).
+// Not thread safe, each caller keeps its own instance.
+class PreviewScaler {
+public:
+    PreviewScaler();
+
+    // Scale srcRect of src into dstRect of dst, then apply tints in order.
+    // dst must already be allocated and contain dstRect.
+    void scale(const Mat& src, Rect srcRect, Mat& dst, Rect dstRect,
+               const vector<PreviewTint>& tints = vector<PreviewTint>());
+
+    // Scale the whole of src to dstSize, allocating dst if needed
+    void scale(const Mat& src, Mat& dst, Size dstSize,
+               const vector<PreviewTint>& tints = vector<PreviewTint>());
+
+private:
+    void prepare(Size srcSize, Size dstSize);
+    const uint16_t* horizontalRow(const Mat& src, Rect srcRect, int sy);
+
+    Size srcGeometry;
+    Size dstGeometry;
+
+    // Per output column: left and right source column, weight of the right one (0..256)
+    vector<int> xLeft;
+    vector<int> xRight;
+    vector<uint16_t> xWeights;
+
+    // Per output row: top source row and weight of the next row (0..65535, 16 bit fraction)
+    vector<int> yTop;
+    vector<uint16_t> yWeights;
+
+    // Two horizontally scaled source rows (value * 256), keyed by source row
+    vector<uint16_t> rows[2];
+    int rowSource[2];
+
+    // Per tint: color * alpha + rounding for every output element
+    vector<vector<uint16_t>> tintTerms;
+    vector<uint16_t> tintFactors;
+};
+
+#endif // PREVIEW_SCALER_H
@@ -0,0 +1,160 @@
+#include "proxy_recording.h"
+#include "recording.h"
+#include "thermal_monitor.h"
+#include "text_overlay.h"
+#include "perf_hud.h"
+
+struct ProxyFrame {
+    Mat frame;
+    OverlayLine overlay;
+};
+
+static thread proxyThread;
+static atomic<bool> proxyActive(false);
+static queue<ProxyFrame> proxyQueue;
+static mutex proxyQueueMutex;
+static condition_variable proxyCondition;
+static VideoWriter proxyWriter;
+static atomic<int> proxyDropped(0);
+static atomic<int> proxyWritten(0);
+
+// Read once per recording, frames are submitted from the capture thread
+static Size proxyOutputSize(320, 180);
+static int proxyJpegQuality = 40;
+static size_t proxyQueueMax = 8;
+
+static void proxyWorker(Size proxySize) {
+    Mat proxyFrame;
+    TextOverlay proxyOverlay(FONT_HERSHEY_PLAIN, 0.8, 1);
+    setCurrentThreadName("proxy");
+
+    while (true) {
+        ProxyFrame item;
+        {
+            unique_lock<mutex> lock(proxyQueueMutex);
+            proxyCondition.wait(lock, [] { return !proxyQueue.empty() || !proxyActive; });
+
+            // Drain whatever is queued before exiting
+            if (proxyQueue.empty()) {
+                break;
+            }
+            item = proxyQueue.front();
+            proxyQueue.pop();
+        }
+
+        // Downscale off the capture thread
+        resize(item.frame, proxyFrame, proxySize, 0, 0, INTER_AREA);
+
+        // Re-draw the timestamp so it stays readable at proxy size
+        rectangle(proxyFrame, Rect(0, 0, proxySize.width, 16), Scalar(0, 0, 0), -1);
+        proxyOverlay.draw(proxyFrame, item.overlay, Point(4, 12), TEXT_COLOR);
+
+        try {
+            proxyWriter.write(proxyFrame);
+            proxyWritten++;
+        } catch (const cv::Exception& e) {
+            cerr << "ERROR: Exception while writing proxy: " << e.what() << endl;
+        }
+    }
+}
+
+void loadProxySettings() {
+    proxyOutputSize = Size(appConfig.getInt("PROXY_WIDTH", 320), appConfig.getInt("PROXY_HEIGHT", 180));
+    proxyJpegQuality = appConfig.getInt("PROXY_JPEG_QUALITY", 40);
+    proxyQueueMax = static_cast<size_t>(max(1, appConfig.getInt("PROXY_QUEUE_SIZE", 8)));
+}
+
+bool startProxyRecording(const string& proxyFilename, double fps) {
+    if (proxyActive) {
+        stopProxyRecording();
+    }
+
+    openMjpegWriter(proxyWriter, proxyFilename, fps, proxyOutputSize);
+    if (!proxyWriter.isOpened()) {
+        cerr << "ERROR: Could not open the proxy file for write: " << proxyFilename << endl;
+        return false;
+    }
+
+    // Low quality keeps proxies small enough to triage over a laptop's USB port
+    proxyWriter.set(VIDEOWRITER_PROP_QUALITY, proxyJpegQuality);
+
+    proxyDropped = 0;
+    proxyWritten = 0;
+    proxyActive = true;
+    proxyThread = thread(proxyWorker, proxyOutputSize);
+
+    cout << "Started proxy recording to " << proxyFilename << " ("
+         << proxyOutputSize.width << "x" << proxyOutputSize.height << ")" << endl;
+    return true;
+}
+
+bool proxyRecordingActive() {
+    return proxyActive;
+}
+
+void submitProxyFrame(const Mat& frame, const OverlayLine& overlay) {
+    if (!proxyActive) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(proxyQueueMutex);
+
+        // The proxy is optional, never let it hold up the capture loop or
+        // add heat while the SoC is close to throttling
+        if (proxyQueue.size() >= proxyQueueMax || thermalShedOptionalWork()) {
+            proxyDropped++;
+            return;
+        }
+        proxyQueue.push({frame, overlay});
+    }
+    proxyCondition.notify_one();
+}
+
+bool stopProxyRecording() {
+    if (!proxyActive) {
+        return false;
+    }
+
+    {
+        lock_guard<mutex> lock(proxyQueueMutex);
+        proxyActive = false;
+    }
+    proxyCondition.notify_all();
+
+    if (proxyThread.joinable()) {
+        proxyThread.join();
+    }
+
+    proxyWriter.release();
+
+    if (proxyDropped > 0) {
+        cout << "Proxy dropped " << proxyDropped << " frames" << endl;
+    }
+    return proxyWritten > 0;
+}
+
+int proxyDroppedFrames() {
+    return proxyDropped;
+}
+
+string proxyFilenameFor(const string& recordingFilename) {
+    size_t dotPos = recordingFilename.rfind('.');
+    size_t slashPos = recordingFilename.rfind('/');
+    if (dotPos == string::npos || (slashPos != string::npos && dotPos < slashPos)) {
+        dotPos = recordingFilename.length();
+    }
+    string stem = recordingFilename.substr(0, dotPos);
+
+    // A recording with ROIs has one proxy for all of its streams, named after the session
+    size_t roiPos = stem.rfind("_roi");
+    if (roiPos != string::npos && roiPos + 4 < stem.length() &&
+        all_of(stem.begin() + roiPos + 4, stem.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); })) {
+        stem.erase(roiPos);
+    }
+    return stem + "_proxy" + recordingFilename.substr(dotPos);
+}
+
+bool isProxyFilename(const string& filename) {
+    return filename.find("_proxy.") != string::npos;
+}
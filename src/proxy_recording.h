@@ -0,0 +1,30 @@
+#ifndef PROXY_RECORDING_H
+#define PROXY_RECORDING_H
+
+#include "common.h"
+
+// Read the PROXY_* settings, done by startRecording before the streams open
+void loadProxySettings();
+
+// Start the background proxy writer for the current recording
+bool startProxyRecording(const string& proxyFilename, double fps);
+
+// True while the proxy worker is running
+bool proxyRecordingActive();
+
+// Hand a captured frame to the proxy worker (never blocks, drops when busy)
+void submitProxyFrame(const Mat& frame, const OverlayLine& overlay);
+
+// Stop the proxy worker and close its file, returns true if a file was written
+bool stopProxyRecording();
+
+// Number of frames the proxy worker had to drop in the current recording
+int proxyDroppedFrames();
+
+// Map a recording filename to its session's proxy ("x.avi" and "x_roi2.avi" -> "x_proxy.avi")
+string proxyFilenameFor(const string& recordingFilename);
+
+// True for proxy companion files
+bool isProxyFilename(const string& filename);
+
+#endif // PROXY_RECORDING_H
@@ -1,24 +1,616 @@
 #include "recording.h"
+#include "roi_recording.h"
+#include "proxy_recording.h"
+#include "recording_governor.h"
+#include "metrics.h"
+#include "frame_store.h"
+#include "frame_metadata.h"
+#include "clip_export.h"
+#include "text_overlay.h"
+#include "ui.h"
+#include "perf_hud.h"
 #include <cstdio>
 #include <fstream>
 #include <filesystem>
 
-// In recording.cpp, modify the postProcessVideo function:
+// Per-ROI writers, opened alongside (instead of) the full-frame videoWriter
+static vector<VideoWriter> roiWriters;
+static vector<string> roiTempFilenames;
+static vector<Rect> activeRois;
+static string proxyTempFilename;
+static string metadataTempFilename;
+static atomic<bool> streamsOpen(false);
 
-void postProcessVideo(const string& inputFilename, double recordingDurationSeconds) {
+// Streams are opened and fed by the capture thread and closed by the UI thread
+static mutex streamMutex;
+
+// Native frame store streams (RECORDING_FORMAT=store), one per full frame or ROI
+static bool useFrameStore = false;
+static vector<string> storeBasePaths;
+static vector<unique_ptr<FrameStoreWriter>> frameStores;
+static int storeJpegQuality = 95;
+
+// Per-frame metadata sidecar, written by the writer thread
+static FrameMetadataWriter frameMetadata;
+static int appliedJpegQuality = 95;
+
+// Writer thread state
+// Read in startRecording, the capture thread opens the streams and queues
+// frames without going back to the config
+static double recordingFps = 30.0;
+static size_t maxQueuedFrames = 30;
+static bool proxyRequested = false;
+
+static atomic<bool> writeFailed(false);
+static atomic<int> droppedFrames(0);
+static uint64_t capturedFrames = 0;
+
+static void recordingWriterLoop();
+static vector<string> closeStreamsLocked();
+
+static string replaceExtension(const string& path, const string& extension) {
+    size_t dotPos = path.rfind('.');
+    if (dotPos == string::npos) {
+        return path + extension;
+    }
+    return path.substr(0, dotPos) + extension;
+}
+
+void startRecording() {
+    time_t now = time(0);
+    char buffer[80];
+    strftime(buffer, 80, "%Y%m%d_%H%M%S", localtime(&now));
+    tempFilename = "/tmp/" + string(buffer) + "_temp.avi";
+
+    // ROIs are fixed for the duration of a recording
+    roiEditMode = false;
+    activeRois = roiRecordingActive() ? recordingRois : vector<Rect>();
+    roiTempFilenames.clear();
+    for (size_t i = 0; i < activeRois.size(); i++) {
+        roiTempFilenames.push_back("/tmp/" + string(buffer) + "_roi" + to_string(i + 1) + "_temp.avi");
+    }
+
+    proxyTempFilename = "/tmp/" + string(buffer) + "_proxy_temp.avi";
+
+    // The frame store keeps real capture timestamps, so it is written straight
+    // to ./recordings/ and needs no FPS post-processing
+    useFrameStore = appConfig.getString("RECORDING_FORMAT", "avi") == "store";
+    recordingFps = appConfig.getDouble("RECORDING_FPS", 30.0); // Target FPS for raw recording
+    maxQueuedFrames = static_cast<size_t>(max(1, appConfig.getInt("RECORDING_QUEUE_MAX", 30)));
+    proxyRequested = appConfig.getBool("PROXY_RECORDING", false);
+    if (proxyRequested) {
+        loadProxySettings();
+    }
+    loadGovernorSettings();
+    storeBasePaths.clear();
+    if (useFrameStore) {
+        if (activeRois.empty()) {
+            storeBasePaths.push_back(replaceExtension(recordingOutputFilename(tempFilename), ""));
+        }
+        for (const string& roiTempFilename : roiTempFilenames) {
+            storeBasePaths.push_back(replaceExtension(recordingOutputFilename(roiTempFilename), ""));
+        }
+    }
+
+    // Recording metadata is named after the first stream that will be written
+    if (useFrameStore) {
+        metadataTempFilename = storeBasePaths[0] + ".meta";
+    } else {
+        metadataTempFilename = replaceExtension(activeRois.empty() ? tempFilename : roiTempFilenames[0], ".meta");
+    }
+
+    recordingStartTime = system_clock::now();
+    isRecording = true;
+    setLogMessage("Rec started...");
+    progressValue = 0;
+}
+
+void stopRecording() {
+    isRecording = false;
+
+    vector<string> writtenFiles;
+    {
+        // Checked under the lock so a capture thread that is opening the
+        // streams right now is either finished or sees isRecording == false
+        lock_guard<mutex> lock(streamMutex);
+        if (!streamsOpen) {
+            return;
+        }
+
+        recordingDurationSeconds = duration<double>(system_clock::now() - recordingStartTime).count();
+        writtenFiles = closeStreamsLocked();
+    }
+    setLogMessage("Rec stopped");
+
+    // Frame store recordings are already final
+    if (writtenFiles.empty()) {
+        progressValue = 100;
+        setLogMessage("Saved to file");
+        return;
+    }
+
+    // Cancel any ongoing processing
+    if (isProcessing && processingThread.joinable()) {
+        isProcessing = false;
+        processingThread.join();
+    }
+
+    // Start processing in a new thread using the temp files
+    isProcessing = true;
+    if (processingThread.joinable()) {
+        processingThread.join();
+    }
+    processingThread = thread(postProcessVideo, writtenFiles, recordingDurationSeconds);
+}
+
+void openMjpegWriter(VideoWriter& writer, const string& path, double fps, Size size) {
+    int codec = VideoWriter::fourcc('M', 'J', 'P', 'G');
+
+    // The built-in MJPEG encoder supports changing the JPEG quality mid-stream
+    if (!writer.open(path, CAP_OPENCV_MJPEG, codec, fps, size, true)) {
+        writer.open(path, codec, fps, size, true);
+    }
+}
+
+bool openRecordingStreams(Size size) {
+    lock_guard<mutex> lock(streamMutex);
+    if (!isRecording || streamsOpen) {
+        return streamsOpen;
+    }
+
+    // Check if we have valid frame dimensions
+    if (size.width <= 0 || size.height <= 0) {
+        cerr << "ERROR: Invalid frame dimensions: " << size.width << "x" << size.height << endl;
+        return false;
+    }
+
+    double fps = recordingFps;
+
+    if (useFrameStore) {
+        filesystem::create_directories("./recordings/");
+        frameStores.clear();
+
+        for (size_t i = 0; i < storeBasePaths.size(); i++) {
+            Size streamSize = activeRois.empty() ? size : (activeRois[i] & Rect(0, 0, size.width, size.height)).size();
+            frameStores.push_back(unique_ptr<FrameStoreWriter>(new FrameStoreWriter()));
+            if (streamSize.width <= 0 || streamSize.height <= 0 ||
+                !frameStores[i]->open(storeBasePaths[i], streamSize)) {
+                cerr << "ERROR: Could not open frame store for write: " << storeBasePaths[i] << endl;
+                closeStreamsLocked();
+                return false;
+            }
+            cout << "Started recording to " << storeBasePaths[i] << FRAME_STORE_DATA_EXT << endl;
+        }
+
+        if (!activeRois.empty()) {
+            for (Rect& roi : activeRois) {
+                roi &= Rect(0, 0, size.width, size.height);
+            }
+        }
+    } else if (activeRois.empty()) {
+        // Use temp filename for direct recording to file
+        openMjpegWriter(videoWriter, tempFilename, fps, size);
+        if (!videoWriter.isOpened()) {
+            cerr << "ERROR: Could not open the output video file for write" << endl;
+            return false;
+        }
+        cout << "Started recording to " << tempFilename << endl;
+    } else {
+        Rect frameBounds(0, 0, size.width, size.height);
+        roiWriters.assign(activeRois.size(), VideoWriter());
+
+        for (size_t i = 0; i < activeRois.size(); i++) {
+            activeRois[i] &= frameBounds;
+            if (activeRois[i].width <= 0 || activeRois[i].height <= 0) {
+                cerr << "ERROR: ROI " << i + 1 << " is outside the frame" << endl;
+                closeStreamsLocked();
+                return false;
+            }
+
+            // Each ROI is its own stream at native sensor resolution
+            openMjpegWriter(roiWriters[i], roiTempFilenames[i], fps, activeRois[i].size());
+            if (!roiWriters[i].isOpened()) {
+                cerr << "ERROR: Could not open ROI output file for write: " << roiTempFilenames[i] << endl;
+                closeStreamsLocked();
+                return false;
+            }
+            cout << "Started ROI recording to " << roiTempFilenames[i] << " ("
+                 << activeRois[i].width << "x" << activeRois[i].height << ")" << endl;
+        }
+    }
+
+    // Low-resolution proxy for quick review, a failure here doesn't stop the recording
+    if (proxyRequested) {
+        startProxyRecording(proxyTempFilename, fps);
+    }
+
+    // Per-frame metadata sits next to the recording metadata
+    string frameMetadataFilename = replaceExtension(metadataTempFilename, FRAME_METADATA_EXT);
+    if (!frameMetadata.open(frameMetadataFilename)) {
+        cerr << "WARNING: Could not open frame metadata file: " << frameMetadataFilename << endl;
+    }
+
+    // Encoding happens on the writer thread, watched by the quality governor
+    resetRecordingGovernor(metadataTempFilename);
+    writeFailed = false;
+    droppedFrames = 0;
+    capturedFrames = 0;
+    recordingThreadActive = true;
+    recordingThread = thread(recordingWriterLoop);
+
+    streamsOpen = true;
+    return true;
+}
+
+bool recordingStreamsOpen() {
+    return streamsOpen;
+}
+
+static void setWriterQuality(int quality) {
+    storeJpegQuality = quality;
+    if (videoWriter.isOpened()) {
+        videoWriter.set(VIDEOWRITER_PROP_QUALITY, quality);
+    }
+    for (VideoWriter& writer : roiWriters) {
+        writer.set(VIDEOWRITER_PROP_QUALITY, quality);
+    }
+}
+
+// Write one image to a stream, either through its VideoWriter or its frame store
+static void writeStreamFrame(VideoWriter& writer, size_t stream, const Mat& image, const RecordingFrame& item) {
+    if (!useFrameStore) {
+        writer.write(image);
+        return;
+    }
+
+    vector<uchar> jpeg;
+    imencode(".jpg", image, jpeg, {IMWRITE_JPEG_QUALITY, storeJpegQuality});
+    int64_t timestampUs = duration_cast<microseconds>(item.captureTime.time_since_epoch()).count();
+    if (!frameStores[stream]->append(jpeg.data(), jpeg.size(), timestampUs)) {
+        cerr << "ERROR: Could not append to frame store " << storeBasePaths[stream] << endl;
+        writeFailed = true;
+    }
+}
+
+static void writeRecordingFrame(RecordingFrame& item) {
+    if (activeRois.empty()) {
+        // The queued copy belongs to the writer, so the overlay goes straight on it
+        static TextOverlay frameOverlay(FONT_HERSHEY_SIMPLEX, 0.7, 2);
+        frameOverlay.draw(item.image, item.overlay, Point(10, 30), TEXT_COLOR);
+        writeStreamFrame(videoWriter, 0, item.image, item);
+
+        // The overlay copy is never modified again, so the proxy worker can share it
+        submitProxyFrame(item.image, item.overlay);
+        return;
+    }
+
+    // Only the crops are encoded, so cost scales with ROI area
+    static TextOverlay cropOverlay(FONT_HERSHEY_SIMPLEX, 0.5, 1);
+    for (size_t i = 0; i < activeRois.size(); i++) {
+        Mat crop = item.crops.empty() ? item.image(activeRois[i]).clone() : item.crops[i];
+        cropOverlay.draw(crop, item.overlay, Point(5, min(crop.rows - 5, 20)), TEXT_COLOR);
+        writeStreamFrame(useFrameStore ? videoWriter : roiWriters[i], i, crop, item);
+    }
+
+    if (!item.image.empty()) {
+        submitProxyFrame(item.image, item.overlay);
+    }
+}
+
+static void appendFrameMetadata(const RecordingFrame& item, double writeLatencyMs) {
+    if (!frameMetadata.isOpened()) {
+        return;
+    }
+
+    FrameMetadataRecord record = {};
+    record.captureTimeUs = duration_cast<microseconds>(item.captureTime.time_since_epoch()).count();
+    record.sequence = item.sequence;
+    record.zoomLevel = item.zoomLevel;
+    record.flags = item.metadataFlags;
+    record.jpegQuality = static_cast<uint16_t>(appliedJpegQuality);
+    record.encodeLatencyUs = static_cast<uint32_t>(writeLatencyMs * 1000.0);
+    record.measuredFpsMilli = static_cast<uint32_t>(max(0.0, item.measuredFps) * 1000.0);
+    record.detectorCount = item.detectorCount;
+    record.detectorScore = item.detectorScore;
+    frameMetadata.append(record);
+}
+
+static void recordingWriterLoop() {
+    int appliedQuality = -1;
+    setCurrentThreadName("rec-writer");
+
+    while (true) {
+        RecordingFrame item;
+        size_t queueDepth = 0;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            frameCondition.wait(lock, [] { return !frameQueue.empty() || !recordingThreadActive; });
+
+            // Drain whatever is queued before exiting
+            if (frameQueue.empty()) {
+                break;
+            }
+            item = std::move(frameQueue.front());
+            frameQueue.pop();
+            queueDepth = frameQueue.size();
+        }
+
+        if (writeFailed) {
+            continue;
+        }
+
+        int quality = governorJpegQuality();
+        if (quality != appliedQuality) {
+            setWriterQuality(quality);
+            appliedQuality = quality;
+            appliedJpegQuality = quality;
+        }
+
+        auto writeStart = steady_clock::now();
+        try {
+            writeRecordingFrame(item);
+        } catch (const cv::Exception& e) {
+            cerr << "ERROR: Exception while writing video: " << e.what() << endl;
+            writeFailed = true;
+            continue;
+        }
+        double writeLatencyMs = duration<double, milli>(steady_clock::now() - writeStart).count();
+
+        appendFrameMetadata(item, writeLatencyMs);
+        governorObserve(queueDepth, writeLatencyMs);
+        recordStageTime(STAGE_WRITE, writeLatencyMs);
+        recordQueueDepth(queueDepth);
+    }
+}
+
+void enqueueRecordingFrame(const Mat& frame, const OverlayLine& overlay,
+                           system_clock::time_point captureTime, double measuredFps) {
+    // The streams may have been closed since the caller checked
+    lock_guard<mutex> streamLock(streamMutex);
+    if (!streamsOpen || writeFailed) {
+        return;
+    }
+
+    uint64_t sequence = capturedFrames++;
+
+    // The governor may ask to record only every Nth frame
+    if (sequence % governorFrameInterval() != 0) {
+        return;
+    }
+
+    RecordingFrame item;
+    item.overlay = overlay;
+    item.captureTime = captureTime;
+    item.sequence = sequence;
+    item.zoomLevel = zoomLevel;
+    item.measuredFps = measuredFps;
+    item.metadataFlags = (icrModeEnabled ? META_FLAG_ICR : 0) |
+                         (stabilizerEnabled ? META_FLAG_STABILIZER : 0) |
+                         (activeRois.empty() ? 0 : META_FLAG_ROI);
+
+    // The capture buffer is reused by the next read, so the writer needs its own copy
+    if (activeRois.empty() || proxyRecordingActive()) {
+        item.image = frame.clone();
+    } else {
+        for (const Rect& roi : activeRois) {
+            item.crops.push_back(frame(roi).clone());
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (frameQueue.size() >= maxQueuedFrames) {
+            droppedFrames++;
+            incrementMetric("recording_dropped_frames");
+            return;
+        }
+        frameQueue.push(std::move(item));
+    }
+    frameCondition.notify_one();
+}
+
+bool recordingWriteFailed() {
+    return writeFailed;
+}
+
+vector<string> closeRecordingStreams() {
+    lock_guard<mutex> lock(streamMutex);
+    return closeStreamsLocked();
+}
+
+static vector<string> closeStreamsLocked() {
+    vector<string> writtenFiles;
+
+    // Let the writer thread finish the queued frames before releasing the writers
+    {
+        lock_guard<mutex> lock(queueMutex);
+        recordingThreadActive = false;
+    }
+    frameCondition.notify_all();
+    if (recordingThread.joinable()) {
+        recordingThread.join();
+    }
+
+    if (droppedFrames > 0) {
+        cout << "Recording dropped " << droppedFrames << " frames" << endl;
+    }
+    logRecordingMetadata("dropped_frames=" + to_string(droppedFrames.load()));
+    closeRecordingGovernor();
+    frameMetadata.close();
+
+    if (videoWriter.isOpened()) {
+        videoWriter.release();
+        writtenFiles.push_back(tempFilename);
+    }
+
+    for (size_t i = 0; i < roiWriters.size(); i++) {
+        if (roiWriters[i].isOpened()) {
+            roiWriters[i].release();
+            writtenFiles.push_back(roiTempFilenames[i]);
+        }
+    }
+    roiWriters.clear();
+
+    // Frame stores are written in place and are not post-processed
+    for (auto& store : frameStores) {
+        store->close();
+    }
+    frameStores.clear();
+
+    if (stopProxyRecording()) {
+        writtenFiles.push_back(proxyTempFilename);
+    }
+
+    streamsOpen = false;
+    return writtenFiles;
+}
+
+string recordingOutputFilename(const string& tempFile) {
+    // "/tmp/YYYYMMDD_HHMMSS<suffix>_temp.avi" -> "./recordings/YYYYMMDD_HHMMS<suffix>.avi"
+    string suffix;
+    size_t tempPos = tempFile.rfind("_temp");
+    if (tempPos != string::npos && tempPos > 20) {
+        suffix = tempFile.substr(20, tempPos - 20);
+    }
+    return "./recordings/" + tempFile.substr(5, 14) + suffix + ".avi";
+}
+
+static void moveFile(const string& from, const string& to) {
+    // /tmp is usually a different filesystem, so fall back to copy and delete
+    error_code ec;
+    filesystem::rename(from, to, ec);
+    if (ec) {
+        filesystem::copy_file(from, to, filesystem::copy_options::overwrite_existing, ec);
+        if (!ec) {
+            remove(from.c_str());
+        }
+    }
+}
+
+// Move the recording metadata next to the final file and drop the temp file
+static void finishPostProcessedFile(const string& inputFilename, const string& outputFilename) {
+    progressValue = 100;
+    setLogMessage("Saved to file");
+
+    for (const string& extension : {string(".meta"), string(FRAME_METADATA_EXT)}) {
+        string metadataFile = replaceExtension(inputFilename, extension);
+        if (access(metadataFile.c_str(), F_OK) == 0) {
+            moveFile(metadataFile, replaceExtension(outputFilename, extension));
+        }
+    }
+    remove(inputFilename.c_str());
+}
+
+// True if frames were left out of the recording: the governor recording only
+// every Nth frame or a full writer queue leave gaps in the capture sequence
+static bool hasCaptureGaps(const vector<FrameMetadataRecord>& records) {
+    for (size_t i = 1; i < records.size(); i++) {
+        if (records[i].sequence != records[i - 1].sequence + 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Rebuild an AVI with gaps in real time: at the capture rate, every frame
+// repeated until the next recorded one was captured. A single average rate
+// would play the thinned out sections fast. Frames are copied without
+// re-encoding, the per-frame metadata gets one record per written frame again.
+static bool retimeRecording(const string& inputFilename, const string& outputFilename,
+                            const vector<FrameMetadataRecord>& records) {
+    RecordingSource source;
+    if (!source.open(inputFilename) || source.frameCount() != records.size()) {
+        cerr << "Frame metadata doesn't match " << inputFilename << ", keeping the average rate" << endl;
+        return false;
+    }
+
+    const FrameMetadataRecord& first = records.front();
+    const FrameMetadataRecord& last = records.back();
+    double spanSeconds = (last.captureTimeUs - first.captureTimeUs) / 1e6;
+    double captureRate = spanSeconds > 0 ? (last.sequence - first.sequence) / spanSeconds
+                                         : appConfig.getDouble("RECORDING_FPS", 30.0);
+
+    AviMjpegWriter writer;
+    if (!writer.open(outputFilename, source.frameSize().width, source.frameSize().height, captureRate)) {
+        cerr << "ERROR: Could not create AVI: " << outputFilename << endl;
+        return false;
+    }
+
+    // Only the stream the sidecar belongs to gets the matching one
+    string metadataFile = replaceExtension(inputFilename, FRAME_METADATA_EXT);
+    bool ownsMetadata = access(metadataFile.c_str(), F_OK) == 0;
+    FrameMetadataWriter metadata;
+    if (ownsMetadata && !metadata.open(replaceExtension(outputFilename, FRAME_METADATA_EXT))) {
+        ownsMetadata = false;
+    }
+
+    // Nothing half written is left behind, the input is remuxed instead
+    auto discard = [&]() {
+        writer.close();
+        metadata.close();
+        remove(outputFilename.c_str());
+        if (ownsMetadata) {
+            remove(replaceExtension(outputFilename, FRAME_METADATA_EXT).c_str());
+        }
+        return false;
+    };
+
+    setLogMessage("Processing...");
+    progressValue = 0;
+    vector<uint8_t> frameData;
+    for (size_t i = 0; i < records.size(); i++) {
+        uint64_t repeats = 1;
+        if (i + 1 < records.size() && records[i + 1].sequence > records[i].sequence) {
+            repeats = records[i + 1].sequence - records[i].sequence;
+        }
+        if (!isProcessing || !source.readFrame(i, frameData)) {
+            return discard();
+        }
+        for (uint64_t r = 0; r < repeats; r++) {
+            if (!writer.writeFrame(frameData.data(), frameData.size())) {
+                cerr << "ERROR: Failed to write " << outputFilename << endl;
+                return discard();
+            }
+            if (ownsMetadata) {
+                metadata.append(records[i]);
+            }
+        }
+        progressValue = static_cast<int>((i + 1) * 99 / records.size());
+    }
+
+    if (!writer.close()) {
+        return discard();
+    }
+    cout << "Retimed " << outputFilename << " to " << writer.frameCount() << " frames at " << captureRate << " fps" << endl;
+
+    // Replaced by the retimed sidecar
+    if (ownsMetadata) {
+        metadata.close();
+        remove(metadataFile.c_str());
+    }
+    return true;
+}
+
+static bool postProcessFile(const string& inputFilename, double recordingDurationSeconds,
+                            const vector<FrameMetadataRecord>& records) {
     // Check if input file exists
     if (access(inputFilename.c_str(), F_OK) != 0) {
         cerr << "ERROR: Input file does not exist: " << inputFilename << endl;
         setLogMessage("Error: File not found");
-        isProcessing = false;
-        return;
+        return false;
     }
 
     // Generate output filename
-    string outputFilename = "./recordings/" + inputFilename.substr(5, 14) + ".avi";
+    string outputFilename = recordingOutputFilename(inputFilename);
     
     // Create directory if it doesn't exist
     filesystem::create_directories("./recordings/");
+
+    // Files with left out frames follow the capture times, the rest is only remuxed
+    if (hasCaptureGaps(records) && retimeRecording(inputFilename, outputFilename, records)) {
+        finishPostProcessedFile(inputFilename, outputFilename);
+        return true;
+    }
     
     // Get frame count using FFmpeg
     string frameCountCmd = "ffprobe -v error -count_frames -select_streams v:0 "
@@ -29,8 +621,7 @@ void postProcessVideo(const string& inputFilename, double recordingDurationSecon
     if (!fpipeCount) {
         cerr << "Error running FFprobe for frame count" << endl;
         setLogMessage("Error analyzing video");
-        isProcessing = false;
-        return;
+        return false;
     }
     
     char buffer[128];
@@ -80,8 +671,7 @@ void postProcessVideo(const string& inputFilename, double recordingDurationSecon
     if (!pipe) {
         cerr << "Error starting FFmpeg process" << endl;
         setLogMessage("Error starting process");
-        isProcessing = false;
-        return;
+        return false;
     }
     
     // Monitor progress while FFmpeg is running
@@ -133,22 +723,39 @@ void postProcessVideo(const string& inputFilename, double recordingDurationSecon
     }
     
     // Only check status after process completes
+    bool succeeded = false;
     if (processCompleted) {
         // Get the exit status
         int status = system(("ffprobe -v error \"" + outputFilename + "\" > /dev/null 2>&1").c_str());
         
         if (status == 0) {
-            // Success
-            progressValue = 100;
-            setLogMessage("Saved to file");
-            
-            // Remove the temporary files
-            remove(inputFilename.c_str());
+            // Success, keep the recording metadata next to the final file
+            finishPostProcessedFile(inputFilename, outputFilename);
             remove(progressFile.c_str());
+            succeeded = true;
         } else {
             setLogMessage("Error processing video");
         }
     }
-    
+
+    return succeeded;
+}
+
+void postProcessVideo(const vector<string>& inputFilenames, double recordingDurationSeconds) {
+    // The streams share the per-frame metadata of the first one, read before
+    // processing moves it. A stream with another frame count (a proxy that
+    // dropped frames) is remuxed at its average rate.
+    vector<FrameMetadataRecord> records;
+    if (!inputFilenames.empty()) {
+        readFrameMetadataFile(replaceExtension(inputFilenames[0], FRAME_METADATA_EXT), records);
+    }
+
+    // Full-frame and ROI streams share the same duration, process them one by one
+    for (const string& inputFilename : inputFilenames) {
+        if (!isProcessing || !postProcessFile(inputFilename, recordingDurationSeconds, records)) {
+            break;
+        }
+    }
+
     isProcessing = false;
 }
\ No newline at end of file
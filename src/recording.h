@@ -3,7 +3,35 @@
 
 #include "common.h"
 
-// Function to post-process video to match actual FPS
-void postProcessVideo(const string& inputFilename, double actualFPS);
+// Start a new recording (temp filenames and start time)
+void startRecording();
+
+// Stop recording, close all streams and post-process them in the background
+void stopRecording();
+
+// Open an MJPEG writer, preferring OpenCV's built-in encoder
+void openMjpegWriter(VideoWriter& writer, const string& path, double fps, Size size);
+
+// Open the full-frame writer, or one writer per ROI when ROI recording is active
+bool openRecordingStreams(Size size);
+
+// True once the writers for the current recording are open
+bool recordingStreamsOpen();
+
+// Queue one captured frame for the writer thread (copies what the streams need)
+void enqueueRecordingFrame(const Mat& frame, const OverlayLine& overlay,
+                           system_clock::time_point captureTime, double measuredFps);
+
+// True if the writer thread hit an error and the recording should be stopped
+bool recordingWriteFailed();
+
+// Drain the writer thread, release all writers and return the temp files that were written
+vector<string> closeRecordingStreams();
+
+// Map a temp recording file to its final name in ./recordings/
+string recordingOutputFilename(const string& tempFile);
+
+// Function to post-process videos to match actual FPS
+void postProcessVideo(const vector<string>& inputFilenames, double recordingDurationSeconds);
 
 #endif // RECORDING_H
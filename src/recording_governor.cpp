@@ -0,0 +1,226 @@
+#include "recording_governor.h"
+#include "metrics.h"
+
+// Governor level 0 is full quality. Each step down first lowers the JPEG
+// quality, and once the quality floor is reached it starts skipping frames.
+static atomic<int> governorLevel(0);
+static atomic<int> currentQuality(95);
+static atomic<int> currentFrameInterval(1);
+
+static ofstream metadataLog;
+static mutex metadataMutex;
+static steady_clock::time_point governorStart;
+static steady_clock::time_point windowStart;
+
+// Statistics for the current evaluation window
+static size_t windowMaxQueueDepth = 0;
+static double windowLatencySum = 0.0;
+static int windowFrames = 0;
+static int calmWindows = 0;
+
+struct GovernorSettings {
+    bool enabled;
+    int qualityMax;
+    int qualityMin;
+    int qualityStep;
+    int maxFrameInterval;
+    int queueHigh;
+    int queueLow;
+    double latencyHighMs;
+    double latencyLowMs;
+    double cpuIdleLow;
+    double cpuIdleHigh;
+    int evalMs;
+    int recoverSeconds;
+};
+
+static GovernorSettings settings;
+
+void loadGovernorSettings() {
+    settings.enabled = appConfig.getBool("GOVERNOR_ENABLED", true);
+    // Headless units spend the CPU the preview would have used on quality
+    settings.qualityMax = headlessMode ? appConfig.getInt("HEADLESS_QUALITY_MAX", 98)
+                                       : appConfig.getInt("GOVERNOR_QUALITY_MAX", 95);
+    settings.qualityMin = min(settings.qualityMax, appConfig.getInt("GOVERNOR_QUALITY_MIN", 60));
+    settings.qualityStep = max(1, appConfig.getInt("GOVERNOR_QUALITY_STEP", 10));
+    settings.maxFrameInterval = max(1, appConfig.getInt("GOVERNOR_MAX_FRAME_INTERVAL", 3));
+    settings.queueHigh = appConfig.getInt("GOVERNOR_QUEUE_HIGH", 8);
+    settings.queueLow = appConfig.getInt("GOVERNOR_QUEUE_LOW", 2);
+    settings.latencyHighMs = appConfig.getDouble("GOVERNOR_LATENCY_HIGH_MS", 30.0);
+    settings.latencyLowMs = appConfig.getDouble("GOVERNOR_LATENCY_LOW_MS", 15.0);
+    settings.cpuIdleLow = appConfig.getDouble("GOVERNOR_CPU_IDLE_LOW", 10.0);
+    settings.cpuIdleHigh = appConfig.getDouble("GOVERNOR_CPU_IDLE_HIGH", 30.0);
+    settings.evalMs = max(100, appConfig.getInt("GOVERNOR_EVAL_MS", 1000));
+    settings.recoverSeconds = max(1, appConfig.getInt("GOVERNOR_RECOVER_SECONDS", 5));
+}
+
+static int qualitySteps() {
+    return (settings.qualityMax - settings.qualityMin + settings.qualityStep - 1) / settings.qualityStep;
+}
+
+static int maxGovernorLevel() {
+    return qualitySteps() + settings.maxFrameInterval - 1;
+}
+
+static void applyLevel(int level) {
+    int steps = qualitySteps();
+    currentQuality = max(settings.qualityMin, settings.qualityMax - settings.qualityStep * min(level, steps));
+    currentFrameInterval = 1 + max(0, level - steps);
+
+    setMetric("recording_governor_level", level);
+    setMetric("recording_jpeg_quality", currentQuality);
+    setMetric("recording_frame_interval", currentFrameInterval);
+}
+
+double readCpuIdlePercent() {
+    static unsigned long long lastIdle = 0;
+    static unsigned long long lastTotal = 0;
+    static mutex cpuMutex;
+
+    ifstream statFile("/proc/stat");
+    string label;
+    unsigned long long user = 0, nice = 0, system = 0, idle = 0, iowait = 0, irq = 0, softirq = 0, steal = 0;
+    if (!(statFile >> label >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal) || label != "cpu") {
+        return 100.0;
+    }
+
+    unsigned long long idleAll = idle + iowait;
+    unsigned long long total = user + nice + system + idleAll + irq + softirq + steal;
+
+    lock_guard<mutex> lock(cpuMutex);
+    unsigned long long deltaTotal = total - lastTotal;
+    unsigned long long deltaIdle = idleAll - lastIdle;
+    lastTotal = total;
+    lastIdle = idleAll;
+
+    if (deltaTotal == 0) {
+        return 100.0;
+    }
+    return 100.0 * static_cast<double>(deltaIdle) / static_cast<double>(deltaTotal);
+}
+
+void resetRecordingGovernor(const string& metadataPath) {
+    governorLevel = 0;
+    applyLevel(0);
+    windowMaxQueueDepth = 0;
+    windowLatencySum = 0.0;
+    windowFrames = 0;
+    calmWindows = 0;
+    governorStart = steady_clock::now();
+    windowStart = governorStart;
+    readCpuIdlePercent();
+
+    lock_guard<mutex> lock(metadataMutex);
+    if (metadataLog.is_open()) {
+        metadataLog.close();
+    }
+    metadataLog.open(metadataPath);
+    if (metadataLog.is_open()) {
+        metadataLog << "governor_enabled=" << (settings.enabled ? "true" : "false") << "\n";
+        metadataLog << "quality_bounds=" << settings.qualityMin << "-" << settings.qualityMax << "\n";
+        metadataLog << "max_frame_interval=" << settings.maxFrameInterval << "\n";
+        metadataLog.flush();
+    }
+}
+
+static void logAdjustment(int fromLevel, int toLevel, double cpuIdle, double avgLatency, size_t maxDepth) {
+    double elapsed = duration<double>(steady_clock::now() - governorStart).count();
+
+    cout << "Governor: level " << fromLevel << " -> " << toLevel
+         << " (quality " << currentQuality << ", every " << currentFrameInterval << " frame(s))" << endl;
+
+    lock_guard<mutex> lock(metadataMutex);
+    if (metadataLog.is_open()) {
+        metadataLog << fixed << setprecision(3)
+                    << "t=" << elapsed
+                    << " level=" << fromLevel << "->" << toLevel
+                    << " quality=" << currentQuality
+                    << " frame_interval=" << currentFrameInterval
+                    << setprecision(1)
+                    << " queue_depth=" << maxDepth
+                    << " write_latency_ms=" << avgLatency
+                    << " cpu_idle=" << cpuIdle << "\n";
+        metadataLog.flush();
+    }
+}
+
+void governorObserve(size_t queueDepth, double writeLatencyMs) {
+    windowMaxQueueDepth = max(windowMaxQueueDepth, queueDepth);
+    windowLatencySum += writeLatencyMs;
+    windowFrames++;
+
+    setMetric("recording_queue_depth", queueDepth);
+    setMetric("recording_write_latency_ms", writeLatencyMs);
+
+    auto now = steady_clock::now();
+    if (duration<double, milli>(now - windowStart).count() < settings.evalMs) {
+        return;
+    }
+
+    double avgLatency = windowFrames > 0 ? windowLatencySum / windowFrames : 0.0;
+    double cpuIdle = readCpuIdlePercent();
+    size_t maxDepth = windowMaxQueueDepth;
+    setMetric("cpu_idle_percent", cpuIdle);
+
+    windowMaxQueueDepth = 0;
+    windowLatencySum = 0.0;
+    windowFrames = 0;
+    windowStart = now;
+
+    if (!settings.enabled) {
+        return;
+    }
+
+    bool underPressure = static_cast<int>(maxDepth) >= settings.queueHigh ||
+                         avgLatency >= settings.latencyHighMs ||
+                         cpuIdle <= settings.cpuIdleLow;
+    bool calm = static_cast<int>(maxDepth) <= settings.queueLow &&
+                avgLatency <= settings.latencyLowMs &&
+                cpuIdle >= settings.cpuIdleHigh;
+
+    int level = governorLevel;
+    int newLevel = level;
+
+    if (underPressure) {
+        calmWindows = 0;
+        newLevel = min(level + 1, maxGovernorLevel());
+    } else if (calm) {
+        // Only step back up after a sustained calm period (hysteresis)
+        calmWindows++;
+        if (calmWindows * settings.evalMs >= settings.recoverSeconds * 1000) {
+            calmWindows = 0;
+            newLevel = max(level - 1, 0);
+        }
+    } else {
+        calmWindows = 0;
+    }
+
+    if (newLevel != level) {
+        governorLevel = newLevel;
+        applyLevel(newLevel);
+        logAdjustment(level, newLevel, cpuIdle, avgLatency, maxDepth);
+    }
+}
+
+void logRecordingMetadata(const string& line) {
+    lock_guard<mutex> lock(metadataMutex);
+    if (metadataLog.is_open()) {
+        metadataLog << line << "\n";
+        metadataLog.flush();
+    }
+}
+
+void closeRecordingGovernor() {
+    lock_guard<mutex> lock(metadataMutex);
+    if (metadataLog.is_open()) {
+        metadataLog.close();
+    }
+}
+
+int governorJpegQuality() {
+    return currentQuality;
+}
+
+int governorFrameInterval() {
+    return currentFrameInterval;
+}
@@ -0,0 +1,30 @@
+#ifndef RECORDING_GOVERNOR_H
+#define RECORDING_GOVERNOR_H
+
+#include "common.h"
+
+// Read the GOVERNOR_* settings, done by startRecording before the streams open
+void loadGovernorSettings();
+
+// Reset the governor for a new recording, adjustments are appended to metadataPath
+void resetRecordingGovernor(const string& metadataPath);
+
+// Feed the governor with the state after one frame was written
+void governorObserve(size_t queueDepth, double writeLatencyMs);
+
+// Append a line to the current recording's metadata
+void logRecordingMetadata(const string& line);
+
+// Close the metadata log at the end of a recording
+void closeRecordingGovernor();
+
+// JPEG quality the writers should currently use
+int governorJpegQuality();
+
+// Record every Nth captured frame (1 = every frame)
+int governorFrameInterval();
+
+// Fraction of CPU time that was idle since the previous call (0-100)
+double readCpuIdlePercent();
+
+#endif // RECORDING_GOVERNOR_H
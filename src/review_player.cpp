@@ -0,0 +1,500 @@
+#include "review_player.h"
+#include "clip_export.h"
+#include "export_dialog.h"
+#include "metrics.h"
+#include "perf_hud.h"
+#include <list>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#define REVIEW_READ_AHEAD 8
+#define REVIEW_INDEX_CACHE 4
+#define REVIEW_BUTTON_COUNT 9
+
+static const int reviewSpeeds[] = {1, 2, 4, 16};
+static const int reviewSpeedCount = sizeof(reviewSpeeds) / sizeof(reviewSpeeds[0]);
+
+// Recently opened recordings with their index, newest first. Only the
+// decode thread touches the cache, and only one decode thread runs at a time.
+struct CachedIndex {
+    string path;
+    time_t mtime;
+    off_t size;
+    shared_ptr<RecordingSource> source;
+};
+static list<CachedIndex> indexCache;
+
+static thread decodeThread;
+
+// Shared with the decode thread, guarded by reviewMutex
+static mutex reviewMutex;
+static condition_variable reviewCondition;
+static bool decodeActive = false;
+static bool indexReady = false;
+static bool indexFailed = false;
+static size_t frameCount = 0;
+static double frameFps = 30.0;
+static size_t position = 0;
+static bool playing = false;
+static int speedIndex = 0;
+static map<size_t, Mat> decodedFrames;   // Scaled to fit the video area, empty if unreadable
+static uint64_t reviewVersion = 0;
+
+// UI thread only
+static bool reviewShown = false;
+static string reviewName;
+static Rect panelRect;
+static Rect reviewVideoRect;
+static Rect timelineRect;
+static Rect buttonRects[REVIEW_BUTTON_COUNT];
+static Mat shownFrame;
+static steady_clock::time_point lastAdvance;
+static bool scrubbing = false;
+
+static shared_ptr<RecordingSource> cachedRecordingIndex(const string& path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return nullptr;
+    }
+
+    // A rewritten file is indexed again
+    for (auto it = indexCache.begin(); it != indexCache.end(); ++it) {
+        if (it->path != path) {
+            continue;
+        }
+        if (it->mtime == info.st_mtime && it->size == info.st_size) {
+            indexCache.splice(indexCache.begin(), indexCache, it);
+            return indexCache.front().source;
+        }
+        indexCache.erase(it);
+        break;
+    }
+
+    auto source = make_shared<RecordingSource>();
+    if (!source->open(path)) {
+        return nullptr;
+    }
+
+    indexCache.push_front({path, info.st_mtime, info.st_size, source});
+    if (indexCache.size() > REVIEW_INDEX_CACHE) {
+        indexCache.pop_back();
+    }
+    return source;
+}
+
+// Frames the player will show next, nearest first. Caller holds reviewMutex.
+static void wantedFrames(vector<size_t>& wanted) {
+    wanted.clear();
+    wanted.push_back(position);
+
+    // While recording only the shown frame is decoded, there is no read-ahead
+    if (isRecording) {
+        return;
+    }
+
+    size_t step = playing ? reviewSpeeds[speedIndex] : 1;
+    for (int k = 1; k < REVIEW_READ_AHEAD; k++) {
+        size_t frame = position + k * step;
+        if (frame >= frameCount) {
+            break;
+        }
+        wanted.push_back(frame);
+    }
+
+    // Paused, stepping back is as likely as stepping forward
+    if (!playing && position > 0) {
+        wanted.push_back(position - 1);
+    }
+}
+
+static void decodeLoop(string path, Size area) {
+    setCurrentThreadName("review");
+
+    // Below every normal thread, so capture and recording are never delayed
+    sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+    shared_ptr<RecordingSource> source = cachedRecordingIndex(path);
+    Size fitSize;
+    int decodeFlags = IMREAD_COLOR;
+    {
+        lock_guard<mutex> lock(reviewMutex);
+        if (!source) {
+            indexFailed = true;
+            reviewVersion++;
+            return;
+        }
+        frameCount = source->frameCount();
+        frameFps = source->fps();
+        indexReady = true;
+        reviewVersion++;
+
+        // Decode at the smallest JPEG scale that still covers the video area
+        Size frameSize = source->frameSize();
+        double scale = min(static_cast<double>(area.width) / frameSize.width,
+                           static_cast<double>(area.height) / frameSize.height);
+        fitSize = Size(max(1, static_cast<int>(frameSize.width * scale)),
+                       max(1, static_cast<int>(frameSize.height * scale)));
+        if (frameSize.width >= fitSize.width * 8) {
+            decodeFlags = IMREAD_REDUCED_COLOR_8;
+        } else if (frameSize.width >= fitSize.width * 4) {
+            decodeFlags = IMREAD_REDUCED_COLOR_4;
+        } else if (frameSize.width >= fitSize.width * 2) {
+            decodeFlags = IMREAD_REDUCED_COLOR_2;
+        }
+    }
+
+    vector<uint8_t> data;
+    vector<size_t> wanted;
+    unique_lock<mutex> lock(reviewMutex);
+
+    while (decodeActive) {
+        wantedFrames(wanted);
+
+        // Frames behind a seek or a speed change are dropped
+        for (auto it = decodedFrames.begin(); it != decodedFrames.end();) {
+            if (find(wanted.begin(), wanted.end(), it->first) == wanted.end()) {
+                it = decodedFrames.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        size_t next = SIZE_MAX;
+        for (size_t frame : wanted) {
+            if (decodedFrames.find(frame) == decodedFrames.end()) {
+                next = frame;
+                break;
+            }
+        }
+
+        if (next == SIZE_MAX) {
+            reviewCondition.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        steady_clock::time_point start = steady_clock::now();
+        Mat shown;
+        if (source->readFrame(next, data)) {
+            Mat decoded = imdecode(data, decodeFlags);
+            if (!decoded.empty()) {
+                if (decoded.size() != fitSize) {
+                    resize(decoded, shown, fitSize, 0, 0, INTER_AREA);
+                } else {
+                    shown = decoded;
+                }
+            }
+        }
+        setMetric("review_decode_ms", duration<double, milli>(steady_clock::now() - start).count());
+        lock.lock();
+
+        decodedFrames[next] = shown;
+        if (next == position) {
+            reviewVersion++;
+        }
+    }
+}
+
+void openReview(const string& path, Rect panel) {
+    closeReview();
+
+    panelRect = panel;
+    reviewVideoRect = Rect(panel.x + 20, panel.y + 50, panel.width - 40, panel.height - 150);
+    timelineRect = Rect(reviewVideoRect.x, reviewVideoRect.y + reviewVideoRect.height + 15,
+                        reviewVideoRect.width, 16);
+
+    int spacing = 8;
+    int buttonWidth = (reviewVideoRect.width - spacing * (REVIEW_BUTTON_COUNT - 1)) / REVIEW_BUTTON_COUNT;
+    for (int b = 0; b < REVIEW_BUTTON_COUNT; b++) {
+        buttonRects[b] = Rect(reviewVideoRect.x + b * (buttonWidth + spacing),
+                              timelineRect.y + timelineRect.height + 20, buttonWidth, 36);
+    }
+
+    size_t slash = path.find_last_of('/');
+    reviewName = slash == string::npos ? path : path.substr(slash + 1);
+    shownFrame.release();
+    scrubbing = false;
+    lastAdvance = steady_clock::now();
+
+    {
+        lock_guard<mutex> lock(reviewMutex);
+        decodeActive = true;
+        indexReady = false;
+        indexFailed = false;
+        frameCount = 0;
+        position = 0;
+        playing = false;
+        speedIndex = 0;
+        decodedFrames.clear();
+        reviewVersion++;
+    }
+
+    reviewShown = true;
+    decodeThread = thread(decodeLoop, path, reviewVideoRect.size());
+}
+
+void closeReview() {
+    if (!reviewShown) {
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(reviewMutex);
+        decodeActive = false;
+        decodedFrames.clear();
+    }
+    reviewCondition.notify_one();
+    if (decodeThread.joinable()) {
+        decodeThread.join();
+    }
+
+    shownFrame.release();
+    reviewShown = false;
+}
+
+bool reviewActive() {
+    return reviewShown;
+}
+
+// Move the playhead, the decode thread follows. Caller holds reviewMutex.
+static void seekLocked(long long frame) {
+    if (frameCount == 0) {
+        return;
+    }
+    position = static_cast<size_t>(max(0LL, min(frame, static_cast<long long>(frameCount) - 1)));
+    reviewVersion++;
+    reviewCondition.notify_one();
+}
+
+uint64_t updateReview() {
+    lock_guard<mutex> lock(reviewMutex);
+    if (!playing || !indexReady) {
+        return reviewVersion;
+    }
+
+    steady_clock::time_point now = steady_clock::now();
+    auto interval = duration_cast<steady_clock::duration>(duration<double>(1.0 / frameFps));
+    if (now - lastAdvance < interval) {
+        return reviewVersion;
+    }
+
+    size_t next = position + reviewSpeeds[speedIndex];
+    if (next >= frameCount) {
+        playing = false;
+        reviewVersion++;
+        return reviewVersion;
+    }
+
+    // Playback waits for a late frame instead of skipping it
+    if (decodedFrames.find(next) != decodedFrames.end()) {
+        seekLocked(next);
+        lastAdvance = max(lastAdvance + interval, now - interval);
+    }
+    return reviewVersion;
+}
+
+void drawReview(Mat& img) {
+    static const char* labels[REVIEW_BUTTON_COUNT] = {
+        "-1s", "-1f", "Play", "+1f", "+1s", "1x", "Start", "End", "Close"
+    };
+
+    bool ready;
+    bool failed;
+    size_t frame;
+    size_t frames;
+    double fps;
+    bool isPlaying;
+    int speed;
+    {
+        lock_guard<mutex> lock(reviewMutex);
+        ready = indexReady;
+        failed = indexFailed;
+        frame = position;
+        frames = frameCount;
+        fps = frameFps;
+        isPlaying = playing;
+        speed = reviewSpeeds[speedIndex];
+
+        // Keep showing the previous frame until the new one is decoded
+        auto decoded = decodedFrames.find(position);
+        if (decoded != decodedFrames.end() && !decoded->second.empty()) {
+            shownFrame = decoded->second;
+        }
+    }
+
+    rectangle(img, panelRect, THEME_COLOR, -1);
+    rectangle(img, panelRect, Scalar(150, 150, 150), 2);
+    putText(img, "Review: " + reviewName, Point(panelRect.x + 20, panelRect.y + 30),
+            FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
+
+    rectangle(img, reviewVideoRect, Scalar(0, 0, 0), -1);
+    if (!shownFrame.empty()) {
+        Rect target(reviewVideoRect.x + (reviewVideoRect.width - shownFrame.cols) / 2,
+                    reviewVideoRect.y + (reviewVideoRect.height - shownFrame.rows) / 2,
+                    shownFrame.cols, shownFrame.rows);
+        shownFrame.copyTo(img(target & reviewVideoRect));
+    } else if (failed || !ready) {
+        putText(img, failed ? "No frame index, can't review" : "Indexing...",
+                Point(reviewVideoRect.x + 20, reviewVideoRect.y + 40),
+                FONT_HERSHEY_SIMPLEX, 0.7, TEXT_COLOR, 2);
+    }
+
+    // Timeline with the trim range and the playhead
+    rectangle(img, timelineRect, Scalar(60, 60, 60), -1);
+    if (ready && frames > 0) {
+        auto frameX = [&](size_t f) {
+            return timelineRect.x + static_cast<int>(static_cast<double>(f) * (timelineRect.width - 1) / max<size_t>(1, frames - 1));
+        };
+
+        if (trimFileIndex >= 0 && trimFileIndex < static_cast<int>(trimStartFrames.size())) {
+            size_t start = trimStartFrames[trimFileIndex];
+            size_t end = trimEndFrames[trimFileIndex] < 0 ? frames - 1 : trimEndFrames[trimFileIndex];
+            rectangle(img, Rect(frameX(start), timelineRect.y, max(1, frameX(end) - frameX(start)), timelineRect.height),
+                      HIGHLIGHT_COLOR, -1);
+        }
+        int playheadX = frameX(frame);
+        rectangle(img, Rect(playheadX - 2, timelineRect.y - 4, 4, timelineRect.height + 8), TEXT_COLOR, -1);
+
+        string timeText = formatClipTime(frame, fps) + " / " + formatClipTime(frames - 1, fps) +
+                          "   frame " + to_string(frame + 1) + "/" + to_string(frames);
+        putText(img, timeText, Point(panelRect.x + panelRect.width / 2 - 60, panelRect.y + 30),
+                FONT_HERSHEY_SIMPLEX, 0.55, TEXT_COLOR, 1);
+    }
+    rectangle(img, timelineRect, Scalar(100, 100, 100), 1);
+
+    for (int b = 0; b < REVIEW_BUTTON_COUNT; b++) {
+        string label = labels[b];
+        if (b == 2 && isPlaying) {
+            label = "Pause";
+        } else if (b == 5) {
+            label = to_string(speed) + "x";
+        }
+
+        Scalar fill = b == REVIEW_BUTTON_COUNT - 1 ? Scalar(100, 60, 60) : Scalar(60, 60, 60);
+        rectangle(img, buttonRects[b], fill, -1);
+        rectangle(img, buttonRects[b], Scalar(100, 100, 100), 1);
+        putText(img, label, Point(buttonRects[b].x + 10, buttonRects[b].y + 24),
+                FONT_HERSHEY_SIMPLEX, 0.55, TEXT_COLOR, 1);
+    }
+}
+
+static void seekToTimeline(int x) {
+    lock_guard<mutex> lock(reviewMutex);
+    if (frameCount == 0) {
+        return;
+    }
+    double fraction = static_cast<double>(x - timelineRect.x) / max(1, timelineRect.width - 1);
+    seekLocked(static_cast<long long>(fraction * (frameCount - 1) + 0.5));
+}
+
+static void stepReview(long long frames) {
+    lock_guard<mutex> lock(reviewMutex);
+    playing = false;
+    seekLocked(static_cast<long long>(position) + frames);
+}
+
+static void togglePlayback() {
+    lock_guard<mutex> lock(reviewMutex);
+    if (!indexReady) {
+        return;
+    }
+    playing = !playing;
+
+    // Play from the start again once the end was reached
+    if (playing && position + 1 >= frameCount) {
+        position = 0;
+    }
+    lastAdvance = steady_clock::now();
+    reviewVersion++;
+    reviewCondition.notify_one();
+}
+
+static void nextSpeed() {
+    lock_guard<mutex> lock(reviewMutex);
+    speedIndex = (speedIndex + 1) % reviewSpeedCount;
+    reviewVersion++;
+    reviewCondition.notify_one();
+}
+
+static void markTrimPoint(bool start) {
+    size_t frame;
+    {
+        lock_guard<mutex> lock(reviewMutex);
+        if (!indexReady) {
+            return;
+        }
+        frame = position;
+    }
+    setTrimPoint(start, frame);
+}
+
+static void pressReviewButton(int button) {
+    long long second = 1;
+    {
+        lock_guard<mutex> lock(reviewMutex);
+        second = max(1LL, static_cast<long long>(frameFps + 0.5));
+    }
+
+    switch (button) {
+        case 0: stepReview(-second); break;
+        case 1: stepReview(-1); break;
+        case 2: togglePlayback(); break;
+        case 3: stepReview(1); break;
+        case 4: stepReview(second); break;
+        case 5: nextSpeed(); break;
+        case 6: markTrimPoint(true); break;
+        case 7: markTrimPoint(false); break;
+        default: closeReview(); break;
+    }
+}
+
+bool handleReviewMouse(int event, int x, int y) {
+    if (!reviewShown) {
+        return false;
+    }
+
+    Point point(x, y);
+    Rect scrubArea(timelineRect.x, timelineRect.y - 6, timelineRect.width, timelineRect.height + 12);
+
+    if (event == EVENT_LBUTTONDOWN) {
+        if (scrubArea.contains(point)) {
+            scrubbing = true;
+            {
+                lock_guard<mutex> lock(reviewMutex);
+                playing = false;
+            }
+            seekToTimeline(x);
+            return true;
+        }
+        for (int b = 0; b < REVIEW_BUTTON_COUNT; b++) {
+            if (buttonRects[b].contains(point)) {
+                pressReviewButton(b);
+                return true;
+            }
+        }
+    } else if (event == EVENT_MOUSEMOVE && scrubbing) {
+        seekToTimeline(x);
+        return true;
+    } else if (event == EVENT_LBUTTONUP && scrubbing) {
+        scrubbing = false;
+        return true;
+    }
+
+    return panelRect.contains(point);
+}
+
+void handleReviewKey(int key) {
+    switch (tolower(key)) {
+        case ' ': pressReviewButton(2); break;
+        case ',': pressReviewButton(1); break;
+        case '.': pressReviewButton(3); break;
+        case '[': pressReviewButton(0); break;
+        case ']': pressReviewButton(4); break;
+        case 's': pressReviewButton(5); break;
+        case 'i': pressReviewButton(6); break;
+        case 'o': pressReviewButton(7); break;
+        case 'q': pressReviewButton(8); break;
+        default: break;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef REVIEW_PLAYER_H
+#define REVIEW_PLAYER_H
+
+#include "common.h"
+
+// Review of a finished recording inside the export dialog. Frames are located
+// through the recording's index, kept for the last few files opened, so
+// seeking never scans the file. A decode thread at idle priority reads ahead
+// of the playhead. At 2x/4x/16x only every 2nd/4th/16th frame is decoded.
+
+// Open a recording in the panel, indexing and decoding run in the background
+void openReview(const string& path, Rect panel);
+
+// Stop the decode thread and hide the player
+void closeReview();
+
+// True while the player covers the export dialog
+bool reviewActive();
+
+// Advance the playhead, returns a version that changes whenever the player
+// needs redrawing
+uint64_t updateReview();
+
+// Render the player into its panel
+void drawReview(Mat& img);
+
+// Handle mouse input, returns true if consumed
+bool handleReviewMouse(int event, int x, int y);
+
+// Space plays or pauses, ',' '.' step a frame, '[' ']' a second, 's' changes
+// the speed, 'i' 'o' set the trim start and end, 'q' closes the player
+void handleReviewKey(int key);
+
+#endif // REVIEW_PLAYER_H
@@ -0,0 +1,191 @@
+#include "roi_recording.h"
+#include "camera.h"
+
+vector<Rect> recordingRois;
+bool roiEditMode = false;
+Rect roiButtonRect;
+
+// Drag state while drawing a new ROI (preview coordinates)
+static bool roiDragActive = false;
+static Point roiDragStart;
+static Point roiDragCurrent;
+
+static Size cameraFrameSize() {
+    Size frameSize = capturedFrameSize();
+    if (frameSize.width > 0 && frameSize.height > 0) {
+        return frameSize;
+    }
+    return Size(WIDTH, HEIGHT);
+}
+
+static Size previewSize() {
+    return Size(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+}
+
+bool roiRecordingActive() {
+    return appConfig.getBool("ROI_RECORDING", true) && !recordingRois.empty();
+}
+
+void toggleRoiEditMode() {
+    if (isRecording) {
+        setLogMessage("Stop rec before editing ROI");
+        return;
+    }
+
+    roiEditMode = !roiEditMode;
+    roiDragActive = false;
+
+    if (roiEditMode) {
+        setLogMessage("ROI: drag to add, right-click to remove");
+    } else if (recordingRois.empty()) {
+        setLogMessage("ROI: full frame");
+    } else {
+        setLogMessage("ROI: " + to_string(recordingRois.size()) + " region(s)");
+    }
+}
+
+Rect previewToFrameRect(const Rect& previewRect, Size previewSize, Size cameraSize) {
+    double sx = static_cast<double>(cameraSize.width) / previewSize.width;
+    double sy = static_cast<double>(cameraSize.height) / previewSize.height;
+
+    int x1 = static_cast<int>(floor(previewRect.x * sx));
+    int y1 = static_cast<int>(floor(previewRect.y * sy));
+    int x2 = static_cast<int>(ceil((previewRect.x + previewRect.width) * sx));
+    int y2 = static_cast<int>(ceil((previewRect.y + previewRect.height) * sy));
+
+    return Rect(x1, y1, x2 - x1, y2 - y1) & Rect(0, 0, cameraSize.width, cameraSize.height);
+}
+
+Rect frameToPreviewRect(const Rect& frameRect, Size cameraSize, Size previewSize) {
+    double sx = static_cast<double>(previewSize.width) / cameraSize.width;
+    double sy = static_cast<double>(previewSize.height) / cameraSize.height;
+
+    return Rect(static_cast<int>(frameRect.x * sx), static_cast<int>(frameRect.y * sy),
+                static_cast<int>(frameRect.width * sx), static_cast<int>(frameRect.height * sy));
+}
+
+Rect snapRoiToMacroblocks(const Rect& roi, Size cameraSize, int blockSize) {
+    if (blockSize <= 1) {
+        return roi & Rect(0, 0, cameraSize.width, cameraSize.height);
+    }
+
+    // Expand outwards so the drawn area is always fully covered
+    int x1 = (roi.x / blockSize) * blockSize;
+    int y1 = (roi.y / blockSize) * blockSize;
+    int x2 = ((roi.x + roi.width + blockSize - 1) / blockSize) * blockSize;
+    int y2 = ((roi.y + roi.height + blockSize - 1) / blockSize) * blockSize;
+
+    // Clamp to the largest block-aligned area inside the frame
+    int maxX = (cameraSize.width / blockSize) * blockSize;
+    int maxY = (cameraSize.height / blockSize) * blockSize;
+    x2 = min(x2, maxX);
+    y2 = min(y2, maxY);
+
+    // Keep at least one macroblock
+    if (x2 - x1 < blockSize) x1 = max(0, x2 - blockSize);
+    if (y2 - y1 < blockSize) y1 = max(0, y2 - blockSize);
+
+    return Rect(x1, y1, x2 - x1, y2 - y1);
+}
+
+static void addRoiFromDrag() {
+    Rect previewRect(roiDragStart, roiDragCurrent);
+    previewRect &= Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    // Ignore accidental clicks
+    if (previewRect.width < 10 || previewRect.height < 10) {
+        return;
+    }
+
+    int maxRois = appConfig.getInt("ROI_MAX_COUNT", 4);
+    if (static_cast<int>(recordingRois.size()) >= maxRois) {
+        setLogMessage("ROI limit reached (" + to_string(maxRois) + ")");
+        return;
+    }
+
+    Size cameraSize = cameraFrameSize();
+    Rect roi = previewToFrameRect(previewRect, previewSize(), cameraSize);
+    if (appConfig.getBool("ROI_SNAP_MACROBLOCK", true)) {
+        roi = snapRoiToMacroblocks(roi, cameraSize, appConfig.getInt("ROI_MACROBLOCK_SIZE", 16));
+    }
+
+    if (roi.width <= 0 || roi.height <= 0) {
+        return;
+    }
+
+    recordingRois.push_back(roi);
+    cout << "Added ROI " << recordingRois.size() << ": " << roi.x << "," << roi.y
+         << " " << roi.width << "x" << roi.height << endl;
+    setLogMessage("ROI " + to_string(recordingRois.size()) + ": " +
+                  to_string(roi.width) + "x" + to_string(roi.height));
+}
+
+static void removeRoiAt(int x, int y) {
+    Size cameraSize = cameraFrameSize();
+
+    // Remove the topmost ROI under the cursor, or all of them if none is hit
+    for (int i = static_cast<int>(recordingRois.size()) - 1; i >= 0; i--) {
+        Rect previewRect = frameToPreviewRect(recordingRois[i], cameraSize, previewSize());
+        if (previewRect.contains(Point(x, y))) {
+            recordingRois.erase(recordingRois.begin() + i);
+            setLogMessage("ROI removed");
+            return;
+        }
+    }
+
+    if (!recordingRois.empty()) {
+        recordingRois.clear();
+        setLogMessage("ROI cleared");
+    }
+}
+
+bool handleRoiMouse(int event, int x, int y) {
+    if (!roiEditMode) {
+        return false;
+    }
+
+    if (event == EVENT_LBUTTONDOWN) {
+        roiDragActive = true;
+        roiDragStart = Point(x, y);
+        roiDragCurrent = Point(x, y);
+        return true;
+    }
+    else if (event == EVENT_MOUSEMOVE && roiDragActive) {
+        roiDragCurrent = Point(x, y);
+        return true;
+    }
+    else if (event == EVENT_LBUTTONUP && roiDragActive) {
+        roiDragCurrent = Point(x, y);
+        roiDragActive = false;
+        addRoiFromDrag();
+        return true;
+    }
+    else if (event == EVENT_RBUTTONDOWN) {
+        removeRoiAt(x, y);
+        return true;
+    }
+
+    return false;
+}
+
+void drawRecordingRois(Mat& img, int windowWidth, int windowHeight) {
+    if (recordingRois.empty() && !roiDragActive) {
+        return;
+    }
+
+    Size cameraSize = cameraFrameSize();
+    Size displaySize(windowWidth, windowHeight);
+    Scalar roiColor = isRecording ? Scalar(0, 0, 255) : Scalar(0, 220, 220);
+
+    for (size_t i = 0; i < recordingRois.size(); i++) {
+        Rect previewRect = frameToPreviewRect(recordingRois[i], cameraSize, displaySize);
+        rectangle(img, previewRect, roiColor, 2);
+        putText(img, "ROI " + to_string(i + 1),
+                Point(previewRect.x + 5, previewRect.y + 20),
+                FONT_HERSHEY_SIMPLEX, 0.6, roiColor, 2);
+    }
+
+    if (roiDragActive) {
+        rectangle(img, Rect(roiDragStart, roiDragCurrent), Scalar(255, 255, 255), 1);
+    }
+}
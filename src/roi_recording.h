@@ -0,0 +1,33 @@
+#ifndef ROI_RECORDING_H
+#define ROI_RECORDING_H
+
+#include "common.h"
+
+// Regions of interest in camera frame coordinates. When non-empty and ROI
+// recording is enabled, only these crops are recorded, each to its own file.
+extern vector<Rect> recordingRois;
+extern bool roiEditMode;
+extern Rect roiButtonRect;
+
+// Toggle ROI edit mode (drag on the preview to add, right-click to remove)
+void toggleRoiEditMode();
+
+// Handle mouse input while in ROI edit mode, returns true if the event was consumed
+bool handleRoiMouse(int event, int x, int y);
+
+// Draw the configured ROIs (and the one being dragged) on the preview
+void drawRecordingRois(Mat& img, int windowWidth, int windowHeight);
+
+// Map a rectangle from preview coordinates to camera frame coordinates
+Rect previewToFrameRect(const Rect& previewRect, Size previewSize, Size cameraSize);
+
+// Map a rectangle from camera frame coordinates to preview coordinates
+Rect frameToPreviewRect(const Rect& frameRect, Size cameraSize, Size previewSize);
+
+// Grow a rectangle outwards to codec macroblock boundaries, clamped to the frame
+Rect snapRoiToMacroblocks(const Rect& roi, Size cameraSize, int blockSize);
+
+// True if recording should write ROI crops instead of the full frame
+bool roiRecordingActive();
+
+#endif // ROI_RECORDING_H
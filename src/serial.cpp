@@ -1,8 +1,6 @@
 #include "serial.h"
 #include "config.h"
 
-serialib cameraSerial;
-
 std::string decToHex(int decimalNumber) {
     std::stringstream ss;
     ss << std::setfill('0') << std::setw(2) << std::hex << decimalNumber;
@@ -19,141 +17,33 @@ std::string decToHex(int decimalNumber) {
     return paddedResult;
 }
 
-bool initializeSerial() {
-    // Try to find available serial ports
-    const char* serialPorts[] = {"/dev/ttyUSB0", "/dev/ttyACM0", "/dev/ttyS0"};
-
-    for (const char* port : serialPorts) {
-        if (cameraSerial.openDevice(port, 9600) == 1) {
-            std::cout << "Serial port opened: " << port << std::endl;
-            cameraSerial.flushReceiver();
-
-            // Send initial command
-            const char* initCmd = "8101044700000000FF";
-
-            // Convert hex string to bytes and send
-            int len = strlen(initCmd) / 2;
-            unsigned char buffer[len];
-
-            for (int i = 0; i < len; i++) {
-                char byteStr[3] = {initCmd[i*2], initCmd[i*2+1], 0};
-                buffer[i] = (unsigned char)strtol(byteStr, NULL, 16);
-            }
-
-            cameraSerial.writeBytes(buffer, len);
-            serialInitialized = true;
-            return true;
-        }
-    }
-
-    std::cerr << "Failed to open any serial port" << std::endl;
-    return false;
+future<ViscaStatus> sendZoomCommand(int level) {
+    // Held zoom buttons send a target every ZOOM_DELAY_MS, only the newest is kept
+    return submitViscaCommand("81010447" + decToHex(level) + "FF", "zoom " + to_string(level), true,
+                              appConfig.getInt("VISCA_ZOOM_TIMEOUT_MS", 2000));
 }
 
-void sendZoomCommand(int level) {
-    if (!serialInitialized) {
-        if (!initializeSerial()) {
-            setLogMessage("Serial error");
-            return;
-        }
-    }
-
-    std::string hexLevel = decToHex(level);
-    std::string cmdStr = "81010447" + hexLevel + "FF";
-
-    std::cout << "Sending zoom command: " << cmdStr << std::endl;
-
-    // Convert hex string to bytes and send
-    int len = cmdStr.length() / 2;
-    unsigned char buffer[len];
-
-    for (int i = 0; i < len; i++) {
-        char byteStr[3] = {cmdStr[i*2], cmdStr[i*2+1], 0};
-        buffer[i] = (unsigned char)strtol(byteStr, NULL, 16);
-    }
-
-    cameraSerial.writeBytes(buffer, len);
-}
-
-void sendICRCommand(bool enable) {
-    if (!serialInitialized) {
-        if (!initializeSerial()) {
-            setLogMessage("Serial error");
-            return;
-        }
-    }
-
+future<ViscaStatus> sendICRCommand(bool enable) {
     // Command to enable ICR: 81 01 04 01 02 FF
     // Command to disable ICR: 81 01 04 01 03 FF
-    std::string cmdStr = enable ? "8101040102FF" : "8101040103FF";
-
-    std::cout << "Sending ICR command: " << cmdStr << " (Enable: " << enable << ")" << std::endl;
-
-    // Convert hex string to bytes and send
-    int len = cmdStr.length() / 2;
-    unsigned char buffer[len];
-
-    for (int i = 0; i < len; i++) {
-        char byteStr[3] = {cmdStr[i*2], cmdStr[i*2+1], 0};
-        buffer[i] = (unsigned char)strtol(byteStr, NULL, 16);
-    }
-
-    cameraSerial.writeBytes(buffer, len);
     setLogMessage(std::string("ICR Mode: ") + (enable ? "ON" : "OFF"));
+    return submitViscaCommand(enable ? "8101040102FF" : "8101040103FF", enable ? "ICR on" : "ICR off");
 }
 
-void sendIRCorrectionCommand(bool enable) {
-    if (!serialInitialized) {
-        if (!initializeSerial()) {
-            setLogMessage("Serial error");
-            return;
-        }
-    }
-
+future<ViscaStatus> sendIRCorrectionCommand(bool enable) {
     // Command to enable IR Correction: 81 01 04 11 01 FF
     // Command to disable IR Correction: 81 01 04 11 00 FF
-    std::string cmdStr = enable ? "8101041101FF" : "8101041100FF";
-
-    std::cout << "Sending IR Correction command: " << cmdStr << " (Enable: " << enable << ")" << std::endl;
-
-    // Convert hex string to bytes and send
-    int len = cmdStr.length() / 2;
-    unsigned char buffer[len];
-
-    for (int i = 0; i < len; i++) {
-        char byteStr[3] = {cmdStr[i*2], cmdStr[i*2+1], 0};
-        buffer[i] = (unsigned char)strtol(byteStr, NULL, 16);
-    }
-
-    cameraSerial.writeBytes(buffer, len);
     setLogMessage(std::string("IR Correction: ") + (enable ? "ON" : "OFF"));
+    return submitViscaCommand(enable ? "8101041101FF" : "8101041100FF",
+                              enable ? "IR correction on" : "IR correction off");
 }
 
-void sendStabilizerCommand(bool enable) {
-    if (!serialInitialized) {
-        if (!initializeSerial()) {
-            setLogMessage("Serial error");
-            return;
-        }
-    }
-
+future<ViscaStatus> sendStabilizerCommand(bool enable) {
     // Command to enable Stabilizer: 81 01 04 34 02 FF
     // Command to disable Stabilizer: 81 01 04 34 03 FF
-    std::string cmdStr = enable ? "8101043402FF" : "8101043403FF";
-
-    std::cout << "Sending Stabilizer command: " << cmdStr << " (Enable: " << enable << ")" << std::endl;
-
-    // Convert hex string to bytes and send
-    int len = cmdStr.length() / 2;
-    unsigned char buffer[len];
-
-    for (int i = 0; i < len; i++) {
-        char byteStr[3] = {cmdStr[i*2], cmdStr[i*2+1], 0};
-        buffer[i] = (unsigned char)strtol(byteStr, NULL, 16);
-    }
-
-    cameraSerial.writeBytes(buffer, len);
     setLogMessage(std::string("Stabilizer: ") + (enable ? "ON" : "OFF"));
+    return submitViscaCommand(enable ? "8101043402FF" : "8101043403FF",
+                              enable ? "stabilizer on" : "stabilizer off");
 }
 
 void zoomIn() {
@@ -2,16 +2,10 @@
 #define SERIAL_H
 
 #include "common.h"
-#include "serialib.h"
-
-extern serialib cameraSerial;
-extern bool serialInitialized;
-
-// Initialize serial connection
-bool initializeSerial();
+#include "visca_engine.h"
 
 // Send zoom command
-void sendZoomCommand(int level);
+future<ViscaStatus> sendZoomCommand(int level);
 
 // Function to convert decimal to hex string
 std::string decToHex(int decimalNumber);
@@ -19,8 +13,11 @@ std::string decToHex(int decimalNumber);
 // Zoom functions
 void zoomIn();
 void zoomOut();
-void sendICRCommand(bool enable);
-void sendIRCorrectionCommand(bool enable);
-void sendStabilizerCommand(bool enable);
+
+// Camera commands are queued for the serial thread and never block, the
+// futures complete with the camera's answer
+future<ViscaStatus> sendICRCommand(bool enable);
+future<ViscaStatus> sendIRCorrectionCommand(bool enable);
+future<ViscaStatus> sendStabilizerCommand(bool enable);
 
 #endif // SERIAL_H
@@ -0,0 +1,136 @@
+#include "text_overlay.h"
+
+// Write a non-negative integer, returns the number of characters written
+static size_t writeNumber(char* out, int value, int minDigits) {
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0 || count < minDigits);
+
+    for (int i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+void formatOverlayLine(OverlayLine& line, system_clock::time_point time, int fps) {
+    // Date and time only change once a second, so cache the formatted prefix
+    static thread_local time_t cachedSecond = -1;
+    static thread_local char cachedPrefix[20];
+
+    time_t seconds = system_clock::to_time_t(time);
+    if (seconds != cachedSecond) {
+        struct tm timeinfo;
+        localtime_r(&seconds, &timeinfo);
+
+        char* p = cachedPrefix;
+        p += writeNumber(p, timeinfo.tm_year + 1900, 4);
+        *p++ = '-';
+        p += writeNumber(p, timeinfo.tm_mon + 1, 2);
+        *p++ = '-';
+        p += writeNumber(p, timeinfo.tm_mday, 2);
+        *p++ = ' ';
+        p += writeNumber(p, timeinfo.tm_hour, 2);
+        *p++ = ':';
+        p += writeNumber(p, timeinfo.tm_min, 2);
+        *p++ = ':';
+        p += writeNumber(p, timeinfo.tm_sec, 2);
+        cachedSecond = seconds;
+    }
+
+    memcpy(line.text, cachedPrefix, 19);
+    line.length = 19;
+
+    if (fps >= 0) {
+        memcpy(line.text + line.length, " FPS: ", 6);
+        line.length += 6;
+        line.length += writeNumber(line.text + line.length, min(fps, 99999), 1);
+    }
+    line.text[line.length] = '\0';
+}
+
+GlyphAtlas::GlyphAtlas(int fontFace, double fontScale, int thickness) {
+    int baseline = 0;
+    Size textSize = getTextSize("Ag", fontFace, fontScale, thickness, &baseline);
+
+    // Leave room for the stroke thickness above the ascent and below the descent
+    top = textSize.height + thickness;
+    height = top + baseline + thickness;
+
+    for (char c = 32; c <= 126; c++) {
+        string text(1, c);
+        int advance = max(1, getTextSize(text, fontFace, fontScale, thickness, &baseline).width);
+
+        Mat mask = Mat::zeros(height, advance, CV_8UC1);
+        putText(mask, text, Point(0, top), fontFace, fontScale, Scalar(255), thickness);
+
+        glyphs.push_back(mask);
+        advances.push_back(advance);
+    }
+}
+
+TextOverlay::TextOverlay(int fontFace, double fontScale, int thickness)
+    : atlas(fontFace, fontScale, thickness), lastLength(0), lastWidth(0) {
+    memset(lastText, 0, sizeof(lastText));
+    memset(lastX, 0, sizeof(lastX));
+}
+
+int TextOverlay::width(const OverlayLine& line) const {
+    int x = 0;
+    for (size_t i = 0; i < min(line.length, static_cast<size_t>(OVERLAY_TEXT_MAX - 1)); i++) {
+        x += atlas.advance(line.text[i]);
+    }
+    return x;
+}
+
+void TextOverlay::draw(Mat& img, const OverlayLine& line, Point origin, const Scalar& color) {
+    int lineWidth = width(line);
+    if (lineWidth == 0) {
+        return;
+    }
+
+    // Grow the strip when the line gets longer, the cache is rebuilt from scratch
+    if (lineMask.cols < lineWidth) {
+        lineMask = Mat::zeros(atlas.cellHeight(), lineWidth + 64, CV_8UC1);
+        lastLength = 0;
+        lastWidth = 0;
+    }
+
+    // Re-blit only the cells whose character or position changed. Digits all
+    // have the same advance, so a ticking clock only touches a few cells.
+    size_t length = min(line.length, static_cast<size_t>(OVERLAY_TEXT_MAX - 1));
+    int x = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = line.text[i];
+        int advance = atlas.advance(c);
+
+        if (i >= lastLength || lastText[i] != c || lastX[i] != x) {
+            atlas.glyph(c).copyTo(lineMask(Rect(x, 0, advance, atlas.cellHeight())));
+            lastText[i] = c;
+            lastX[i] = x;
+        }
+        x += advance;
+    }
+
+    // Clear what is left of a longer previous line
+    if (lastWidth > lineWidth) {
+        lineMask(Rect(lineWidth, 0, lastWidth - lineWidth, atlas.cellHeight())).setTo(Scalar(0));
+    }
+    for (size_t i = length; i < lastLength; i++) {
+        lastText[i] = 0;
+    }
+    lastLength = length;
+    lastWidth = lineWidth;
+
+    // Paint the strip, clipped to the image
+    Rect target(origin.x, origin.y - atlas.ascent(), lineWidth, atlas.cellHeight());
+    Rect visible = target & Rect(0, 0, img.cols, img.rows);
+    if (visible.empty()) {
+        return;
+    }
+
+    Rect source(visible.x - target.x, visible.y - target.y, visible.width, visible.height);
+    img(visible).setTo(color, lineMask(source));
+}
@@ -0,0 +1,52 @@
+#ifndef TEXT_OVERLAY_H
+#define TEXT_OVERLAY_H
+
+#include "common.h"
+
+// Format "YYYY-MM-DD HH:MM:SS" (plus " FPS: n" when fps >= 0) without heap
+// allocations. localtime only runs when the second changes.
+void formatOverlayLine(OverlayLine& line, system_clock::time_point time, int fps = -1);
+
+// Printable ASCII glyphs pre-rendered once as masks, one cell per character
+class GlyphAtlas {
+public:
+    GlyphAtlas(int fontFace, double fontScale, int thickness);
+
+    const Mat& glyph(char c) const { return glyphs[index(c)]; }
+    int advance(char c) const { return advances[index(c)]; }
+    int cellHeight() const { return height; }
+    int ascent() const { return top; }
+
+private:
+    vector<Mat> glyphs;
+    vector<int> advances;
+    int height;
+    int top;
+
+    static int index(char c) { return (c < 32 || c > 126) ? 0 : c - 32; }
+};
+
+// One line of overlay text drawn from a glyph atlas. The line is kept as a
+// mask and only characters that changed since the previous call are re-blitted,
+// then the mask is painted onto the image in one pass.
+// Not thread safe, each thread that draws text uses its own instance.
+class TextOverlay {
+public:
+    TextOverlay(int fontFace, double fontScale, int thickness);
+
+    // origin is the bottom-left of the text baseline, as for putText
+    void draw(Mat& img, const OverlayLine& line, Point origin, const Scalar& color);
+
+    // Width of the line in pixels
+    int width(const OverlayLine& line) const;
+
+private:
+    GlyphAtlas atlas;
+    Mat lineMask;
+    char lastText[OVERLAY_TEXT_MAX];
+    int lastX[OVERLAY_TEXT_MAX];
+    size_t lastLength;
+    int lastWidth;
+};
+
+#endif // TEXT_OVERLAY_H
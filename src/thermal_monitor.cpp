@@ -0,0 +1,159 @@
+#include "thermal_monitor.h"
+#include "metrics.h"
+#include "perf_hud.h"
+#include <dirent.h>
+
+// Firmware throttling flags (as reported by vcgencmd get_throttled)
+#define THROTTLED_UNDER_VOLTAGE   0x1
+#define THROTTLED_FREQ_CAPPED     0x2
+#define THROTTLED_NOW             0x4
+#define THROTTLED_SOFT_TEMP_LIMIT 0x8
+
+struct ThermalSettings {
+    string sysfsRoot;
+    double warmC;
+    double hotC;
+    double hysteresisC;
+    int warmPreviewInterval;
+    int hotPreviewInterval;
+    int pollMs;
+};
+
+static ThermalSettings settings;
+static thread thermalThread;
+static atomic<bool> thermalMonitorActive(false);
+static atomic<int> currentLevel(THERMAL_NORMAL);
+static atomic<int> temperatureMilliC(0);
+
+void loadThermalSettings() {
+    settings.sysfsRoot = appConfig.getString("THERMAL_SYSFS_ROOT", "/sys");
+    settings.warmC = appConfig.getDouble("THERMAL_WARM_C", 70.0);
+    settings.hotC = max(settings.warmC, appConfig.getDouble("THERMAL_HOT_C", 78.0));
+    settings.hysteresisC = max(0.0, appConfig.getDouble("THERMAL_HYSTERESIS_C", 3.0));
+    settings.warmPreviewInterval = max(1, appConfig.getInt("THERMAL_WARM_PREVIEW_INTERVAL", 2));
+    settings.hotPreviewInterval = max(1, appConfig.getInt("THERMAL_HOT_PREVIEW_INTERVAL", 4));
+    settings.pollMs = max(100, appConfig.getInt("THERMAL_POLL_MS", 1000));
+}
+
+// Highest temperature of all thermal zones in millidegrees, -1 if none found
+static int readHottestZone() {
+    string zonesPath = settings.sysfsRoot + "/class/thermal";
+    DIR* dir = opendir(zonesPath.c_str());
+    if (!dir) {
+        return -1;
+    }
+
+    int hottest = -1;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, "thermal_zone", 12) != 0) {
+            continue;
+        }
+
+        ifstream tempFile(zonesPath + "/" + ent->d_name + "/temp");
+        int milliC = 0;
+        if (tempFile >> milliC) {
+            hottest = max(hottest, milliC);
+        }
+    }
+    closedir(dir);
+    return hottest;
+}
+
+// Firmware throttling flags, 0 if the firmware doesn't report them
+static unsigned int readThrottledFlags() {
+    ifstream throttledFile(settings.sysfsRoot + "/devices/platform/soc/soc:firmware/get_throttled");
+    unsigned int flags = 0;
+    if (!(throttledFile >> hex >> flags)) {
+        return 0;
+    }
+    return flags;
+}
+
+void pollThermalState() {
+    int milliC = readHottestZone();
+    unsigned int throttled = readThrottledFlags();
+    double celsius = milliC > 0 ? milliC / 1000.0 : 0.0;
+    temperatureMilliC = max(0, milliC);
+
+    // Step up as soon as a threshold is crossed, step down only once the
+    // temperature is a margin below it so the level doesn't flap
+    int level = currentLevel;
+    int target = THERMAL_NORMAL;
+    if (celsius >= settings.hotC || (throttled & (THROTTLED_NOW | THROTTLED_SOFT_TEMP_LIMIT))) {
+        target = THERMAL_HOT;
+    } else if (celsius >= settings.warmC) {
+        target = THERMAL_WARM;
+    }
+
+    if (target < level) {
+        double threshold = level == THERMAL_HOT ? settings.hotC : settings.warmC;
+        bool firmwareThrottling = (throttled & (THROTTLED_NOW | THROTTLED_SOFT_TEMP_LIMIT)) != 0;
+        if (celsius > threshold - settings.hysteresisC || firmwareThrottling) {
+            target = level;
+        }
+    }
+
+    if (target != level) {
+        currentLevel = target;
+        cout << "Thermal level " << level << " -> " << target << " at " << celsius << " C"
+             << " (throttled=0x" << hex << throttled << dec << ")" << endl;
+    }
+
+    setMetric("thermal_temperature_c", celsius);
+    setMetric("thermal_level", target);
+    setMetric("thermal_throttled", (throttled & THROTTLED_NOW) ? 1 : 0);
+    setMetric("thermal_under_voltage", (throttled & THROTTLED_UNDER_VOLTAGE) ? 1 : 0);
+}
+
+static void thermalMonitorLoop() {
+    setCurrentThreadName("thermal");
+    while (thermalMonitorActive) {
+        pollThermalState();
+
+        // Sleep in small steps so shutdown stays responsive
+        for (int waited = 0; waited < settings.pollMs && thermalMonitorActive; waited += 50) {
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+    }
+}
+
+void startThermalMonitor() {
+    if (thermalMonitorActive || !appConfig.getBool("THERMAL_MONITOR", true)) {
+        return;
+    }
+
+    loadThermalSettings();
+    thermalMonitorActive = true;
+    thermalThread = thread(thermalMonitorLoop);
+}
+
+void stopThermalMonitor() {
+    thermalMonitorActive = false;
+    if (thermalThread.joinable()) {
+        thermalThread.join();
+    }
+}
+
+int thermalLevel() {
+    return currentLevel;
+}
+
+double thermalTemperature() {
+    return temperatureMilliC / 1000.0;
+}
+
+int thermalPreviewInterval() {
+    switch (currentLevel.load()) {
+        case THERMAL_HOT:
+            return settings.hotPreviewInterval;
+        case THERMAL_WARM:
+            return settings.warmPreviewInterval;
+        default:
+            return 1;
+    }
+}
+
+bool thermalShedOptionalWork() {
+    return currentLevel >= THERMAL_WARM;
+}
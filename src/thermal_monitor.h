@@ -0,0 +1,34 @@
+#ifndef THERMAL_MONITOR_H
+#define THERMAL_MONITOR_H
+
+#include "common.h"
+
+// Thermal levels, each one sheds more optional work
+#define THERMAL_NORMAL  0
+#define THERMAL_WARM    1   // Preview rate lowered, optional streams paused
+#define THERMAL_HOT     2   // Preview rate lowered further
+
+// Start/stop the background thread that polls the thermal zones and the
+// firmware throttling state under THERMAL_SYSFS_ROOT
+void startThermalMonitor();
+void stopThermalMonitor();
+
+// Current thermal level (THERMAL_*)
+int thermalLevel();
+
+// Hottest thermal zone in degrees Celsius (0 if none could be read)
+double thermalTemperature();
+
+// Render only every Nth preview frame. Capture and recording always run at full rate.
+int thermalPreviewInterval();
+
+// True while optional work (proxy stream, thumbnails, analysis) should pause
+bool thermalShedOptionalWork();
+
+// Read the THERMAL_* settings, done by startThermalMonitor
+void loadThermalSettings();
+
+// Take one reading and update the level, used by the monitor thread
+void pollThermalState();
+
+#endif // THERMAL_MONITOR_H
@@ -0,0 +1,184 @@
+#include "thumbnail_cache.h"
+#include "clip_export.h"
+#include "metrics.h"
+#include "perf_hud.h"
+#include "thermal_monitor.h"
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+// ioprio_set(2) has no glibc wrapper
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+
+static thread thumbnailThread;
+static atomic<bool> thumbnailWorkerActive(false);
+
+// Guarded by thumbnailMutex
+static mutex thumbnailMutex;
+static condition_variable thumbnailCondition;
+static vector<string> requestedPaths;
+static map<string, RecordingThumbnail> thumbnails;     // By file identity
+static uint64_t version = 0;
+
+// Name, size and modification time, so a rewritten file gets a new sprite sheet
+static bool fileIdentity(const string& path, string& identity, uint64_t& bytes) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+
+    char key[64];
+    snprintf(key, sizeof(key), "%016zx_%llx_%llx", hash<string>()(path),
+             static_cast<unsigned long long>(info.st_size), static_cast<unsigned long long>(info.st_mtime));
+    identity = key;
+    bytes = info.st_size;
+    return true;
+}
+
+// Decode the frames at the middle of THUMBNAIL_FRAMES equal slices of the recording
+static Mat generateSprite(RecordingSource& source) {
+    Mat sprite(THUMBNAIL_HEIGHT, THUMBNAIL_WIDTH * THUMBNAIL_FRAMES, CV_8UC3, Scalar(0, 0, 0));
+    vector<uint8_t> data;
+
+    for (int i = 0; i < THUMBNAIL_FRAMES; i++) {
+        // Recording started meanwhile, leave the CPU and the disk to it
+        if (isRecording || !thumbnailWorkerActive) {
+            return Mat();
+        }
+
+        size_t frame = source.frameCount() * (2 * i + 1) / (2 * THUMBNAIL_FRAMES);
+        if (!source.readFrame(frame, data)) {
+            return Mat();
+        }
+
+        // An eighth scale decode only runs the DC part of the JPEG
+        Mat decoded = imdecode(data, IMREAD_REDUCED_COLOR_8);
+        if (decoded.empty()) {
+            return Mat();
+        }
+        Mat cell = sprite(Rect(i * THUMBNAIL_WIDTH, 0, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT));
+        resize(decoded, cell, cell.size(), 0, 0, INTER_AREA);
+    }
+    return sprite;
+}
+
+static void buildThumbnail(const string& path, const string& identity, RecordingThumbnail& thumbnail) {
+    string cacheDir = appConfig.getString("THUMBNAIL_CACHE_DIR", "./recordings/.thumbs/");
+    string cachePath = cacheDir + identity + ".jpg";
+
+    RecordingSource source;
+    if (!source.open(path)) {
+        return;
+    }
+    thumbnail.durationSeconds = source.frameCount() / source.fps();
+
+    Mat cached = imread(cachePath, IMREAD_COLOR);
+    if (cached.cols == THUMBNAIL_WIDTH * THUMBNAIL_FRAMES && cached.rows == THUMBNAIL_HEIGHT) {
+        thumbnail.sprite = cached;
+        return;
+    }
+
+    steady_clock::time_point start = steady_clock::now();
+    thumbnail.sprite = generateSprite(source);
+    if (thumbnail.sprite.empty()) {
+        return;
+    }
+    setMetric("thumbnail_generate_ms", duration<double, milli>(steady_clock::now() - start).count());
+
+    // Written under a temp name so a half written sheet is never loaded
+    error_code ec;
+    filesystem::create_directories(cacheDir, ec);
+    string tempPath = cachePath + ".tmp.jpg";
+    if (imwrite(tempPath, thumbnail.sprite, {IMWRITE_JPEG_QUALITY, 80})) {
+        rename(tempPath.c_str(), cachePath.c_str());
+    }
+}
+
+static void thumbnailLoop() {
+    setCurrentThreadName("thumbnails");
+
+    // Idle CPU and I/O class, the worker only runs when nothing else wants to
+    sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+
+    unique_lock<mutex> lock(thumbnailMutex);
+    while (thumbnailWorkerActive) {
+        // Nothing at all while recording or while the SoC sheds optional work
+        if (requestedPaths.empty() || isRecording || thermalShedOptionalWork()) {
+            thumbnailCondition.wait_for(lock, milliseconds(500));
+            continue;
+        }
+
+        string path = requestedPaths.front();
+        requestedPaths.erase(requestedPaths.begin());
+
+        string identity;
+        RecordingThumbnail thumbnail = {Mat(), 0.0, 0};
+        if (!fileIdentity(path, identity, thumbnail.fileBytes) || thumbnails.count(identity)) {
+            continue;
+        }
+
+        lock.unlock();
+        buildThumbnail(path, identity, thumbnail);
+        lock.lock();
+
+        // Interrupted by a recording, try again later
+        if (isRecording && thumbnail.sprite.empty()) {
+            continue;
+        }
+
+        thumbnails[identity] = thumbnail;
+        version++;
+    }
+}
+
+void startThumbnailWorker() {
+    if (thumbnailWorkerActive) {
+        return;
+    }
+    thumbnailWorkerActive = true;
+    thumbnailThread = thread(thumbnailLoop);
+}
+
+void stopThumbnailWorker() {
+    thumbnailWorkerActive = false;
+    thumbnailCondition.notify_one();
+    if (thumbnailThread.joinable()) {
+        thumbnailThread.join();
+    }
+}
+
+void requestThumbnails(const vector<string>& paths) {
+    {
+        lock_guard<mutex> lock(thumbnailMutex);
+        if (paths == requestedPaths) {
+            return;
+        }
+        requestedPaths = paths;
+    }
+    thumbnailCondition.notify_one();
+}
+
+bool getThumbnail(const string& path, RecordingThumbnail& thumbnail) {
+    string identity;
+    uint64_t bytes;
+    if (!fileIdentity(path, identity, bytes)) {
+        return false;
+    }
+
+    lock_guard<mutex> lock(thumbnailMutex);
+    auto it = thumbnails.find(identity);
+    if (it == thumbnails.end()) {
+        return false;
+    }
+    thumbnail = it->second;
+    return true;
+}
+
+uint64_t thumbnailVersion() {
+    lock_guard<mutex> lock(thumbnailMutex);
+    return version;
+}
@@ -0,0 +1,34 @@
+#ifndef THUMBNAIL_CACHE_H
+#define THUMBNAIL_CACHE_H
+
+#include "common.h"
+
+#define THUMBNAIL_FRAMES 3
+#define THUMBNAIL_WIDTH 64
+#define THUMBNAIL_HEIGHT 36
+
+// Evenly spaced frames of a recording side by side, with its duration and size.
+// Sprite sheets are generated by a background worker at idle CPU and I/O
+// priority and cached in THUMBNAIL_CACHE_DIR under a key made of the file's
+// name, size and modification time.
+struct RecordingThumbnail {
+    Mat sprite;                 // THUMBNAIL_FRAMES frames, empty if none could be read
+    double durationSeconds;     // 0 without a frame index
+    uint64_t fileBytes;
+};
+
+// Start/stop the worker thread
+void startThumbnailWorker();
+void stopThumbnailWorker();
+
+// The recordings whose rows are visible, in list order. Only these are
+// generated or loaded, rows scrolled away before their turn are skipped.
+void requestThumbnails(const vector<string>& paths);
+
+// Copy of the thumbnail for a recording, false while it is not ready yet
+bool getThumbnail(const string& path, RecordingThumbnail& thumbnail);
+
+// Changes whenever a thumbnail becomes ready
+uint64_t thumbnailVersion();
+
+#endif // THUMBNAIL_CACHE_H
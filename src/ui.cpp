@@ -1,6 +1,14 @@
 #include "ui.h"
 #include "serial.h"
 #include "recording.h"
+#include "roi_recording.h"
+#include "ui_compositor.h"
+#include "display.h"
+#include "magnifier.h"
+#include "exposure_meter.h"
+#include "perf_hud.h"
+#include "review_player.h"
+#include "directory_browser.h"
 #include <filesystem>
 #include <vector>
 #include <dirent.h>
@@ -12,6 +20,12 @@
 #include <X11/Xatom.h>
 #include <cstring>
 
+// Exposure histogram widget, toggled with 'h'
+static bool exposureMeterShown = false;
+
+// Performance HUD, toggled with 'p'
+static bool perfHudShown = false;
+
 void initializeUI(int windowWidth, int windowHeight) {
     // Top bar height (for window controls)
     int topBarHeight = 40;
@@ -65,11 +79,59 @@ void initializeUI(int windowWidth, int windowHeight) {
     int controlsHeight = 100;
     
     initIR(controlsX, controlsY, controlsWidth, controlsHeight);
+
+    exposureMeterShown = appConfig.getBool("EXPOSURE_METER", true);
+    perfHudShown = appConfig.getBool("PERF_HUD", false);
+}
+
+// Record button or 'r'
+static void toggleRecording() {
+    if (isProcessing) {
+        // Don't allow starting a new recording while processing
+        setLogMessage("Processing...");
+        return;
+    }
+
+    if (!isRecording) {
+        startRecording();
+    } else {
+        stopRecording();
+    }
+}
+
+// Export button or 'e'
+static void openExportDialog() {
+    if (isProcessing) {
+        // The files are still being written or exported
+        setLogMessage("Processing...");
+    } else if (!isRecording) {
+        showExportDialog = true;
+        createExportDialog(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        scanRecordingDirectory();
+        setLogMessage("Preparing export dialog...");
+    } else {
+        setLogMessage("Stop rec before exporting");
+    }
 }
 
 void mouseCallback(int event, int x, int y, int flags, void* userdata) {
-    appConfig.loadConfig();
+    // The magnifier sits above the preview, but is hidden behind the export dialog
+    if (!showExportDialog && handleMagnifierMouse(event, x, y)) {
+        return;
+    }
+
+    // The review player covers the export dialog, clicks outside it close the dialog
+    if (showExportDialog && reviewActive() && handleReviewMouse(event, x, y)) {
+        return;
+    }
+    if (showExportDialog && directoryBrowserActive() && handleDirectoryBrowserMouse(event, x, y)) {
+        return;
+    }
+
     if (event == EVENT_LBUTTONDOWN) {
+        // Pick up config edits on clicks, not on every pointer motion
+        appConfig.loadConfig();
+
         if (toggleNavButtonRect.contains(Point(x, y))) {
             showNavBar = !showNavBar;
             return;
@@ -112,6 +174,7 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
                         size_t fileIndex = i + scrollOffset;
                         if (fileIndex < fileSelection.size()) {
                             fileSelection[fileIndex] = !fileSelection[fileIndex];
+                            selectTrimFile(fileIndex);
                             fileAreaClicked = true;
                             break;
                         }
@@ -119,12 +182,26 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
                 }
             }
 
+            // Check if click was on a trim button
+            if (!fileAreaClicked) {
+                for (size_t i = 0; i < mouseData.trimButtonRects.size(); i++) {
+                    if (mouseData.trimButtonRects[i].contains(Point(x, y))) {
+                        adjustTrim(static_cast<int>(i));
+                        fileAreaClicked = true;
+                        break;
+                    }
+                }
+            }
+
+            // Check if the review button was clicked
+            if (!fileAreaClicked && mouseData.reviewButtonRect.contains(Point(x, y))) {
+                openTrimFileReview();
+                fileAreaClicked = true;
+            }
+
             // Check if browse button was clicked
             if (!fileAreaClicked && dirSelectRect.contains(Point(x, y))) {
-                string selectedDir = openDirectoryBrowser();
-                if (!selectedDir.empty()) {
-                    exportDestDir = selectedDir;
-                }
+                openDirectoryBrowser(exportDialogRect);
             }
             // Check if click was on "Keep original files" checkbox or its text
             else if (!fileAreaClicked &&
@@ -132,6 +209,18 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
                      Rect(keepFilesRect.x + 25, keepFilesRect.y, 150, 20).contains(Point(x, y)))) {
                 keepOriginalFiles = !keepOriginalFiles;
             }
+            // Check if click was on "Export proxies only" checkbox or its text
+            else if (!fileAreaClicked &&
+                    (Rect(proxiesOnlyRect.x, proxiesOnlyRect.y, 20, 20).contains(Point(x, y)) ||
+                     Rect(proxiesOnlyRect.x + 25, proxiesOnlyRect.y, 190, 20).contains(Point(x, y)))) {
+                exportProxiesOnly = !exportProxiesOnly;
+            }
+            // Check if click was on "Join selected into one file" checkbox or its text
+            else if (!fileAreaClicked &&
+                    (Rect(joinFilesRect.x, joinFilesRect.y, 20, 20).contains(Point(x, y)) ||
+                     Rect(joinFilesRect.x + 25, joinFilesRect.y, 260, 20).contains(Point(x, y)))) {
+                exportJoinFiles = !exportJoinFiles;
+            }
             // Check if click was on scroll buttons
             else if (!fileAreaClicked && scrollUpRect.contains(Point(x, y)) && scrollOffset > 0) {
                 scrollOffset--;
@@ -142,7 +231,7 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
             }
             // Check if Export button was clicked
             else if (!fileAreaClicked && exportConfirmRect.contains(Point(x, y))) {
-                performExport();
+                startExport();
                 showExportDialog = false;
             }
             // Check if Cancel button was clicked
@@ -152,18 +241,27 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
                 setLogMessage("");
             }
             
-            if (!showExportDialog) 
+            if (!showExportDialog) {
+                closeReview();
+                closeDirectoryBrowser();
                 return;
+            }
         }
         
         if (minimizeButtonRect.contains(Point(x, y))) {
             // Just minimize the window
-            system("xdotool search --name \"Water Dripping Investigation Recording Tools\" windowminimize");
+            minimizeDisplay();
             return;
         }
         else if (closeButtonRect.contains(Point(x, y))) {
             // Close window
-            destroyWindow("Water Dripping Investigation Recording Tools");
+            closeDisplay();
+            return;
+        }
+
+        // In ROI edit mode, clicks on the video (outside the nav bar) start a new ROI
+        if (roiEditMode && !(showNavBar && navBarRect.contains(Point(x, y)))) {
+            handleRoiMouse(event, x, y);
             return;
         }
 
@@ -173,66 +271,22 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
         }
 
         if (recordButtonRect.contains(Point(x, y))) {
-            // Record button clicked
-            if (isProcessing) {
-                // Don't allow starting a new recording while processing
-                setLogMessage("Processing...");
-                return;
-            }
-            
-            isRecording = !isRecording;
-
-            if (isRecording) {
-                // Start recording code
-                time_t now = time(0);
-                char buffer[80];
-                strftime(buffer, 80, "%Y%m%d_%H%M%S", localtime(&now));
-                tempFilename = "/tmp/" + string(buffer) + "_temp.avi";
-
-                recordingStartTime = system_clock::now();
-                setLogMessage("Rec started...");
-                progressValue = 0;
-            } else {
-                // Stop recording code
-                if (videoWriter.isOpened()) {
-                    recordingDurationSeconds = duration<double>(system_clock::now() - recordingStartTime).count();
-                    videoWriter.release();
-                    setLogMessage("Rec stopped");
-
-                    // Cancel any ongoing processing
-                    if (isProcessing && processingThread.joinable()) {
-                        isProcessing = false;
-                        processingThread.join();
-                    }
-                    
-                    // Start processing in a new thread using the temp file
-                    isProcessing = true;
-                    if (processingThread.joinable()) {
-                        processingThread.join();
-                    }
-                    processingThread = thread(postProcessVideo, tempFilename, recordingDurationSeconds);
-                }
-            }
+            toggleRecording();
         } else if (exportButtonRect.contains(Point(x, y))) {
-            // Export button clicked - show export dialog
-            if (!isRecording) {
-                showExportDialog = true;
-                createExportDialog(DISPLAY_WIDTH, DISPLAY_HEIGHT);
-                scanRecordingDirectory();
-                setLogMessage("Preparing export dialog...");
-            } else {
-                setLogMessage("Stop rec before exporting");
-            }
+            openExportDialog();
+        } else if (roiButtonRect.contains(Point(x, y))) {
+            // ROI button clicked - toggle ROI edit mode
+            toggleRoiEditMode();
         } else if (zoomInButtonRect.contains(Point(x, y))) {
             // Zoom in button pressed down
             isZoomInHeld = true;
-            lastZoomTime = system_clock::now();
+            lastZoomTime = inputEventTime();
             // Perform initial zoom immediately
             zoomIn();
         } else if (zoomOutButtonRect.contains(Point(x, y))) {
             // Zoom out button pressed down
             isZoomOutHeld = true;
-            lastZoomTime = system_clock::now();
+            lastZoomTime = inputEventTime();
             // Perform initial zoom immediately
             zoomOut();
         }
@@ -241,8 +295,17 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
         // Handle button releases
         isZoomInHeld = false;
         isZoomOutHeld = false;
+        handleRoiMouse(event, x, y);
+    }
+    else if (event == EVENT_RBUTTONDOWN) {
+        // Right-click removes ROIs while editing
+        if (!showExportDialog) {
+            handleRoiMouse(event, x, y);
+        }
     }
     else if (event == EVENT_MOUSEMOVE) {
+        handleRoiMouse(event, x, y);
+
         // If mouse moved outside the button area while button is held, stop zooming
         if (isZoomInHeld && !zoomInButtonRect.contains(Point(x, y))) {
             isZoomInHeld = false;
@@ -253,6 +316,46 @@ void mouseCallback(int event, int x, int y, int flags, void* userdata) {
     }
 }
 
+void handleShortcutKey(int key) {
+    // The export dialog is mouse only, apart from the review player
+    if (showExportDialog) {
+        if (reviewActive()) {
+            handleReviewKey(key);
+        }
+        return;
+    }
+
+    switch (tolower(key)) {
+        case 'r':
+            toggleRecording();
+            break;
+        case 'e':
+            openExportDialog();
+            break;
+        case 'n':
+            showNavBar = !showNavBar;
+            break;
+        case 'm':
+            toggleMagnifier();
+            break;
+        case 'p':
+            perfHudShown = !perfHudShown;
+            break;
+        case 'h':
+            exposureMeterShown = !exposureMeterShown && appConfig.getBool("EXPOSURE_METER", true);
+            break;
+        case '+':
+        case '=':
+            zoomIn();
+            break;
+        case '-':
+            zoomOut();
+            break;
+        default:
+            break;
+    }
+}
+
 // Modify the initIR function to position controls correctly
 void initIR(int x, int y, int width, int height) {
     // Position buttons in the panel
@@ -307,3 +410,69 @@ void drawIR(Mat& frame, bool bgActive) {
             FONT_HERSHEY_SIMPLEX, 0.5, TEXT_COLOR, 1);
 }
 
+
+void updateUiLayers(int windowWidth) {
+    // Nav bar buttons and status message, over a 70% theme-colored panel
+    uint64_t navState = (showNavBar ? 1 : 0) | (isRecording ? 2 : 0) | (isProcessing ? 4 : 0) |
+                        (isZoomInHeld ? 8 : 0) | (isZoomOutHeld ? 16 : 0) | (roiEditMode ? 32 : 0) |
+                        (static_cast<uint64_t>(recordingRois.size()) << 8) |
+                        (logMessageVersion.load() << 16) |
+                        (isProcessing ? static_cast<uint64_t>(progressValue.load()) << 56 : 0);
+    updateUiLayer(LAYER_NAV_BAR, navBarRect, navState, [&](Mat& canvas) {
+        drawNavigationBar(canvas, windowWidth, isRecording, isProcessing, isZoomInHeld, isZoomOutHeld);
+    });
+    setUiLayerVisible(LAYER_NAV_BAR, showNavBar);
+
+    // Arrow that shows or hides the nav bar
+    updateUiLayer(LAYER_NAV_TOGGLE, toggleNavButtonRect, showNavBar ? 1 : 0, [](Mat& canvas) {
+        (showNavBar ? downArrowImage : upArrowImage).copyTo(canvas(toggleNavButtonRect));
+    });
+
+    // ICR and stabilizer buttons, hidden behind the export dialog. The panel
+    // border is 2px wide and centered on the panel edge, so grow the layer by 1px.
+    Rect irRect(min(icrButtonRect.x, stabilizerButtonRect.x) - 11, icrButtonRect.y - 16, 0, icrButtonRect.height + 32);
+    irRect.width = max(icrButtonRect.x + icrButtonRect.width,
+                       stabilizerButtonRect.x + stabilizerButtonRect.width) - irRect.x + 11;
+    uint64_t irState = (icrModeEnabled ? 1 : 0) | (stabilizerEnabled ? 2 : 0) | (showExportDialog ? 4 : 0);
+    updateUiLayer(LAYER_IR_CONTROLS, irRect, irState, [](Mat& canvas) {
+        drawIR(canvas, false);
+    });
+    setUiLayerVisible(LAYER_IR_CONTROLS, !showExportDialog);
+
+    // Histogram and clipping meter, re-rendered once per completed sampling pass
+    ExposureStats exposure;
+    getExposureStats(exposure);
+    Rect exposureRect(windowWidth - 270, 50, 260, 110);
+    updateUiLayer(LAYER_EXPOSURE, exposureRect, exposure.version, [&](Mat& canvas) {
+        drawExposureMeter(canvas, exposureRect, exposure);
+    }, Scalar(30, 40, 30), 0.6);
+    setUiLayerVisible(LAYER_EXPOSURE, exposureMeterShown && !showExportDialog);
+
+    // Performance HUD, re-rendered twice a second. Refreshing also exports the stage timings.
+    Rect perfHudRect(10, 160, 380, 320);
+    updateUiLayer(LAYER_PERF_HUD, perfHudRect, refreshPerfHud(perfHudShown), [&](Mat& canvas) {
+        drawPerfHud(canvas, perfHudRect);
+    }, Scalar(30, 30, 30), 0.6);
+    setUiLayerVisible(LAYER_PERF_HUD, perfHudShown && !showExportDialog);
+
+    // Minimize and close buttons never change
+    Rect controlsRect = closeButtonRect | minimizeButtonRect;
+    updateUiLayer(LAYER_WINDOW_CONTROLS, Rect(controlsRect.x - 1, controlsRect.y - 1,
+                                              controlsRect.width + 2, controlsRect.height + 2), 0, [](Mat& canvas) {
+        drawWindowControls(canvas);
+    });
+}
+
+void collectPreviewTints(vector<PreviewTint>& tints) {
+    tints.clear();
+
+    // The nav bar panel, its buttons come from the cached layer
+    if (showNavBar) {
+        tints.push_back({navBarRect, Scalar(20, 60, 20), 0.7});
+    }
+
+    // Dim everything behind the export dialog
+    if (showExportDialog) {
+        tints.push_back({Rect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT), Scalar(30, 30, 30), 0.7});
+    }
+}
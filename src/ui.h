@@ -5,10 +5,11 @@
 #include "export_dialog.h"
 #include "ui_helpers.h"
 #include "navigation_bar.h"
+#include "preview_scaler.h"
 
-extern bool icrModeEnabled;
+extern atomic<bool> icrModeEnabled;
 extern Rect icrButtonRect;
-extern bool stabilizerEnabled;
+extern atomic<bool> stabilizerEnabled;
 extern Rect stabilizerButtonRect;
 
 // Initialize UI components
@@ -17,10 +18,19 @@ void initializeUI(int windowWidth, int windowHeight);
 // Mouse callback function
 void mouseCallback(int event, int x, int y, int flags, void* userdata);
 
+// Keyboard shortcuts: r record/stop, e export, n nav bar, m magnifier, h histogram, p perf HUD, +/- zoom
+void handleShortcutKey(int key);
+
 void initIR(int x, int y, int width, int height);
 
 void drawIR(Mat& frame, bool bgActive);
 
+// Re-render the cached nav bar, toggle, ICR and window control layers whose state changed
+void updateUiLayers(int windowWidth);
+
+// Translucent panels the preview scaler blends in while it downscales the frame
+void collectPreviewTints(vector<PreviewTint>& tints);
+
 void createArrowImages();
 
 void updateToggleButtonPosition(int windowWidth);
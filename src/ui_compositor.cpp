@@ -0,0 +1,100 @@
+#include "ui_compositor.h"
+
+// Widgets never use this color, so it marks the pixels they didn't draw
+static const Scalar KEY_COLOR(255, 0, 255);
+
+struct UiLayer {
+    Rect bounds;
+    Mat bgr;            // CV_8UC3 layer pixels
+    Mat alpha;          // CV_8UC1, 0 = video shows through, 255 = opaque
+    uint64_t state = 0;
+    bool rendered = false;
+    bool visible = true;
+};
+
+static UiLayer layers[LAYER_COUNT];
+
+// Shared screen-sized canvas, so widgets can keep drawing in screen coordinates
+static Mat scratchCanvas;
+
+void updateUiLayer(UiLayerId id, Rect bounds, uint64_t state, const UiLayerRenderer& render,
+                   const Scalar& panelColor, double panelAlpha) {
+    UiLayer& layer = layers[id];
+    if (layer.rendered && layer.state == state && layer.bounds == bounds) {
+        return;
+    }
+
+    if (bounds.empty()) {
+        layer.rendered = false;
+        return;
+    }
+
+    Rect canvasRect(0, 0, bounds.x + bounds.width, bounds.y + bounds.height);
+    if (scratchCanvas.cols < canvasRect.width || scratchCanvas.rows < canvasRect.height) {
+        scratchCanvas.create(max(scratchCanvas.rows, canvasRect.height),
+                             max(scratchCanvas.cols, canvasRect.width), CV_8UC3);
+    }
+
+    Mat region = scratchCanvas(bounds);
+    region.setTo(KEY_COLOR);
+    render(scratchCanvas);
+
+    // Untouched pixels become the panel (or fully transparent), drawn ones opaque
+    Mat untouched;
+    inRange(region, KEY_COLOR, KEY_COLOR, untouched);
+
+    region.copyTo(layer.bgr);
+    layer.bgr.setTo(panelColor, untouched);
+    layer.alpha.create(bounds.size(), CV_8UC1);
+    layer.alpha.setTo(Scalar(255));
+    layer.alpha.setTo(Scalar(saturate_cast<uchar>(panelAlpha * 255.0)), untouched);
+
+    layer.bounds = bounds;
+    layer.state = state;
+    layer.rendered = true;
+}
+
+void setUiLayerVisible(UiLayerId id, bool visible) {
+    layers[id].visible = visible;
+}
+
+void compositeUiLayer(Mat& img, UiLayerId id) {
+    const UiLayer& layer = layers[id];
+    if (!layer.visible || !layer.rendered) {
+        return;
+    }
+
+    Rect visible = layer.bounds & Rect(0, 0, img.cols, img.rows);
+    if (visible.empty()) {
+        return;
+    }
+
+    // Blend row by row, the inner loop is simple enough for the compiler to vectorize
+    int offsetX = visible.x - layer.bounds.x;
+    int offsetY = visible.y - layer.bounds.y;
+    for (int y = 0; y < visible.height; y++) {
+        const uchar* src = layer.bgr.ptr<uchar>(y + offsetY) + offsetX * 3;
+        const uchar* alpha = layer.alpha.ptr<uchar>(y + offsetY) + offsetX;
+        uchar* dst = img.ptr<uchar>(y + visible.y) + visible.x * 3;
+
+        for (int x = 0; x < visible.width; x++) {
+            int a = alpha[x];
+            for (int c = 0; c < 3; c++) {
+                int blended = src[x * 3 + c] * a + dst[x * 3 + c] * (255 - a) + 128;
+                dst[x * 3 + c] = static_cast<uchar>((blended + (blended >> 8)) >> 8);
+            }
+        }
+    }
+}
+
+void compositeUiLayers(Mat& img) {
+    for (int id = 0; id < LAYER_COUNT; id++) {
+        compositeUiLayer(img, static_cast<UiLayerId>(id));
+    }
+}
+
+void invalidateUiLayers() {
+    for (UiLayer& layer : layers) {
+        layer.rendered = false;
+    }
+}
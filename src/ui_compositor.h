@@ -0,0 +1,39 @@
+#ifndef UI_COMPOSITOR_H
+#define UI_COMPOSITOR_H
+
+#include "common.h"
+#include <functional>
+
+// Cached UI layers, listed in drawing order
+enum UiLayerId {
+    LAYER_NAV_BAR,
+    LAYER_NAV_TOGGLE,
+    LAYER_IR_CONTROLS,
+    LAYER_EXPOSURE,
+    LAYER_PERF_HUD,
+    LAYER_WINDOW_CONTROLS,
+    LAYER_COUNT
+};
+
+// Draws a widget with its usual screen coordinates onto a scratch canvas
+typedef function<void(Mat& canvas)> UiLayerRenderer;
+
+// Re-render a layer only if its bounds or state changed since the last call.
+// Whatever the renderer leaves untouched is transparent, or covered by the
+// panel color at panelAlpha (0..1) when one is given.
+void updateUiLayer(UiLayerId id, Rect bounds, uint64_t state, const UiLayerRenderer& render,
+                   const Scalar& panelColor = Scalar(), double panelAlpha = 0.0);
+
+// Show or hide a layer without dropping its cached pixels
+void setUiLayerVisible(UiLayerId id, bool visible);
+
+// Alpha-blend all visible layers onto the image
+void compositeUiLayers(Mat& img);
+
+// Alpha-blend a single layer, for widgets that must stay above a dialog
+void compositeUiLayer(Mat& img, UiLayerId id);
+
+// Force every layer to re-render on its next update
+void invalidateUiLayers();
+
+#endif // UI_COMPOSITOR_H
@@ -83,3 +83,15 @@ void drawWindowControls(Mat& img) {
          Scalar(220, 220, 220), 2);
 }
 
+string formatFileSize(uint64_t bytes) {
+    const char* units[] = {"B", "KB", "MB", "GB"};
+    double size = static_cast<double>(bytes);
+    int unit = 0;
+    while (size >= 1024 && unit < 3) {
+        size /= 1024;
+        unit++;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.1f %s", size, units[unit]);
+    return text;
+}
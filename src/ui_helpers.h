@@ -15,4 +15,7 @@ void updateToggleButtonPosition(int windowWidth);
 // Draw window control buttons (minimize/close)
 void drawWindowControls(Mat& img);
 
+// Byte count as B/KB/MB/GB
+string formatFileSize(uint64_t bytes);
+
 #endif // UI_HELPERS_H
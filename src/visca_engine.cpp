@@ -0,0 +1,436 @@
+#include "visca_engine.h"
+#include "serialib.h"
+#include "metrics.h"
+#include "perf_hud.h"
+
+// After a failed open the ports are probed again at most this often, so a
+// camera that is unplugged fails commands fast instead of re-probing each time
+#define VISCA_REOPEN_INTERVAL_MS 5000
+
+// The camera executes at most two commands at once, a third gets Buffer Full
+#define VISCA_COMMAND_SOCKETS 2
+
+// A command that timed out may still be running and answer late. Its socket
+// counts as busy and its replies are ignored for this long.
+#define VISCA_STALE_REPLY_MS 5000
+
+// Upper bounds of the write to reply latency histogram
+static const int latencyBucketsMs[] = {10, 25, 50, 100, 250, 500, 1000, 2500};
+
+struct ViscaCommand {
+    vector<uint8_t> packet;
+    string description;
+    bool coalesce;                          // Position command, see submitViscaCommand
+    int timeoutMs;
+    steady_clock::time_point queuedAt;      // When the current target was submitted
+    steady_clock::time_point writtenAt;
+    int socket;                             // From the ACK, -1 until acknowledged
+    vector<promise<ViscaStatus>> waiters;   // Every caller whose command this became
+};
+
+static thread viscaThread;
+static atomic<bool> viscaActive(false);
+
+// Guarded by viscaMutex
+static mutex viscaMutex;
+static condition_variable viscaCondition;
+static deque<shared_ptr<ViscaCommand>> viscaQueue;
+
+// Serial thread only
+static serialib cameraSerial;
+static bool serialOpen = false;
+static bool openAttempted = false;
+static steady_clock::time_point lastOpenAttempt;
+static ViscaReplyParser replyParser;
+static deque<shared_ptr<ViscaCommand>> inFlight;   // Written, oldest first
+
+// Commands that timed out, oldest first, until they answer or go stale
+struct ExpiredCommand {
+    int socket;                             // -1 if the ACK never came
+    steady_clock::time_point forgetAt;
+};
+static deque<ExpiredCommand> expired;
+static double averageZoomLatencyMs = 0.0;
+
+static vector<uint8_t> hexToBytes(const string& hex) {
+    vector<uint8_t> bytes;
+    for (size_t i = 0; i + 1 < hex.length(); i += 2) {
+        char byteStr[3] = {hex[i], hex[i + 1], 0};
+        bytes.push_back(static_cast<uint8_t>(strtol(byteStr, NULL, 16)));
+    }
+    return bytes;
+}
+
+// Parse whatever the camera sent since the last call. serialib's timed reads
+// spin on a non-blocking descriptor, so only bytes already there are read.
+static void readReplies(vector<ViscaReply>& replies) {
+    int pending = cameraSerial.available();
+    if (pending <= 0) {
+        return;
+    }
+
+    vector<uint8_t> bytes(pending);
+    int received = cameraSerial.readBytes(bytes.data(), pending, 1);
+    replyParser.feed(bytes.data(), max(0, received), replies);
+}
+
+// Probe the usual ports and send the initial zoom position
+static bool openCameraSerial() {
+    const char* serialPorts[] = {"/dev/ttyUSB0", "/dev/ttyACM0", "/dev/ttyS0"};
+
+    for (const char* port : serialPorts) {
+        if (cameraSerial.openDevice(port, 9600) == 1) {
+            cout << "Serial port opened: " << port << endl;
+            cameraSerial.flushReceiver();
+            replyParser.reset();
+            expired.clear();
+
+            vector<uint8_t> init = hexToBytes("8101044700000000FF");
+            cameraSerial.writeBytes(init.data(), init.size());
+
+            // Its ACK would otherwise be taken for the first queued command's
+            steady_clock::time_point deadline = steady_clock::now() + milliseconds(500);
+            vector<ViscaReply> replies;
+            while (steady_clock::now() < deadline) {
+                readReplies(replies);
+                if (!replies.empty() && replies.back().type != ViscaReply::Ack) {
+                    break;
+                }
+                this_thread::sleep_for(milliseconds(1));
+            }
+            return true;
+        }
+    }
+
+    cerr << "Failed to open any serial port" << endl;
+    return false;
+}
+
+static bool ensureSerialOpen() {
+    if (serialOpen) {
+        return true;
+    }
+
+    steady_clock::time_point now = steady_clock::now();
+    if (openAttempted && now - lastOpenAttempt < milliseconds(VISCA_REOPEN_INTERVAL_MS)) {
+        return false;
+    }
+    openAttempted = true;
+    lastOpenAttempt = now;
+    serialOpen = openCameraSerial();
+    setMetric("visca_port_open", serialOpen ? 1 : 0);
+    return serialOpen;
+}
+
+// Prometheus style cumulative buckets, written as labels of the metric name
+static string latencyBucket(const string& bound) {
+    return "visca_latency_ms_bucket{le=\"" + bound + "\"}";
+}
+
+static void observeLatency(double latencyMs) {
+    for (int bound : latencyBucketsMs) {
+        if (latencyMs <= bound) {
+            incrementMetric(latencyBucket(to_string(bound)));
+        }
+    }
+    incrementMetric(latencyBucket("+Inf"));
+    incrementMetric("visca_latency_ms_sum", latencyMs);
+    incrementMetric("visca_latency_ms_count");
+}
+
+static void finishCommand(ViscaCommand& command, ViscaStatus status) {
+    steady_clock::time_point now = steady_clock::now();
+    incrementMetric(string("visca_commands_total{result=\"") + viscaStatusName(status) + "\"}");
+
+    if (status == ViscaStatus::Completed) {
+        observeLatency(duration<double, milli>(now - command.writtenAt).count());
+    } else {
+        cerr << "ERROR: VISCA " << command.description << " failed: " << viscaStatusName(status) << endl;
+        incrementMetric("visca_commands_failed");
+    }
+
+    if (command.coalesce && status != ViscaStatus::PortError) {
+        double latencyMs = duration<double, milli>(now - command.queuedAt).count();
+        averageZoomLatencyMs = averageZoomLatencyMs > 0 ? averageZoomLatencyMs * 0.9 + latencyMs * 0.1 : latencyMs;
+        setMetric("visca_zoom_latency_ms", latencyMs);
+        setMetric("visca_zoom_latency_avg_ms", averageZoomLatencyMs);
+    }
+
+    for (promise<ViscaStatus>& waiter : command.waiters) {
+        waiter.set_value(status);
+    }
+}
+
+static void finishInFlight(deque<shared_ptr<ViscaCommand>>::iterator it, ViscaStatus status) {
+    shared_ptr<ViscaCommand> command = *it;
+    inFlight.erase(it);
+    setMetric("visca_in_flight", inFlight.size());
+    finishCommand(*command, status);
+}
+
+static deque<shared_ptr<ViscaCommand>>::iterator firstUnacknowledged() {
+    return find_if(inFlight.begin(), inFlight.end(), [](const shared_ptr<ViscaCommand>& c) { return c->socket < 0; });
+}
+
+static deque<ExpiredCommand>::iterator expiredUnacknowledged() {
+    return find_if(expired.begin(), expired.end(), [](const ExpiredCommand& c) { return c.socket < 0; });
+}
+
+// A late reply of a command that already timed out, it is dropped so it can't
+// finish a newer command. Returns false if the reply belongs to no such command.
+static bool consumeLateReply(const ViscaReply& reply) {
+    auto it = expired.end();
+    if (reply.type != ViscaReply::Ack && reply.socket != 0) {
+        it = find_if(expired.begin(), expired.end(), [&](const ExpiredCommand& c) { return c.socket == reply.socket; });
+    }
+
+    // Nothing is written while a timed out command waits for its ACK, so an
+    // ACK or a reply on no known socket is that command's
+    if (it == expired.end()) {
+        it = expiredUnacknowledged();
+    }
+    if (it == expired.end()) {
+        return false;
+    }
+
+    if (reply.type == ViscaReply::Ack) {
+        it->socket = reply.socket;
+    } else {
+        expired.erase(it);
+    }
+    incrementMetric("visca_late_replies");
+    return true;
+}
+
+// Commands are written one ACK at a time, so an ACK, or an error that takes
+// its place, belongs to the oldest unacknowledged command. Completions and
+// errors of running commands carry the socket their ACK assigned.
+static void dispatchReply(const ViscaReply& reply) {
+    auto bySocket = find_if(inFlight.begin(), inFlight.end(),
+                            [&](const shared_ptr<ViscaCommand>& c) { return c->socket == reply.socket; });
+
+    // Replies on the socket of a running command are its own, anything else
+    // may come from a command that timed out
+    bool running = reply.type != ViscaReply::Ack && reply.socket != 0 && bySocket != inFlight.end();
+    if (!running && consumeLateReply(reply)) {
+        return;
+    }
+
+    switch (reply.type) {
+        case ViscaReply::Ack: {
+            auto it = firstUnacknowledged();
+            if (it != inFlight.end()) {
+                (*it)->socket = reply.socket;
+            }
+
+            // The camera reuses a socket only once its command finished
+            expired.erase(remove_if(expired.begin(), expired.end(),
+                                    [&](const ExpiredCommand& c) { return c.socket == reply.socket; }),
+                          expired.end());
+            break;
+        }
+        case ViscaReply::Completion:
+            // Some cameras skip the ACK of commands that finish at once. Not
+            // after a timeout, the reply may be that command's.
+            if (bySocket == inFlight.end() && expired.empty()) {
+                bySocket = firstUnacknowledged();
+            }
+            if (bySocket != inFlight.end()) {
+                finishInFlight(bySocket, ViscaStatus::Completed);
+            }
+            break;
+        case ViscaReply::Error:
+            if (reply.socket == 0 || (bySocket == inFlight.end() && expired.empty())) {
+                bySocket = firstUnacknowledged();
+            }
+            if (bySocket != inFlight.end()) {
+                finishInFlight(bySocket, reply.error);
+            }
+            break;
+        case ViscaReply::Other:
+            break;
+    }
+}
+
+static void expireCommands() {
+    steady_clock::time_point now = steady_clock::now();
+    while (!expired.empty() && now >= expired.front().forgetAt) {
+        expired.pop_front();
+    }
+
+    for (auto it = inFlight.begin(); it != inFlight.end();) {
+        if (now - (*it)->writtenAt > milliseconds((*it)->timeoutMs)) {
+            expired.push_back({(*it)->socket, now + milliseconds(VISCA_STALE_REPLY_MS)});
+            finishInFlight(it, ViscaStatus::Timeout);
+            it = inFlight.begin();
+        } else {
+            ++it;
+        }
+    }
+}
+
+// Whether the next queued command can go out: the previous one was
+// acknowledged, a socket is free and, for a position command, the previous
+// position reached. Newer targets replace each other in the queue meanwhile.
+// Commands that timed out keep their socket busy until they answer, and one
+// still waiting for its ACK holds back the next write so ACKs stay in order.
+static bool canWrite(const ViscaCommand& next) {
+    size_t busySockets = inFlight.size() + expired.size();
+    if (busySockets >= VISCA_COMMAND_SOCKETS || firstUnacknowledged() != inFlight.end() ||
+        expiredUnacknowledged() != expired.end()) {
+        return false;
+    }
+    return !next.coalesce ||
+           none_of(inFlight.begin(), inFlight.end(), [](const shared_ptr<ViscaCommand>& c) { return c->coalesce; });
+}
+
+static void writeCommand(const shared_ptr<ViscaCommand>& command) {
+    if (!ensureSerialOpen()) {
+        setLogMessage("Serial error");
+        finishCommand(*command, ViscaStatus::PortError);
+        return;
+    }
+
+    cout << "Sending " << command->description << " command" << endl;
+    steady_clock::time_point start = steady_clock::now();
+    bool written = cameraSerial.writeBytes(command->packet.data(), command->packet.size()) == 1;
+    setMetric("visca_write_ms", duration<double, milli>(steady_clock::now() - start).count());
+
+    if (!written) {
+        // Unplugged adapter, probe the ports again with the next command
+        cerr << "ERROR: Serial write failed for " << command->description << endl;
+        setLogMessage("Serial error");
+        cameraSerial.closeDevice();
+        serialOpen = false;
+        setMetric("visca_port_open", 0);
+        finishCommand(*command, ViscaStatus::PortError);
+        while (!inFlight.empty()) {
+            finishInFlight(inFlight.begin(), ViscaStatus::PortError);
+        }
+        expired.clear();
+        return;
+    }
+
+    command->writtenAt = steady_clock::now();
+    inFlight.push_back(command);
+    setMetric("visca_in_flight", inFlight.size());
+}
+
+static void viscaLoop() {
+    setCurrentThreadName("visca");
+    vector<ViscaReply> replies;
+
+    while (true) {
+        shared_ptr<ViscaCommand> command;
+        {
+            unique_lock<mutex> lock(viscaMutex);
+            if (inFlight.empty()) {
+                viscaCondition.wait(lock, [] { return !viscaQueue.empty() || !viscaActive; });
+            } else {
+                // Replies are polled, about one byte time at 9600 baud
+                viscaCondition.wait_for(lock, milliseconds(1));
+            }
+
+            // Stopping writes what is queued and waits for the camera's answers
+            if (viscaQueue.empty() && inFlight.empty() && !viscaActive) {
+                break;
+            }
+            if (!viscaQueue.empty() && canWrite(*viscaQueue.front())) {
+                command = viscaQueue.front();
+                viscaQueue.pop_front();
+                setMetric("visca_queue_depth", viscaQueue.size());
+            }
+        }
+
+        if (serialOpen) {
+            replies.clear();
+            readReplies(replies);
+            for (const ViscaReply& reply : replies) {
+                dispatchReply(reply);
+            }
+        }
+        expireCommands();
+
+        if (command) {
+            writeCommand(command);
+        }
+    }
+
+    if (serialOpen) {
+        cameraSerial.closeDevice();
+        serialOpen = false;
+    }
+}
+
+void startViscaEngine() {
+    if (viscaActive) {
+        return;
+    }
+
+    // Every bucket exists from the start, histogram_quantile needs the full set
+    for (int bound : latencyBucketsMs) {
+        setMetric(latencyBucket(to_string(bound)), 0);
+    }
+    setMetric(latencyBucket("+Inf"), 0);
+    setMetric("visca_latency_ms_sum", 0);
+    setMetric("visca_latency_ms_count", 0);
+
+    viscaActive = true;
+    viscaThread = thread(viscaLoop);
+}
+
+void stopViscaEngine() {
+    {
+        lock_guard<mutex> lock(viscaMutex);
+        viscaActive = false;
+    }
+    viscaCondition.notify_one();
+    if (viscaThread.joinable()) {
+        viscaThread.join();
+    }
+}
+
+future<ViscaStatus> submitViscaCommand(const string& hexPacket, const string& description, bool coalesce,
+                                       int timeoutMs) {
+    promise<ViscaStatus> waiter;
+    future<ViscaStatus> status = waiter.get_future();
+    if (timeoutMs <= 0) {
+        timeoutMs = appConfig.getInt("VISCA_COMMAND_TIMEOUT_MS", 1000);
+    }
+
+    {
+        lock_guard<mutex> lock(viscaMutex);
+        if (!viscaActive) {
+            waiter.set_value(ViscaStatus::PortError);
+            return status;
+        }
+
+        // Latest wins: a queued position command takes the new target instead
+        if (coalesce) {
+            for (auto& queued : viscaQueue) {
+                if (queued->coalesce) {
+                    queued->packet = hexToBytes(hexPacket);
+                    queued->description = description;
+                    queued->timeoutMs = timeoutMs;
+                    queued->queuedAt = steady_clock::now();
+                    queued->waiters.push_back(move(waiter));
+                    incrementMetric("visca_zoom_coalesced");
+                    return status;
+                }
+            }
+        }
+
+        auto command = make_shared<ViscaCommand>();
+        command->packet = hexToBytes(hexPacket);
+        command->description = description;
+        command->coalesce = coalesce;
+        command->timeoutMs = timeoutMs;
+        command->queuedAt = steady_clock::now();
+        command->socket = -1;
+        command->waiters.push_back(move(waiter));
+        viscaQueue.push_back(command);
+        setMetric("visca_queue_depth", viscaQueue.size());
+    }
+    viscaCondition.notify_one();
+    return status;
+}
@@ -0,0 +1,27 @@
+#ifndef VISCA_ENGINE_H
+#define VISCA_ENGINE_H
+
+#include "common.h"
+#include "visca_reply.h"
+#include <future>
+
+// Owns the camera's serial port on a dedicated thread. Commands are queued
+// and written in order, the camera's replies are parsed as they arrive and
+// matched to the commands by their socket. Callers get a future with the
+// command's outcome and never block on the port. The port is opened on the
+// serial thread, on the first command.
+
+// Start/stop the serial thread, stopping closes the port once the commands
+// already queued were answered or timed out
+void startViscaEngine();
+void stopViscaEngine();
+
+// Queue a VISCA packet given as hex ("8101044700000000FF"). It fails with
+// Timeout if not completed within timeoutMs of being written (0 uses
+// VISCA_COMMAND_TIMEOUT_MS). Position commands (coalesce) are latest wins: a
+// newer one replaces one still queued, whose callers then wait for the newer
+// one, and one is only written once the previous one completed.
+future<ViscaStatus> submitViscaCommand(const string& hexPacket, const string& description, bool coalesce = false,
+                                       int timeoutMs = 0);
+
+#endif // VISCA_ENGINE_H
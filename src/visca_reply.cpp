@@ -0,0 +1,80 @@
+#include "visca_reply.h"
+
+// VISCA packets are at most 16 bytes, anything longer is line noise
+#define VISCA_MAX_PACKET 16
+
+const char* viscaStatusName(ViscaStatus status) {
+    switch (status) {
+        case ViscaStatus::Completed: return "completed";
+        case ViscaStatus::SyntaxError: return "syntax_error";
+        case ViscaStatus::BufferFull: return "buffer_full";
+        case ViscaStatus::Cancelled: return "cancelled";
+        case ViscaStatus::NoSocket: return "no_socket";
+        case ViscaStatus::NotExecutable: return "not_executable";
+        case ViscaStatus::Timeout: return "timeout";
+        case ViscaStatus::PortError: return "port_error";
+    }
+    return "unknown";
+}
+
+static ViscaStatus errorStatus(uint8_t code) {
+    switch (code) {
+        case 0x02: return ViscaStatus::SyntaxError;
+        case 0x03: return ViscaStatus::BufferFull;
+        case 0x04: return ViscaStatus::Cancelled;
+        case 0x05: return ViscaStatus::NoSocket;
+        default: return ViscaStatus::NotExecutable;
+    }
+}
+
+// Reply headers are 0x90 (camera 1) up to 0xF0 (camera 7)
+static bool isReplyHeader(uint8_t byte) {
+    return byte >= 0x90 && byte != 0xFF && (byte & 0x0F) == 0;
+}
+
+static ViscaReply parsePacket(const vector<uint8_t>& packet) {
+    ViscaReply reply = {ViscaReply::Other, 0, ViscaStatus::Completed};
+    if (packet.size() < 3) {
+        return reply;
+    }
+
+    reply.socket = packet[1] & 0x0F;
+    switch (packet[1] & 0xF0) {
+        case 0x40:
+            reply.type = ViscaReply::Ack;
+            break;
+        case 0x50:
+            reply.type = ViscaReply::Completion;
+            break;
+        case 0x60:
+            reply.type = ViscaReply::Error;
+            reply.error = errorStatus(packet.size() > 3 ? packet[2] : 0);
+            break;
+    }
+    return reply;
+}
+
+void ViscaReplyParser::feed(const uint8_t* data, size_t length, vector<ViscaReply>& replies) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+
+        if (packet.empty()) {
+            if (isReplyHeader(byte)) {
+                packet.push_back(byte);
+            }
+            continue;
+        }
+
+        packet.push_back(byte);
+        if (byte == 0xFF) {
+            replies.push_back(parsePacket(packet));
+            packet.clear();
+        } else if (packet.size() >= VISCA_MAX_PACKET) {
+            packet.clear();
+        }
+    }
+}
+
+void ViscaReplyParser::reset() {
+    packet.clear();
+}
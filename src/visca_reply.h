@@ -0,0 +1,42 @@
+#ifndef VISCA_REPLY_H
+#define VISCA_REPLY_H
+
+#include "common.h"
+
+// Outcome of a VISCA command, from the camera's reply or the lack of one
+enum class ViscaStatus {
+    Completed,          // 90 5y FF
+    SyntaxError,        // 90 60 02 FF
+    BufferFull,         // 90 60 03 FF, both command sockets busy
+    Cancelled,          // 90 6y 04 FF
+    NoSocket,           // 90 6y 05 FF
+    NotExecutable,      // 90 6y 41 FF, e.g. zoom while the camera changes mode
+    Timeout,            // No completion within the command's timeout
+    PortError           // Not written, no port or the write failed
+};
+
+// Lower case name, used in logs and as metric label
+const char* viscaStatusName(ViscaStatus status);
+
+struct ViscaReply {
+    enum Type { Ack, Completion, Error, Other } type;
+    int socket;             // y of 90 4y/5y/6y, 0 for errors not tied to a socket
+    ViscaStatus error;      // Error replies only
+};
+
+// Splits the bytes read from the camera into replies. Bytes may arrive in
+// any chunks, a partial packet is kept until its FF terminator comes in and
+// noise before a reply header (90..F0) is skipped.
+class ViscaReplyParser {
+public:
+    // Parse received bytes, complete replies are appended to replies
+    void feed(const uint8_t* data, size_t length, vector<ViscaReply>& replies);
+
+    // Drop a partial packet, e.g. when the port was reopened
+    void reset();
+
+private:
+    vector<uint8_t> packet;
+};
+
+#endif // VISCA_REPLY_H
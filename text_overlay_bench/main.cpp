@@ -0,0 +1,104 @@
+// Microbenchmark of TextOverlay::draw against the putText path it replaced,
+// on a 1280x720 frame with the timestamp ticking at 30 fps.
+
+#include "../src/text_overlay.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+#define FRAME_WIDTH 1280
+#define FRAME_HEIGHT 720
+
+// Date and time the way getCurrentDateStr()/getCurrentTimeStr() built them
+static string legacyOverlayText(system_clock::time_point time, int fps) {
+    time_t seconds = system_clock::to_time_t(time);
+
+    char buffer[80];
+    strftime(buffer, 80, "%Y-%m-%d", localtime(&seconds));
+    stringstream dateStream;
+    dateStream << buffer;
+
+    strftime(buffer, 80, "%H:%M:%S", localtime(&seconds));
+    stringstream timeStream;
+    timeStream << buffer;
+
+    string text = dateStream.str() + " " + timeStream.str();
+    if (fps >= 0) {
+        text += " FPS: " + to_string(fps);
+    }
+    return text;
+}
+
+struct BenchCase {
+    const char* name;
+    int fontFace;
+    double fontScale;
+    int thickness;
+    Point origin;
+    bool withFps;
+};
+
+static void runCase(const BenchCase& benchCase, const Mat& background, int frames) {
+    const Scalar color(220, 220, 220);
+    const system_clock::time_point start = system_clock::now();
+    const microseconds frameInterval(33333);
+
+    Mat legacyFrame = background.clone();
+    Mat overlayFrame = background.clone();
+    TextOverlay overlay(benchCase.fontFace, benchCase.fontScale, benchCase.thickness);
+    OverlayLine line;
+
+    TickMeter legacyTime;
+    legacyTime.start();
+    for (int i = 0; i < frames; i++) {
+        string text = legacyOverlayText(start + frameInterval * i, benchCase.withFps ? 30 - i % 2 : -1);
+        putText(legacyFrame, text, benchCase.origin, benchCase.fontFace, benchCase.fontScale, color, benchCase.thickness);
+    }
+    legacyTime.stop();
+
+    TickMeter overlayTime;
+    overlayTime.start();
+    for (int i = 0; i < frames; i++) {
+        formatOverlayLine(line, start + frameInterval * i, benchCase.withFps ? 30 - i % 2 : -1);
+        overlay.draw(overlayFrame, line, benchCase.origin, color);
+    }
+    overlayTime.stop();
+
+    // Same text on clean frames to compare the rendering
+    Mat legacyCheck = background.clone();
+    Mat overlayCheck = background.clone();
+    putText(legacyCheck, line.text, benchCase.origin, benchCase.fontFace, benchCase.fontScale, color, benchCase.thickness);
+    overlay.draw(overlayCheck, line, benchCase.origin, color);
+    Mat difference;
+    absdiff(legacyCheck, overlayCheck, difference);
+    int differentValues = countNonZero(difference.reshape(1));
+
+    double legacyUs = legacyTime.getTimeMicro() / frames;
+    double overlayUs = overlayTime.getTimeMicro() / frames;
+    cout << fixed << setprecision(2) << "  " << benchCase.name << ": putText " << legacyUs
+         << " us, TextOverlay " << overlayUs << " us (" << legacyUs / overlayUs << "x), "
+         << differentValues << " channel values differ" << defaultfloat << endl;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? max(1, atoi(argv[1])) : 3000;
+
+    // A camera-like background, so the blit isn't writing over a flat frame
+    Mat background(FRAME_HEIGHT, FRAME_WIDTH, CV_8UC3);
+    RNG rng(0x7e47);
+    rng.fill(background, RNG::UNIFORM, 0, 256);
+
+    const BenchCase cases[] = {
+        {"recording (simplex 0.7, thickness 2)", FONT_HERSHEY_SIMPLEX, 0.7, 2, Point(10, 30), false},
+        {"preview with FPS", FONT_HERSHEY_SIMPLEX, 0.7, 2, Point(10, 30), true},
+        {"proxy (plain 0.8, thickness 1)", FONT_HERSHEY_PLAIN, 0.8, 1, Point(4, 12), false},
+    };
+
+    cout << FRAME_WIDTH << "x" << FRAME_HEIGHT << ", " << frames << " frames per case, time per frame" << endl;
+    for (const BenchCase& benchCase : cases) {
+        runCase(benchCase, background, frames);
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Test of the thermal monitor levels against a fake sysfs tree.
+// Writes zone temperatures and throttling flags, polls once per step and
+// checks the resulting level, preview interval and metrics.
+
+#include "../src/thermal_monitor.h"
+#include "../src/metrics.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+Config appConfig("/dev/null");
+
+// The monitor names its thread, nothing to do here
+void setCurrentThreadName(const char*) {}
+
+static string sysfsRoot;
+static int failures = 0;
+
+static void writeFile(const string& path, const string& content) {
+    filesystem::create_directories(filesystem::path(path).parent_path());
+    ofstream file(path, ios::trunc);
+    file << content << "\n";
+}
+
+static void setZone(int zone, int milliC) {
+    writeFile(sysfsRoot + "/class/thermal/thermal_zone" + to_string(zone) + "/temp", to_string(milliC));
+}
+
+static void setThrottled(unsigned int flags) {
+    stringstream text;
+    text << "0x" << hex << flags;
+    writeFile(sysfsRoot + "/devices/platform/soc/soc:firmware/get_throttled", text.str());
+}
+
+static void check(const string& step, int expectedLevel) {
+    pollThermalState();
+
+    int expectedInterval = expectedLevel == THERMAL_HOT ? 4 : (expectedLevel == THERMAL_WARM ? 2 : 1);
+    bool passed = thermalLevel() == expectedLevel &&
+                  thermalPreviewInterval() == expectedInterval &&
+                  thermalShedOptionalWork() == (expectedLevel >= THERMAL_WARM) &&
+                  getMetric("thermal_level") == expectedLevel;
+
+    cout << (passed ? "ok   " : "FAIL ") << step << ": level " << thermalLevel()
+         << " (expected " << expectedLevel << "), " << thermalTemperature() << " C" << endl;
+    if (!passed) {
+        failures++;
+    }
+}
+
+static void checkValue(const string& step, double value, double expected) {
+    bool passed = value == expected;
+    cout << (passed ? "ok   " : "FAIL ") << step << ": " << value << " (expected " << expected << ")" << endl;
+    if (!passed) {
+        failures++;
+    }
+}
+
+int main() {
+    char rootTemplate[] = "/tmp/drip-thermal-XXXXXX";
+    if (!mkdtemp(rootTemplate)) {
+        cerr << "ERROR: Could not create a temporary directory" << endl;
+        return 1;
+    }
+    sysfsRoot = rootTemplate;
+
+    // Explicit thresholds, so the test doesn't follow the defaults
+    writeFile(sysfsRoot + "/config.ini",
+              "THERMAL_SYSFS_ROOT=" + sysfsRoot + "\n"
+              "THERMAL_WARM_C=70\n"
+              "THERMAL_HOT_C=78\n"
+              "THERMAL_HYSTERESIS_C=3\n"
+              "THERMAL_WARM_PREVIEW_INTERVAL=2\n"
+              "THERMAL_HOT_PREVIEW_INTERVAL=4");
+    appConfig.loadConfig(sysfsRoot + "/config.ini");
+    loadThermalSettings();
+
+    // No thermal zones and no firmware flags, e.g. a desktop
+    check("no sysfs entries", THERMAL_NORMAL);
+    checkValue("temperature without zones", thermalTemperature(), 0);
+
+    // The hottest zone counts, other entries of class/thermal are ignored
+    setZone(0, 45000);
+    setZone(1, 52000);
+    writeFile(sysfsRoot + "/class/thermal/cooling_device0/temp", "99000");
+    check("two cool zones", THERMAL_NORMAL);
+    checkValue("hottest zone", thermalTemperature(), 52);
+
+    // Up as soon as a threshold is crossed
+    setZone(1, 70000);
+    check("warm threshold reached", THERMAL_WARM);
+
+    // Down only below threshold - hysteresis
+    setZone(1, 68000);
+    check("warm, within hysteresis", THERMAL_WARM);
+    setZone(1, 67100);
+    check("warm, just above the hysteresis", THERMAL_WARM);
+    setZone(1, 67000);
+    check("cooled to threshold - hysteresis", THERMAL_NORMAL);
+    setZone(1, 69000);
+    check("normal, below the warm threshold", THERMAL_NORMAL);
+
+    // Straight from normal to hot
+    setZone(0, 78000);
+    check("hot threshold reached", THERMAL_HOT);
+    setZone(0, 76000);
+    check("hot, within hysteresis", THERMAL_HOT);
+    setZone(0, 74000);
+    check("cooled to warm", THERMAL_WARM);
+    setZone(0, 71000);
+    check("warm, still above the warm threshold", THERMAL_WARM);
+    setZone(0, 40000);
+    setZone(1, 40000);
+    check("cooled down", THERMAL_NORMAL);
+
+    // Firmware throttling means hot whatever the zones read
+    setThrottled(0x4);
+    check("firmware throttling", THERMAL_HOT);
+    checkValue("throttled metric", getMetric("thermal_throttled"), 1);
+    setThrottled(0x8);
+    check("soft temperature limit", THERMAL_HOT);
+
+    // Only the "has occurred" bits left, back down at once when cool
+    setThrottled(0x50000);
+    check("throttling over", THERMAL_NORMAL);
+    checkValue("throttled metric cleared", getMetric("thermal_throttled"), 0);
+
+    // Under-voltage alone sheds nothing but is exported
+    setThrottled(0x1);
+    check("under-voltage", THERMAL_NORMAL);
+    checkValue("under-voltage metric", getMetric("thermal_under_voltage"), 1);
+
+    // Unreadable flags count as none
+    setThrottled(0);
+    writeFile(sysfsRoot + "/devices/platform/soc/soc:firmware/get_throttled", "garbage");
+    setZone(0, 80000);
+    check("hot with unreadable flags", THERMAL_HOT);
+
+    filesystem::remove_all(sysfsRoot);
+
+    if (failures) {
+        cout << failures << " checks FAILED" << endl;
+        return 1;
+    }
+    cout << "All checks passed" << endl;
+    return 0;
+}